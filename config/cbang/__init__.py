@@ -83,6 +83,10 @@ def configure_deps(conf, local = True, with_openssl = True,
     # EPoll support
     if conf.CBCheckFunc('epoll_create1'): env.CBConfigDef('HAVE_EPOLL')
 
+    # io_uring support
+    if conf.CBCheckCHeader('liburing.h') and conf.CBCheckLib('uring'):
+        env.CBConfigDef('HAVE_LIBURING')
+
     if with_openssl: conf.CBConfig('openssl', False, version = '1.1.0')
     conf.CBConfig('v8', False)
 
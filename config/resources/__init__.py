@@ -40,10 +40,17 @@ import time
 import textwrap
 import stat
 import shutil
+import gzip
+import hashlib
 
 from SCons.Script import *
 
-resource_version = 2
+try:
+  import lz4.frame
+  have_lz4 = True
+except ImportError: have_lz4 = False
+
+resource_version = 3
 
 
 class ResourceContext:
@@ -91,8 +98,114 @@ def is_excluded(exclude, path):
   return exclude != None and exclude.search(path) != None
 
 
+def write_data(ctx, output, name, data):
+  write_string(ctx, output, 'extern const unsigned char %s[] = {' % name)
+
+  for c in bytearray(data):
+    write_string(ctx, output, '%d,' % c)
+
+  write_string(ctx, output, '0};\n')
+
+
+def compress(encoding, data):
+  if encoding == 'gzip':
+    return gzip.compress(data, 9, mtime = 0)
+
+  if encoding == 'lz4':
+    if not have_lz4: return None
+    return lz4.frame.compress(data, compression_level = 9)
+
+  raise Exception('Unsupported resource compression "%s"' % encoding)
+
+
+def get_variants(ctx, path, data):
+  variants = []
+  if len(data) < ctx.compress_min or is_excluded(ctx.no_compress, path):
+    return variants
+
+  for encoding in ctx.compress:
+    compressed = compress(encoding, data)
+
+    # Only worth serving if it saves at least 10%
+    if compressed is not None and len(compressed) < len(data) * 0.9:
+      variants.append((encoding, compressed))
+
+  return variants
+
+
+def get_etag(data, encoding = None):
+  etag = hashlib.sha256(data).hexdigest()[:16]
+  if encoding: etag += '-' + encoding
+  return '"%s"' % etag
+
+
+def hash_path(seed, path):
+  # FNV-1a, seeded through the offset basis.  Must match ResourceIndex::hash()
+  h = seed if seed else 0x811c9dc5
+
+  for c in bytearray(path.encode('utf-8')):
+    h = ((h ^ c) * 0x01000193) & 0xffffffff
+
+  return h
+
+
+def build_index(paths):
+  size = len(paths)
+  buckets = [[] for i in range(size)]
+  for path in paths: buckets[hash_path(0, path) % size].append(path)
+
+  displace = [0] * size
+  slots = [None] * size
+  order = sorted(range(size), key = lambda i: -len(buckets[i]))
+
+  # Find a seed which places each collision bucket in free slots
+  for b in order:
+    bucket = buckets[b]
+    if len(bucket) < 2: break
+
+    seed = 1
+    while True:
+      placed = [hash_path(seed, path) % size for path in bucket]
+      if len(set(placed)) == len(bucket) and \
+         all(slots[slot] is None for slot in placed): break
+      seed += 1
+
+    for slot, path in zip(placed, bucket): slots[slot] = path
+    displace[b] = seed
+
+  # Buckets with one path go directly in the remaining slots
+  free = [i for i in range(size) if slots[i] is None]
+  for b in order:
+    if len(buckets[b]) != 1: continue
+    slot = free.pop()
+    slots[slot] = buckets[b][0]
+    displace[b] = -slot - 1
+
+  return displace, slots
+
+
+def write_index(ctx, output, id, entries):
+  displace, slots = build_index(list(entries.keys()))
+
+  write_string(ctx, output, 'const int indexDisplace%d[] = {' % id)
+  for d in displace: write_string(ctx, output, '%d,' % d)
+  write_string(ctx, output, '0};\n')
+
+  write_string(ctx, output, 'const char *indexPaths%d[] = {' % id)
+  for path in slots: write_string(ctx, output, '"%s",' % path)
+  write_string(ctx, output, '0};\n')
+
+  write_string(ctx, output, 'const Resource *indexResources%d[] = {' % id)
+  for path in slots: write_string(ctx, output, '&resource%d,' % entries[path])
+  write_string(ctx, output, '0};\n')
+
+  output.write('const ResourceIndex index%d = {%d, indexDisplace%d, '
+               'indexPaths%d, indexResources%d};\n' %
+               (id, len(slots), id, id, id))
+
+
 def write_resource(ctx, output, data_dir, path, children = None,
-                   exclude = None):
+                   exclude = None, index = None, prefix = ''):
   name = os.path.basename(path)
   if is_excluded(ctx.exclude, path): return
 
@@ -100,14 +213,17 @@ def write_resource(ctx, output, data_dir, path, children = None,
   id = ctx.next_id
   ctx.next_id += 1
   length = 0
+  top = index is None
+  if top: index = {}
 
   if is_dir:
     typeStr = 'Directory'
     child_resources = []
 
     for filename in os.listdir(path):
+      child_prefix = prefix + filename if top else prefix + '/' + filename
       write_resource(ctx, output, data_dir, os.path.join(path, filename),
-                     child_resources, exclude)
+                     child_resources, exclude, index, child_prefix)
 
     write_string(ctx, output, 'const Resource *children%d[] = {' % id)
 
@@ -116,61 +232,81 @@ def write_resource(ctx, output, data_dir, path, children = None,
 
     write_string(ctx, output, '0};\n')
 
+    if top and index: write_index(ctx, output, id, index)
+
   else:
     out_path = '%s/data%d.cpp' % (data_dir, id)
     print('Writing resource: %s to %s' % (path, out_path))
 
     typeStr = 'File'
-    with open(path, 'rb') as f:
-      prototype = 'extern const unsigned char data%d[]' % id
+    with open(path, 'rb') as f: data = f.read()
+    length = len(data)
+    variants = get_variants(ctx, path, data)
 
-      write_string(ctx, output, '%s;\n' % prototype)
+    write_string(ctx, output, 'extern const unsigned char data%d[];\n' % id)
+    for encoding, compressed in variants:
+      write_string(ctx, output, 'extern const unsigned char data%d_%s[];\n' %
+                   (id, encoding))
 
-      with open(out_path, 'w') as out:
-        start_file(ctx, out)
+    with open(out_path, 'w') as out:
+      start_file(ctx, out)
 
-        write_string(ctx, out, prototype + ' = {')
+      write_data(ctx, out, 'data%d' % id, data)
+      for encoding, compressed in variants:
+        write_data(ctx, out, 'data%d_%s' % (id, encoding), compressed)
 
-        while True:
-          count = 0
-          for c in f.read(102400):
-            if not isinstance(c, int): c = ord(c)
-            write_string(ctx, out, '%d,' % c)
-            count += 1
+      end_file(ctx, out)
 
-          if count == 0: break
-          length += count
+    if variants:
+      write_string(ctx, output, 'const ResourceVariant variants%d[] = {' % id)
 
-        write_string(ctx, out, '0};\n')
+      for encoding, compressed in variants:
+        write_string(ctx, output, '{"%s", "%s", (const char *)data%d_%s, %d},'
+                     % (encoding, get_etag(data, encoding).replace('"', '\\"'),
+                        id, encoding, len(compressed)))
 
-        end_file(ctx, out)
+      write_string(ctx, output, '{0, 0, 0, 0}};\n')
 
   if children != None: children.append(id)
+  if not top: index[prefix] = id
 
   output.write('extern const %sResource resource%d("%s", ' %
                (typeStr, id, name))
 
-  if is_dir: output.write('children%d' % id)
-  else: output.write('(const char *)data%d, %d' % (id, length))
+  if is_dir:
+    output.write('children%d' % id)
+    if top and index: output.write(', &index%d' % id)
+
+  else:
+    output.write('(const char *)data%d, %d, "%s"' %
+                 (id, length, get_etag(data).replace('"', '\\"')))
+    if variants: output.write(', variants%d' % id)
 
   output.write(');\n')
 
 
-def get_exclude(env):
+def get_pattern(patterns):
   pattern = None
-  for ex in env.get('RESOURCES_EXCLUDES'):
+  for ex in patterns:
     if pattern == None: pattern = ''
     else: pattern += '|'
     pattern += '(%s)' % ex
 
+  if pattern is None: return None
   return re.compile(pattern)
 
 
+def get_exclude(env): return get_pattern(env.get('RESOURCES_EXCLUDES'))
+
+
 def resources_build(target, source, env):
   ctx = ResourceContext()
   ctx.env = env
   ctx.ns = env.get('RESOURCES_NS')
   ctx.exclude = get_exclude(env)
+  ctx.compress = env.get('RESOURCES_COMPRESS')
+  ctx.compress_min = env.get('RESOURCES_COMPRESS_MIN')
+  ctx.no_compress = get_pattern(env.get('RESOURCES_NO_COMPRESS'))
   ctx.next_id = 0
   ctx.col = 0
 
@@ -230,6 +366,10 @@ def modify_targets(target, source, env):
 def generate(env):
   env.SetDefault(RESOURCES_NS = '')
   env.SetDefault(RESOURCES_EXCLUDES = [r'\.svn', r'~$'])
+  env.SetDefault(RESOURCES_COMPRESS = ['gzip', 'lz4'])
+  env.SetDefault(RESOURCES_COMPRESS_MIN = 256)
+  env.SetDefault(RESOURCES_NO_COMPRESS = [
+    r'\.(gz|bz2|xz|lz4|zip|png|jpe?g|gif|webp|woff2?|ico)$'])
 
   bld = env.Builder(action = resources_build,
                     source_factory = SCons.Node.FS.Entry,
@@ -36,6 +36,16 @@
 
 #include <atomic>
 #include <string>
+#include <utility>
+
+
+// Reference count tracing is compiled out unless enabled
+#ifdef CBANG_REFCOUNTER_TRACE
+#define CBANG_REFCOUNTER_LOG(...) do {if (trace) log(trace, __VA_ARGS__);} \
+  while (false)
+#else
+#define CBANG_REFCOUNTER_LOG(...) do {} while (false)
+#endif
 
 
 namespace cb {
@@ -89,7 +99,7 @@ namespace cb {
     static RefCounter *create(T *ptr) {return new RefCounterImpl(ptr);}
 
     void release() {
-      log(trace, "release()");
+      CBANG_REFCOUNTER_LOG("release()");
       T *_ptr = ptr;
       delete this;
       if (_ptr) Dealloc_T::dealloc(_ptr);
@@ -104,7 +114,7 @@ namespace cb {
       while (!count.compare_exchange_weak(c, c + 1))
         continue;
 
-      log(trace, "incCount() count=%u", c + 1);
+      CBANG_REFCOUNTER_LOG("incCount() count=%u", c + 1);
     }
 
     void decCount() override {
@@ -115,7 +125,7 @@ namespace cb {
       while (!count.compare_exchange_weak(c, c - 1))
         if (!c) raise("Already zero!");
 
-      log(trace, "decCount() count=%u", c - 1);
+      CBANG_REFCOUNTER_LOG("decCount() count=%u", c - 1);
 
       if (c == 1) release();
     }
@@ -133,6 +143,63 @@ namespace cb {
   unsigned RefCounterImpl<T, Dealloc_T>::trace = 0;
 
 
+  /**
+   * A reference counter which holds the object it counts so both are
+   * allocated together.  Used by SmartNew().
+   */
+  template<typename T>
+  class RefCounterInlineImpl : public RefCounter {
+  protected:
+    std::atomic<unsigned> count;
+    T value;
+
+  public:
+    static unsigned trace;
+
+    template <typename... Args>
+    RefCounterInlineImpl(Args &&...args) :
+      count(0), value(std::forward<Args>(args)...) {setRefPtr(&value);}
+
+    T *get() {return &value;}
+
+    void release() {
+      CBANG_REFCOUNTER_LOG("release()");
+      delete this;
+    }
+
+    // From RefCounter
+    unsigned getCount() const override {return count;}
+
+    void incCount() override {
+      unsigned c = count;
+
+      while (!count.compare_exchange_weak(c, c + 1))
+        continue;
+
+      CBANG_REFCOUNTER_LOG("incCount() count=%u", c + 1);
+    }
+
+    void decCount() override {
+      unsigned c = count;
+
+      if (!c) raise("Already zero!");
+
+      while (!count.compare_exchange_weak(c, c - 1))
+        if (!c) raise("Already zero!");
+
+      CBANG_REFCOUNTER_LOG("decCount() count=%u", c - 1);
+
+      if (c == 1) release();
+    }
+
+    void adopted() override {raise("Can't adopt pointer allocated inline!");}
+  };
+
+
+  template<typename T>
+  unsigned RefCounterInlineImpl<T>::trace = 0;
+
+
   class RefCounterPhonyImpl : public RefCounter {
     static RefCounterPhonyImpl singleton;
     RefCounterPhonyImpl() {}
@@ -379,6 +379,18 @@ namespace cb {
 
   template<typename T> inline static SmartPointer<T> SmartArray(T *ptr)
   {return typename SmartPointer<T>::Array(ptr);}
+
+
+  /**
+   * Construct a T with @param args and return a SmartPointer to it.  The
+   * object and its reference counter are allocated together.  The result
+   * cannot be adopted.
+   */
+  template<typename T, typename... Args> inline static
+  SmartPointer<T> SmartNew(Args &&...args) {
+    auto counter = new RefCounterInlineImpl<T>(std::forward<Args>(args)...);
+    return SmartPointer<T>(counter->get(), counter);
+  }
 }
 
 #define CBANG_SP(T)        cb::SmartPointer<T>
@@ -49,9 +49,9 @@
 
 #include <cbang/http/Request.h>
 #include <cbang/http/HandlerGroup.h>
-#include <cbang/http/URLPatternMatcher.h>
 #include <cbang/http/MethodMatcher.h>
 #include <cbang/http/FileHandler.h>
+#include <cbang/http/MetricsHandler.h>
 #include <cbang/http/ResourceHandler.h>
 
 #include <cbang/openssl/SSLContext.h>
@@ -165,6 +165,7 @@ HTTP::RequestHandlerPtr cb::API::API::createEndpointHandler(
   if (type == "redirect") return new RedirectHandler(config);
   if (type == "docs")     return new DocsHandler(config, docs);
   if (type == "file")     return new HTTP::FileHandler(config);
+  if (type == "metrics")  return new HTTP::MetricsHandler;
   if (type == "resource")
     return new HTTP::ResourceHandler(config->getString("resource"));
 
@@ -222,42 +223,39 @@ HTTP::RequestHandlerPtr cb::API::API::createMethodsHandler(
 
 
 HTTP::RequestHandlerPtr cb::API::API::createAPIHandler(const CtxPtr &ctx) {
-  auto children = SmartPtr(new HTTP::HandlerGroup);
+  auto group = SmartPtr(new HTTP::HandlerGroup);
+  addAPIHandlers(*group, ctx);
+  return group;
+}
+
+
+void cb::API::API::addAPIHandlers(HTTP::HandlerGroup &group,
+                                  const CtxPtr &ctx) {
   auto methods  = SmartPtr(new HTTP::HandlerGroup);
   auto &api     = ctx->getConfig();
   auto &pattern = ctx->getPattern();
 
-  // Children
+  // Methods
   for (unsigned i = 0; i < api->size(); i++) {
-    auto &key    = api->keyAt(i);
-    auto &config = api->get(i);
-
-    // Child
-    if (!key.empty() && key[0] == '/') {
-      children->addHandler(createAPIHandler(ctx->createChild(config, key)));
-      continue;
-    }
+    auto &key = api->keyAt(i);
+    if (!key.empty() && key[0] == '/') continue;
 
-    // Methods
     unsigned methodTypes = parseMethods(key);
     if (methodTypes) {
-      auto handler = createMethodsHandler(key, ctx->createChild(config, ""));
+      auto handler =
+        createMethodsHandler(key, ctx->createChild(api->get(i), ""));
       methods->addHandler(new HTTP::MethodMatcher(methodTypes, handler));
     }
   }
 
-  auto group = SmartPtr(new HTTP::HandlerGroup);
-
-  if (!methods->isEmpty()) {
-    if (pattern.empty()) group->addHandler(methods);
-    else group->addHandler(new HTTP::URLPatternMatcher(pattern, methods));
-  }
+  // All endpoints are routed from one flat URLRouter, methods first
+  if (!methods->isEmpty())
+    group.addRoute(HTTP::Method::HTTP_ANY, pattern, methods);
 
-  if (!children->isEmpty()) {
-    if (pattern.empty()) group->addHandler(children);
-    else group->addHandler(
-      new HTTP::URLPatternMatcher(pattern + ".+", children));
+  // Children
+  for (unsigned i = 0; i < api->size(); i++) {
+    auto &key = api->keyAt(i);
+    if (!key.empty() && key[0] == '/')
+      addAPIHandlers(group, ctx->createChild(api->get(i), key));
   }
-
-  return group;
 }
@@ -114,6 +114,8 @@ namespace cb {
       virtual RequestHandlerPtr createMethodsHandler(
         const std::string &methods, const CtxPtr &ctx);
       virtual RequestHandlerPtr createAPIHandler(const CtxPtr &ctx);
+      virtual void addAPIHandlers(HTTP::HandlerGroup &group,
+                                  const CtxPtr &ctx);
     };
   }
 }
@@ -34,10 +34,13 @@
 #include "API.h"
 #include "Resolver.h"
 
+#include <cbang/http/Conn.h>
 #include <cbang/log/Logger.h>
 
 #include <mysql/mysqld_error.h>
 
+#include <cstring>
+
 using namespace std;
 using namespace cb;
 using namespace cb::API;
@@ -46,40 +49,143 @@ using namespace cb::API;
 Query::Query(
   API &api, const SmartPointer<HTTP::Request> &req, const string &sql,
   const string &returnType, const JSON::ValuePtr &fields) :
-  api(api), req(req), sql(sql), returnType(returnType), fields(fields) {}
+  Query(api, req, sql, parseReturnType(returnType), fields) {}
+
+
+Query::Query(
+  API &api, const SmartPointer<HTTP::Request> &req, const string &sql,
+  return_t returnCB, const JSON::ValuePtr &fields) :
+  api(api), req(req), sql(sql), fields(fields), returnCB(returnCB) {}
+
+
+Query::return_t Query::parseReturnType(const string &type) {
+  if (type == "ok")      return &Query::returnOk;
+  if (type == "hlist")   return &Query::returnHList;
+  if (type == "list")    return &Query::returnList;
+  if (type == "columns") return &Query::returnColumns;
+  if (type == "packed")  return &Query::returnPacked;
+  if (type == "fields")  return &Query::returnFields;
+  if (type == "dict")    return &Query::returnDict;
+  if (type == "one")     return &Query::returnOne;
+  if (type == "bool")    return &Query::returnBool;
+  if (type == "u64")     return &Query::returnU64;
+  if (type == "s64")     return &Query::returnS64;
+  if (type == "pass")    return &Query::returnOk;
+  THROW("Unsupported query return type '" << type << "'");
+}
+
+
+bool Query::canStream() const {
+  return streaming &&
+    (returnCB == &Query::returnList || returnCB == &Query::returnHList) &&
+    Version(1, 1) <= req->getVersion();
+}
 
 
 void Query::query(callback_t cb) {
   if (!cb) THROW("Callback not set");
   this->cb = cb;
-  if (db.isNull()) db = api.getDBConnector().getConnection();
-  string sql = Resolver(api, req).format(this->sql, "NULL");
-  db->query(this, &Query::callback, sql);
+  if (db.isSet()) return exec();
+
+  api.getDBConnector().getConnection(
+    [this] (const SmartPointer<MariaDB::EventDB> &db) {
+      if (db.isNull())
+        return errorReply(HTTP_SERVICE_UNAVAILABLE, "Database busy");
+
+      this->db = db;
+      pooled = true;
+
+      try {
+        exec();
+
+      } catch (const Exception &e) {
+        // Nothing was sent to the DB, return the connection to the pool
+        LOG_WARNING("Query failed: " << e.getMessages());
+        release();
+
+        int code = e.getCode();
+        if (400 <= code && code < 600)
+          errorReply((HTTP::Status::enum_t)code, e.getMessage());
+        else errorReply(HTTP_INTERNAL_SERVER_ERROR);
+
+      } catch (const std::exception &e) {
+        LOG_ERROR("Query failed: " << e.what());
+        release();
+        errorReply(HTTP_INTERNAL_SERVER_ERROR);
+      }
+    });
+}
+
+
+void Query::dbCallback(state_t state) {
+  if (db.isNull()) return; // Already released after an error
+
+  bool last = state == MariaDB::EventDB::EVENTDB_DONE ||
+    state == MariaDB::EventDB::EVENTDB_ERROR;
+  if (last) req->mark(HTTP::Request::TIME_DB_DONE);
+
+  try {
+    if (!aborted) callback(state);
+  } catch (...) {
+    if (last) release();
+    throw;
+  }
+
+  if (last) release();
 }
 
 
-void Query::callback(state_t state) {
-  if (returnType == "ok")     return Query::returnOk    (state);
-  if (returnType == "hlist")  return Query::returnHList (state);
-  if (returnType == "list")   return Query::returnList  (state);
-  if (returnType == "fields") return Query::returnFields(state);
-  if (returnType == "dict")   return Query::returnDict  (state);
-  if (returnType == "one")    return Query::returnOne   (state);
-  if (returnType == "bool")   return Query::returnBool  (state);
-  if (returnType == "u64")    return Query::returnU64   (state);
-  if (returnType == "s64")    return Query::returnS64   (state);
-  if (returnType == "pass")   return Query::returnOk    (state);
-  THROW("Unsupported query return type '" << returnType << "'");
+void Query::exec() {
+  req->markOnce(HTTP::Request::TIME_DB_START);
+  Resolver resolver(api, req);
+  db->setUnbuffered(canStream());
+
+  if (statement.isSet() && statement->isPrepared())
+    db->execute(this, &Query::dbCallback, statement->getSQL(),
+                statement->formatArgs(resolver));
+
+  else db->query(this, &Query::dbCallback, tmpl.isSet() ?
+                 resolver.format(*tmpl, "NULL") : resolver.format(sql, "NULL"));
 }
 
 
+void Query::release() {
+  if (!pooled) return;
+  pooled = false;
+  api.getDBConnector().release(db);
+  db.release();
+}
+
+
+void Query::callback(state_t state) {(this->*returnCB)(state);}
+
+
 void Query::reply(HTTP::Status code) {
   writer.close();
-  cb(code, writer);
+
+  if (req->isChunked()) {
+    sendChunk();
+    req->endChunked();
+
+  } else cb(code, writer);
 }
 
 
 void Query::errorReply(HTTP::Status code, const string &msg) {
+  contentType = "application/json";
+
+  if (req->isChunked()) {
+    // Headers already sent, the only way to signal failure is to cut the
+    // response short so the client sees an incomplete chunked body.
+    LOG_WARNING("Aborting streamed response: "
+                << (msg.empty() ? code.toString() : msg));
+    aborted = true;
+    writer.reset();
+    if (req->hasConnection()) req->getConnection()->close();
+    db->resume();
+    return;
+  }
+
   writer.reset();
 
   writer.beginDict();
@@ -91,6 +197,38 @@ void Query::errorReply(HTTP::Status code, const string &msg) {
 }
 
 
+void Query::streamRow() {
+  if (!canStream()) return;
+
+  if (!req->isChunked()) {
+    req->setContentType("application/json");
+    req->startChunked(HTTP_OK);
+  }
+
+  writer.flush();
+  if (chunkSize <= writer.getLength()) sendChunk();
+}
+
+
+void Query::sendChunk() {
+  writer.flush();
+
+  uint64_t length = writer.getLength();
+  if (!length) return;
+
+  pending += length;
+
+  // Request::sendChunk() drains the writer's buffer
+  req->sendChunk(writer, [this, length] (bool success) {
+    pending -= length;
+    if (db.isSet() && db->isPaused() && (!success || pending <= maxPending / 2))
+      db->resume();
+  });
+
+  if (maxPending < pending && !db->isPaused()) db->pause();
+}
+
+
 void Query::returnHList(MariaDB::EventDB::state_t state) {
   if (state == MariaDB::EventDB::EVENTDB_ROW) {
     if (!rowCount++) {
@@ -105,6 +243,7 @@ void Query::returnHList(MariaDB::EventDB::state_t state) {
 
     writer.beginAppend();
     db->writeRowList(writer);
+    streamRow();
 
   } else returnList(state);
 }
@@ -120,6 +259,7 @@ void Query::returnList(MariaDB::EventDB::state_t state) {
 
     if (db->getFieldCount() == 1) db->writeField(writer, 0);
     else db->writeRowDict(writer);
+    streamRow();
     break;
 
   case MariaDB::EventDB::EVENTDB_DONE:
@@ -133,6 +273,150 @@ void Query::returnList(MariaDB::EventDB::state_t state) {
 }
 
 
+void Query::returnColumns(MariaDB::EventDB::state_t state) {
+  switch (state) {
+  case MariaDB::EventDB::EVENTDB_ROW: {
+    unsigned count = db->getFieldCount();
+
+    if (!rowCount++)
+      for (unsigned i = 0; i < count; i++) {
+        columnNames.push_back(db->getField(i).getName());
+        columns.push_back(new Event::JSONBufferWriter);
+        columns.back()->beginList();
+      }
+
+    else if (count != columns.size()) THROW("Result columns do not match");
+
+    for (unsigned i = 0; i < count; i++) {
+      columns[i]->beginAppend();
+      db->writeField(*columns[i], i);
+    }
+    break;
+  }
+
+  case MariaDB::EventDB::EVENTDB_DONE:
+    // Assemble {"name": [...], ...} from the column buffers
+    writer.reset();
+    writer.add("{");
+
+    for (unsigned i = 0; i < columns.size(); i++) {
+      if (i) writer.add(",");
+      writer.add("\"" + JSON::Writer::escape(columnNames[i]) + "\":");
+      columns[i]->endList();
+      columns[i]->close();
+      writer.add((const Event::Buffer &)*columns[i]);
+    }
+
+    writer.add("}");
+    columns.clear();
+    returnOk(state);
+    break;
+
+  default: returnOk(state); break;
+  }
+}
+
+
+namespace {
+  void addU8(Event::Buffer &buf, uint8_t x) {buf.add((const char *)&x, 1);}
+
+
+  void addU32(Event::Buffer &buf, uint32_t x) {
+    char data[4];
+    for (unsigned i = 0; i < 4; i++) data[i] = x >> (8 * i);
+    buf.add(data, 4);
+  }
+
+
+  void addU64(Event::Buffer &buf, uint64_t x) {
+    char data[8];
+    for (unsigned i = 0; i < 8; i++) data[i] = x >> (8 * i);
+    buf.add(data, 8);
+  }
+
+
+  void addF64(Event::Buffer &buf, double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, 8);
+    addU64(buf, bits);
+  }
+
+
+  void addString(Event::Buffer &buf, const char *s, uint32_t length) {
+    addU32(buf, length);
+    buf.add(s, length);
+  }
+
+
+  char getPackedType(const MariaDB::Field &field) {
+    // Only floats go through f64, other numbers must stay exact
+    if (field.isInteger()) return field.isUnsigned() ? 'u' : 'i';
+    if (field.isDecimal()) return 'd';
+    if (field.isReal()) return 'n';
+    return 's';
+  }
+}
+
+
+void Query::returnPacked(MariaDB::EventDB::state_t state) {
+  switch (state) {
+  case MariaDB::EventDB::EVENTDB_ROW: {
+    unsigned count = db->getFieldCount();
+
+    if (!rowCount++) {
+      writer.reset();
+      writer.add("CBQ1");
+      addU32(writer, count);
+
+      for (unsigned i = 0; i < count; i++) {
+        auto field = db->getField(i);
+        columnNames.push_back(field.getName());
+        addU8(writer, getPackedType(field));
+        addString(writer, columnNames[i].data(), columnNames[i].length());
+      }
+
+    } else if (count != columnNames.size())
+      THROW("Result columns do not match");
+
+    // Row marker, null bitmap then the non-null values
+    addU8(writer, 1);
+
+    for (unsigned i = 0; i < count; i += 8) {
+      uint8_t bits = 0;
+      for (unsigned j = 0; j < 8 && i + j < count; j++)
+        if (db->getNull(i + j)) bits |= 1 << j;
+      addU8(writer, bits);
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+      if (db->getNull(i)) continue;
+
+      switch (getPackedType(db->getField(i))) {
+      case 'u': addU64(writer, db->getU64(i)); break;
+      case 'i': addU64(writer, db->getS64(i)); break;
+      case 'n': addF64(writer, db->getDouble(i)); break;
+      default: addString(writer, db->getData(i), db->getLength(i)); break;
+      }
+    }
+    break;
+  }
+
+  case MariaDB::EventDB::EVENTDB_DONE:
+    if (!rowCount) {
+      writer.add("CBQ1");
+      addU32(writer, 0);
+    }
+
+    addU8(writer, 0); // End of rows
+    contentType = "application/octet-stream";
+    returnOk(state);
+    break;
+
+  default: returnOk(state); break;
+  }
+}
+
+
 void Query::returnBool(MariaDB::EventDB::state_t state) {
   switch (state) {
   case MariaDB::EventDB::EVENTDB_ROW:
@@ -251,7 +535,17 @@ void Query::returnOk(MariaDB::EventDB::state_t state) {
   case MariaDB::EventDB::EVENTDB_BEGIN_RESULT: break;
   case MariaDB::EventDB::EVENTDB_END_RESULT: break;
   case MariaDB::EventDB::EVENTDB_DONE: reply(); break;
-  case MariaDB::EventDB::EVENTDB_RETRY: writer.reset(); break;
+  case MariaDB::EventDB::EVENTDB_RETRY:
+    if (req->isChunked())
+      errorReply(HTTP_INTERNAL_SERVER_ERROR, "Retry after streaming began");
+
+    else {
+      writer.reset();
+      rowCount = 0;
+      columnNames.clear();
+      columns.clear();
+    }
+    break;
 
   case MariaDB::EventDB::EVENTDB_ERROR: {
     HTTP::Status error = HTTP_INTERNAL_SERVER_ERROR;
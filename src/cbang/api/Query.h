@@ -32,59 +32,115 @@
 
 #pragma once
 
+#include "Statement.h"
+
 #include <cbang/json/Value.h>
 #include <cbang/http/Request.h>
 #include <cbang/event/JSONBufferWriter.h>
 #include <cbang/db/maria/EventDB.h>
 
+#include <vector>
+
 
 namespace cb {
   namespace API {
     class API;
 
     class Query : public HTTP::Status {
+    public:
+      typedef MariaDB::EventDB::state_t state_t;
+      typedef void (Query::*return_t)(state_t state);
+
     protected:
       API &api;
       SmartPointer<HTTP::Request> req;
       std::string sql;
-      std::string returnType;
+      TemplatePtr tmpl;
+      StatementPtr statement;
       JSON::ValuePtr fields;
+      std::string contentType = "application/json";
 
       std::string nextField;
       unsigned currentField = 0;
       bool closeField       = true;
       unsigned rowCount     = 0;
 
+      bool streaming        = false;
+      unsigned chunkSize    = 64 * 1024;
+      unsigned maxPending   = 1024 * 1024;
+      uint64_t pending      = 0;
+      bool aborted          = false;
+
       typedef std::function<void (HTTP::Status, Event::Buffer &)> callback_t;
       callback_t cb;
 
+      return_t returnCB;
+
+      // Columnar results
+      std::vector<std::string> columnNames;
+      std::vector<SmartPointer<Event::JSONBufferWriter> > columns;
+
       SmartPointer<MariaDB::EventDB> db;
+      bool pooled = false;
       Event::JSONBufferWriter writer;
 
     public:
       Query(API &api, const SmartPointer<HTTP::Request> &req,
             const std::string &sql, const std::string &returnType = "ok",
             const JSON::ValuePtr &fields = 0);
+      Query(API &api, const SmartPointer<HTTP::Request> &req,
+            const std::string &sql, return_t returnCB,
+            const JSON::ValuePtr &fields = 0);
       virtual ~Query() {}
 
+      const TemplatePtr &getTemplate() const {return tmpl;}
+      void setTemplate(const TemplatePtr &tmpl) {this->tmpl = tmpl;}
+      const StatementPtr &getStatement() const {return statement;}
+      void setStatement(const StatementPtr &statement)
+        {this->statement = statement;}
+
+      bool getStreaming() const {return streaming;}
+      void setStreaming(bool streaming) {this->streaming = streaming;}
+      unsigned getChunkSize() const {return chunkSize;}
+      void setChunkSize(unsigned size) {chunkSize = size;}
+      unsigned getMaxPending() const {return maxPending;}
+      void setMaxPending(unsigned max) {maxPending = max;}
+
+      bool canStream() const;
+
+      /// Look up a return type, such as ``list``, once rather than per row
+      static return_t parseReturnType(const std::string &type);
+
+      const std::string &getContentType() const {return contentType;}
+
       void query(callback_t cb);
 
-      typedef MariaDB::EventDB::state_t state_t;
       virtual void callback(state_t state);
 
       void reply(HTTP::Status code = HTTP_OK);
       void errorReply(HTTP::Status code, const std::string &msg = "");
 
+    protected:
+      void exec();
+      void release();
+      void dbCallback(state_t state);
+      void streamRow();
+      void sendChunk();
+
+    public:
+
       // MariaDB::EventDB callbacks
-      void returnHList (state_t state);
-      void returnList  (state_t state);
-      void returnBool  (state_t state);
-      void returnU64   (state_t state);
-      void returnS64   (state_t state);
-      void returnFields(state_t state);
-      void returnDict  (state_t state);
-      void returnOne   (state_t state);
-      void returnOk    (state_t state);
+      void returnHList  (state_t state);
+      void returnList   (state_t state);
+      void returnColumns(state_t state);
+      void returnPacked (state_t state);
+      void returnBool   (state_t state);
+      void returnU64    (state_t state);
+      void returnS64    (state_t state);
+      void returnFields (state_t state);
+      void returnDict   (state_t state);
+      void returnOne    (state_t state);
+      void returnOk     (state_t state);
     };
   }
 }
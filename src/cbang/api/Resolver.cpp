@@ -104,6 +104,16 @@ JSON::ValuePtr Resolver::select(const string &name) const {
 }
 
 
+JSON::ValuePtr Resolver::select(const Reference &ref) const {
+  auto result = lookup(ref);
+
+  // Return ``null`` if not found
+  if (result.isNull() && ref.isNullable()) return JSON::Null::instancePtr();
+
+  return result;
+}
+
+
 string Resolver::format(const string &s,
                         String::format_cb_t default_cb) const {
   String::format_cb_t cb =
@@ -130,6 +140,60 @@ string Resolver::format(const string &s, const string &defaultValue) const {
 }
 
 
+string Resolver::format(const Template &tmpl,
+                        const string &defaultValue) const {
+  return tmpl.format(*this, &defaultValue);
+}
+
+
+JSON::ValuePtr Resolver::lookup(const Reference &ref) const {
+  auto type = ref.getType();
+  auto &path = ref.getPath();
+  JSON::ValuePtr none;
+
+  switch (type) {
+  case Reference::REF_NONE: return 0;
+  case Reference::REF_CONTEXT: return ctx;
+  case Reference::REF_PARENT_CONTEXT: return parent->getContext();
+
+  case Reference::REF_PARENT:
+    return parent.isSet() ? parent->select(*ref.getParent()) : none;
+
+  default: break;
+  }
+
+  if (req.isSet()) {
+    if (type == Reference::REF_ARGS) return req->getArgs();
+    if (type == Reference::REF_ARG)
+      return path.isSet() ? path->select(*req->getArgs(), none) : none;
+
+    auto &session = req->getSession();
+    if (session.isSet())
+      switch (type) {
+      case Reference::REF_SESSION: return session;
+      case Reference::REF_SESSION_VAR:
+        return path.isSet() ? path->select(*session, none) : none;
+
+      case Reference::REF_GROUPS: return session->get("group");
+      case Reference::REF_GROUP:
+        return path.isSet() ? path->select(*session->get("group"), none) : none;
+
+      default: break;
+      }
+  }
+
+  if (type == Reference::REF_OPTION)
+    return new JSON::String(api.getOptions()[ref.getKey()]);
+
+  if (ctx.isSet()) {
+    auto &p = type == Reference::REF_VAR ? path : ref.getFullPath();
+    if (p.isSet()) return p->select(*ctx, none);
+  }
+
+  return 0;
+}
+
+
 void Resolver::resolve(JSON::Value &value) const {
   auto cb =
     [&] (JSON::Value &value, JSON::Value *parent, unsigned index) {
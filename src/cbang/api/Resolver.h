@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include "Template.h"
+
 #include <cbang/String.h>
 #include <cbang/json/Dict.h>
 #include <cbang/http/Request.h>
@@ -65,11 +67,17 @@ namespace cb {
       ResolverPtr makeChild(const JSON::ValuePtr &ctx);
 
       virtual JSON::ValuePtr select(const std::string &name) const;
+      virtual JSON::ValuePtr select(const Reference &ref) const;
       std::string format(const std::string &s,
                          String::format_cb_t cb = 0) const;
       std::string format(const std::string &s,
                          const std::string &defaultValue) const;
+      std::string format(const Template &tmpl,
+                         const std::string &defaultValue) const;
       void resolve(JSON::Value &value) const;
+
+    protected:
+      JSON::ValuePtr lookup(const Reference &ref) const;
     };
   }
 }
@@ -0,0 +1,159 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "Statement.h"
+#include "Resolver.h"
+
+#include <cbang/String.h>
+#include <cbang/log/Logger.h>
+
+#include <cctype>
+
+using namespace std;
+using namespace cb;
+using namespace cb::API;
+
+
+namespace {
+  const char marker = '\x01';
+
+
+  string trimStatement(const string &sql) {
+    string s = String::trim(sql);
+    if (!s.empty() && s.back() == ';')
+      s = String::trim(s.substr(0, s.length() - 1));
+    return s;
+  }
+}
+
+
+Statement::Statement(const string &sql) : sql(sql) {
+  string trimmed = trimStatement(sql);
+  prepared = isPreparable(trimmed) && compile(trimmed);
+  if (!prepared) params.clear();
+
+  LOG_DEBUG(5, "SQL " << (prepared ? "prepared" : "not prepared") << ": "
+            << this->sql);
+}
+
+
+string Statement::formatArgs(const Resolver &resolver) const {
+  string args;
+
+  for (auto &param: params) {
+    if (!args.empty()) args += ", ";
+
+    auto value = resolver.select(*param.ref);
+    args += value.isSet() ? value->format(param.type) : "NULL";
+  }
+
+  return args;
+}
+
+
+bool Statement::compile(const string &sql) {
+  bool ok = true;
+
+  // Let String::format() parse the references so escapes are handled
+  // exactly as when the query is formatted.  Each reference is replaced by
+  // a marker which is later checked against the quoting context.
+  String::format_cb_t cb =
+    [&] (char type, int index, const string &name, bool &matched) {
+      if (index < 0) {
+        switch (type) {
+        case 'b': case 'f': case 'i': case 'u': case 'S':
+          params.push_back(Param{new Reference(name), type});
+          return string(1, marker);
+
+        default: ok = false; break; // Raw text or unsupported type
+        }
+      }
+
+      return string("NULL"); // Resolver formats positional refs as NULL
+    };
+
+  string result = String(sql).format(cb);
+  if (!ok) return false;
+
+  // References must not be inside quotes and there must be no other ``?``
+  char quote = 0;
+  bool escape = false;
+  for (auto &c: result)
+    if (escape) escape = false;
+    else if (quote) {
+      if (c == '\\') escape = true;
+      else if (c == quote) quote = 0;
+      else if (c == marker) return false;
+
+    } else if (c == '\'' || c == '"' || c == '`') quote = c;
+    else if (c == '?') return false;
+    else if (c == marker) c = '?';
+
+  if (quote) return false;
+
+  this->sql = result;
+  return true;
+}
+
+
+bool Statement::isPreparable(const string &sql) {
+  // Only statements supported by PREPARE, one per query and no comments
+  const char *keywords[] = {
+    "SELECT", "INSERT", "UPDATE", "DELETE", "REPLACE", "CALL", "WITH", 0};
+
+  string first =
+    String::toUpper(sql.substr(0, sql.find_first_of(" \t\r\n(")));
+
+  bool found = false;
+  for (unsigned i = 0; keywords[i] && !found; i++)
+    found = first == keywords[i];
+  if (!found) return false;
+
+  char quote = 0;
+  bool escape = false;
+  for (unsigned i = 0; i < sql.length(); i++) {
+    char c = sql[i];
+    char next = i + 1 < sql.length() ? sql[i + 1] : 0;
+
+    if (escape) escape = false;
+    else if (quote) {
+      if (c == '\\') escape = true;
+      else if (c == quote) quote = 0;
+
+    } else if (c == '\'' || c == '"' || c == '`') quote = c;
+    else if (c == ';' || c == '#' || (c == '-' && next == '-') ||
+             (c == '/' && next == '*')) return false;
+  }
+
+  return true;
+}
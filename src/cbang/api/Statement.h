@@ -0,0 +1,82 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include "Template.h"
+
+#include <cbang/SmartPointer.h>
+
+#include <string>
+#include <vector>
+
+
+namespace cb {
+  namespace API {
+    class Resolver;
+
+    /***
+     * An API query compiled for use as a server-side prepared statement.
+     * Typed variable references, such as ``%(args.id)u`` or
+     * ``%(args.name)S``, become ``?`` parameters.  Queries which cannot be
+     * prepared without changing their meaning, for example ones which
+     * splice raw text with ``%(...)s``, are left to be formatted as before.
+     */
+    class Statement {
+      std::string sql;
+      bool prepared = false;
+
+      struct Param {
+        SmartPointer<Reference> ref;
+        char type;
+      };
+      std::vector<Param> params;
+
+    public:
+      Statement(const std::string &sql);
+
+      bool isPrepared() const {return prepared;}
+      const std::string &getSQL() const {return sql;}
+      unsigned getParamCount() const {return params.size();}
+
+      /// Format the parameter values as a list for ``EXECUTE ... USING``
+      std::string formatArgs(const Resolver &resolver) const;
+
+    protected:
+      bool compile(const std::string &sql);
+      static bool isPreparable(const std::string &sql);
+    };
+
+    typedef SmartPointer<Statement> StatementPtr;
+  }
+}
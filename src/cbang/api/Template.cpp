@@ -0,0 +1,178 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "Template.h"
+#include "Resolver.h"
+
+#include <cbang/String.h>
+#include <cbang/json/Value.h>
+
+using namespace std;
+using namespace cb;
+using namespace cb::API;
+
+
+Reference::Reference(const string &name) : name(name) {
+  if (name.empty()) return;
+  if (name == ".") {type = REF_CONTEXT; return;}
+
+  string n = name;
+  if (n[0] == '~') {
+    nullable = true;
+    n = n.substr(1);
+    if (n.empty()) return;
+    if (n == ".") {type = REF_CONTEXT; return;}
+  }
+
+  if (n == "..") {type = REF_PARENT_CONTEXT; return;}
+  if (String::startsWith(n, "../")) {
+    type = REF_PARENT;
+    parent = new Reference(n.substr(3));
+    return;
+  }
+
+  // Request variables, with a fallback to the context when not available
+  fullPath = makePath(n);
+
+  if (n == "args") type = REF_ARGS;
+  else if (String::startsWith(n, "args.")) {
+    type = REF_ARG;
+    path = makePath(n.substr(5));
+
+  } else if (n == "session") type = REF_SESSION;
+  else if (String::startsWith(n, "session.")) {
+    type = REF_SESSION_VAR;
+    path = makePath(n.substr(8));
+
+  } else if (n == "group") type = REF_GROUPS;
+  else if (String::startsWith(n, "group.")) {
+    type = REF_GROUP;
+    path = makePath(n.substr(6));
+
+  } else if (String::startsWith(n, "options.")) {
+    type = REF_OPTION;
+    key = n.substr(8);
+
+  } else {
+    type = REF_VAR;
+    path = makePath(String::startsWith(n, "./") ? n.substr(2) : n);
+  }
+}
+
+
+SmartPointer<JSON::Path> Reference::makePath(const string &path) {
+  try {
+    return new JSON::Path(path);
+  } catch (const Exception &e) {
+    return 0; // Empty path, never matches
+  }
+}
+
+
+Template::Template(const string &source) : source(source) {
+  // Parse exactly as String::format() does
+  string literal;
+  auto end = source.end();
+
+  for (auto it = source.begin(); it != end; it++) {
+    if (*it != '%') {literal.push_back(*it); continue;}
+
+    if (++it == end) {literal.push_back('%'); break;}
+
+    if (*it == '%') {literal.push_back('%'); continue;}
+
+    Segment seg;
+
+    if (*it == '(') {
+      auto it2 = it + 1;
+      string name;
+      while (it2 != end && *it2 != ')') name.push_back(*it2++);
+
+      if (it2 == end || ++it2 == end || name.empty()) {
+        literal.push_back('%');
+        literal.push_back(*it);
+        continue;
+      }
+
+      seg.type = *it2;
+      seg.ref = new Reference(name);
+      seg.text = string(it - 1, it2 + 1);
+      it = it2;
+
+    } else {
+      // Positional references never resolve
+      seg.type = *it;
+      seg.text = string(it - 1, it + 1);
+    }
+
+    addLiteral(literal);
+    literal.clear();
+    segments.push_back(seg);
+  }
+
+  addLiteral(literal);
+}
+
+
+void Template::format(string &result, const Resolver &resolver,
+                      const string *defaultValue) const {
+  result.reserve(result.length() + literalLength + 16 * segments.size());
+
+  for (auto &seg: segments) {
+    if (!seg.type) {result.append(seg.text); continue;}
+
+    JSON::ValuePtr value;
+    if (seg.ref.isSet()) value = resolver.select(*seg.ref);
+
+    if (value.isSet()) result.append(value->format(seg.type));
+    else if (defaultValue) result.append(*defaultValue);
+    else result.append(seg.text);
+  }
+}
+
+
+string Template::format(const Resolver &resolver,
+                        const string *defaultValue) const {
+  string result;
+  format(result, resolver, defaultValue);
+  return result;
+}
+
+
+void Template::addLiteral(const string &text) {
+  if (text.empty()) return;
+  Segment seg;
+  seg.text = text;
+  literalLength += text.length();
+  segments.push_back(seg);
+}
@@ -0,0 +1,132 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/json/Path.h>
+
+#include <string>
+#include <vector>
+
+
+namespace cb {
+  namespace API {
+    class Resolver;
+
+    /// A variable name, such as ``args.id``, classified once for Resolver
+    class Reference {
+    public:
+      typedef enum {
+        REF_NONE,
+        REF_CONTEXT,
+        REF_PARENT_CONTEXT,
+        REF_PARENT,
+        REF_ARGS,
+        REF_ARG,
+        REF_SESSION,
+        REF_SESSION_VAR,
+        REF_GROUPS,
+        REF_GROUP,
+        REF_OPTION,
+        REF_VAR,
+      } type_t;
+
+    protected:
+      std::string name;
+      type_t type = REF_NONE;
+      bool nullable = false;
+      std::string key;
+      SmartPointer<JSON::Path> path;
+      SmartPointer<JSON::Path> fullPath;
+      SmartPointer<Reference> parent;
+
+    public:
+      Reference(const std::string &name);
+
+      const std::string &getName() const {return name;}
+      type_t getType() const {return type;}
+      bool isNullable() const {return nullable;}
+
+      /// Option name for REF_OPTION
+      const std::string &getKey() const {return key;}
+      /// Path below ``args``, ``session`` or ``group`` or in the context
+      const SmartPointer<JSON::Path> &getPath() const {return path;}
+      /// Path of the whole name in the context, used as a fallback
+      const SmartPointer<JSON::Path> &getFullPath() const {return fullPath;}
+      /// The name following ``../`` for REF_PARENT
+      const SmartPointer<Reference> &getParent() const {return parent;}
+
+    protected:
+      static SmartPointer<JSON::Path> makePath(const std::string &path);
+    };
+
+
+    /***
+     * A format string, as accepted by Resolver::format(), parsed into literal
+     * text and classified variable references so it can be formatted
+     * repeatedly in a single pass.
+     */
+    class Template {
+      std::string source;
+
+      struct Segment {
+        std::string text;
+        char type = 0;
+        SmartPointer<Reference> ref;
+      };
+
+      std::vector<Segment> segments;
+      unsigned literalLength = 0;
+
+    public:
+      Template(const std::string &source);
+
+      const std::string &getSource() const {return source;}
+
+      /***
+       * Unresolved references are replaced by @param defaultValue or, if it
+       * is null, left unchanged.
+       */
+      void format(std::string &result, const Resolver &resolver,
+                  const std::string *defaultValue = 0) const;
+      std::string format(const Resolver &resolver,
+                         const std::string *defaultValue = 0) const;
+
+    protected:
+      void addLiteral(const std::string &text);
+    };
+
+    typedef SmartPointer<Template> TemplatePtr;
+  }
+}
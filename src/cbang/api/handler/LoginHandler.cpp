@@ -85,6 +85,7 @@ bool LoginHandler::operator()(HTTP::Request &req) {
 
   else {
     auto login = SmartPtr(new Login(api, &req, sql, provider, redirectURI));
+    login->setTemplate(tmpl);
 
     auto cb = [this, login, &req] (HTTP::Status status, Event::Buffer &buffer) {
       // Respond with JSON or redirect
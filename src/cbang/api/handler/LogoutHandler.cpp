@@ -46,6 +46,7 @@ LogoutHandler::LogoutHandler(API &api, const JSON::ValuePtr &config) :
 
 bool LogoutHandler::operator()(HTTP::Request &req) {
   auto query = SmartPtr(new Query(api, &req, sql));
+  query->setTemplate(tmpl);
 
   auto cb = [this, query, &req] (HTTP::Status status, Event::Buffer &buffer) {
     if (status == HTTP_OK) {
@@ -44,15 +44,24 @@ QueryHandler::QueryHandler(API &api, const JSON::ValuePtr &config) :
 
   if (config->hasList("fields")) fields = config->get("fields");
 
-  returnType = config->getString("return", fields.isNull() ? "ok" : "fields");
+  string returnType =
+    config->getString("return", fields.isNull() ? "ok" : "fields");
+  returnCB = Query::parseReturnType(returnType);
   pass = returnType == "pass";
+  stream = config->getBoolean("stream", false);
+
+  tmpl = new Template(sql);
+
+  // Compiled once and prepared on each pooled connection on first use
+  if (config->getBoolean("prepare", true)) statement = new Statement(sql);
 }
 
 
 void QueryHandler::reply(
-  HTTP::Request &req, HTTP::Status status, Event::Buffer &buffer) {
+  HTTP::Request &req, HTTP::Status status, Event::Buffer &buffer,
+  const string &contentType) {
   if (buffer.getLength()) {
-    req.setContentType("application/json");
+    req.setContentType(contentType);
     req.send(buffer);
   }
 
@@ -61,10 +70,13 @@ void QueryHandler::reply(
 
 
 bool QueryHandler::operator()(HTTP::Request &req) {
-  auto query = SmartPtr(new Query(api, &req, sql, returnType, fields));
+  auto query = SmartPtr(new Query(api, &req, sql, returnCB, fields));
+  query->setStreaming(stream);
+  query->setTemplate(tmpl);
+  query->setStatement(statement);
 
   auto cb = [this, query, &req] (HTTP::Status status, Event::Buffer &buffer) {
-    reply(req, status, buffer);
+    reply(req, status, buffer, query->getContentType());
   };
 
   query->query(cb);
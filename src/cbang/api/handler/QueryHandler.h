@@ -33,6 +33,9 @@
 #pragma once
 
 #include <cbang/http/RequestHandler.h>
+#include <cbang/api/Query.h>
+#include <cbang/api/Template.h>
+#include <cbang/api/Statement.h>
 
 
 namespace cb {
@@ -44,15 +47,19 @@ namespace cb {
       API &api;
 
       std::string sql;
+      TemplatePtr tmpl;
+      StatementPtr statement;
       bool pass = false;
       JSON::ValuePtr fields;
-      std::string returnType;
+      Query::return_t returnCB;
+      bool stream = false;
 
     public:
       QueryHandler(API &api, const JSON::ValuePtr &config);
 
       void reply(
-        HTTP::Request &req, HTTP::Status status, Event::Buffer &buffer);
+        HTTP::Request &req, HTTP::Status status, Event::Buffer &buffer,
+        const std::string &contentType = "application/json");
 
       // From HTTP::RequestHandler
       bool operator()(HTTP::Request &req) override;
@@ -72,6 +72,7 @@ bool SessionHandler::operator()(HTTP::Request &req) {
   req.setSession(session);
 
   auto query = SmartPtr(new SessionQuery(api, &req, sql));
+  query->setTemplate(tmpl);
 
   auto cb = [this, query, session, &req] (
     HTTP::Status status, Event::Buffer &buffer) {
@@ -34,6 +34,9 @@
 
 #include <cbang/http/Request.h>
 #include <cbang/http/Method.h>
+#include <cbang/http/ConnIn.h>
+#include <cbang/http/Server.h>
+#include <cbang/json/Writer.h>
 
 using namespace std;
 using namespace cb;
@@ -41,14 +44,27 @@ using namespace cb::API;
 
 
 StatusHandler::StatusHandler(const JSON::ValuePtr &config) :
-  text(config->getString("text", "")) {
-  if (config->hasNumber("code"))
+  text(config->getString("text", "")),
+  timing(config->getBoolean("timing", false)) {
+  if (timing && !config->has("code")) code = HTTP_OK;
+  else if (config->hasNumber("code"))
     code = (HTTP::Status::enum_t)config->getU16("code");
   else code = HTTP::Status::parse(config->getString("code"));
 }
 
 
 bool StatusHandler::operator()(HTTP::Request &req) {
+  auto conn = req.getConnection();
+
+  // Per endpoint latency percentiles
+  if (timing && conn.isInstance<HTTP::ConnIn>()) {
+    auto &stats = conn.cast<HTTP::ConnIn>()->getServer().getRequestStats();
+    stats.write(*req.getJSONWriter());
+    req.reply(code);
+
+    return true;
+  }
+
   req.send(text.empty() ? code.toString() : text);
   req.reply(code);
 
@@ -41,6 +41,7 @@ namespace cb {
     class StatusHandler : public HTTP::RequestHandler {
       HTTP::Status code;
       std::string text;
+      bool timing = false;
 
     public:
       StatusHandler(HTTP::Status code, const std::string &text = "") :
@@ -0,0 +1,89 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "ZLibDeflater.h"
+
+#include <cbang/Exception.h>
+
+#include <cstring>
+
+using namespace std;
+using namespace cb;
+
+
+ZLibDeflater::ZLibDeflater(bool gzip, int level) {
+  memset(&zs, 0, sizeof(zs));
+
+  // 16 added to the window bits selects a gzip header and trailer
+  int ret = deflateInit2(&zs, level, Z_DEFLATED, gzip ? 15 + 16 : 15, 8,
+                         Z_DEFAULT_STRATEGY);
+  if (ret != Z_OK) THROW("Failed to initialize zlib: " << ret);
+}
+
+
+ZLibDeflater::~ZLibDeflater() {deflateEnd(&zs);}
+
+
+string ZLibDeflater::flush(const char *data, unsigned length) {
+  return deflate(data, length, Z_SYNC_FLUSH);
+}
+
+
+string ZLibDeflater::finish(const char *data, unsigned length) {
+  string out = deflate(data, length, Z_FINISH);
+  done = true;
+  return out;
+}
+
+
+string ZLibDeflater::deflate(const char *data, unsigned length, int mode) {
+  if (done) THROW("zlib stream already finished");
+
+  zs.next_in  = (Bytef *)data;
+  zs.avail_in = length;
+
+  string out;
+  char buffer[16384];
+
+  // Output is complete once deflate() leaves room in the buffer
+  do {
+    zs.next_out  = (Bytef *)buffer;
+    zs.avail_out = sizeof(buffer);
+
+    int ret = ::deflate(&zs, mode);
+    if (ret == Z_STREAM_ERROR) THROW("zlib deflate() failed");
+
+    out.append(buffer, sizeof(buffer) - zs.avail_out);
+  } while (!zs.avail_out);
+
+  return out;
+}
@@ -0,0 +1,67 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <string>
+
+#include <zlib.h>
+
+
+namespace cb {
+  /***
+   * Incremental zlib or gzip compression for streamed output.  Each call
+   * to flush() returns all the compressed data for its input, ending on
+   * a Z_SYNC_FLUSH boundary, so a receiver can decode it right away.
+   */
+  class ZLibDeflater {
+    z_stream zs;
+    bool done = false;
+
+  public:
+    ZLibDeflater(bool gzip, int level = Z_DEFAULT_COMPRESSION);
+    ~ZLibDeflater();
+
+    ZLibDeflater(const ZLibDeflater &) = delete;
+    ZLibDeflater &operator=(const ZLibDeflater &) = delete;
+
+    bool isDone() const {return done;}
+
+    /// Compress @param data and sync flush the output
+    std::string flush(const char *data, unsigned length);
+    /// Compress any remaining @param data and end the stream
+    std::string finish(const char *data = 0, unsigned length = 0);
+
+  protected:
+    std::string deflate(const char *data, unsigned length, int mode);
+  };
+}
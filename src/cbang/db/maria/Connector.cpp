@@ -30,14 +30,47 @@
 
 \******************************************************************************/
 
+
 #include "Connector.h"
 
 #include <cbang/config/Options.h>
+#include <cbang/event/Event.h>
+#include <cbang/json/Sink.h>
+#include <cbang/log/Logger.h>
+#include <cbang/time/Time.h>
+#include <cbang/time/Timer.h>
+#include <cbang/util/RateSet.h>
+#include <cbang/util/Metrics.h>
+
+#include <atomic>
 
+using namespace std;
 using namespace cb;
 using namespace cb::MariaDB;
 
 
+namespace {
+  atomic<unsigned> nextConnectorID(0);
+}
+
+
+Connector::Connector(Event::Base &base) : base(base) {
+  processEvent  = base.newEvent(this, &Connector::process, 0);
+  maintainEvent = base.newEvent(this, &Connector::maintain);
+
+  string labels = "connector=\"" + String(nextConnectorID++) + "\"";
+  Metrics::instance().addStats(
+    this, "db_pool", labels, [this] (JSON::Sink &sink) {writeStats(sink);});
+}
+
+
+Connector::~Connector() {
+  Metrics::instance().removeStats(this);
+  processEvent->del();
+  maintainEvent->del();
+}
+
+
 void Connector::addOptions(Options &options) {
   options.pushCategory("Database");
   options.addTarget("db-host", dbHost, "DB host name");
@@ -46,16 +79,73 @@ void Connector::addOptions(Options &options) {
   options.addTarget("db-name", dbName, "DB name");
   options.addTarget("db-port", dbPort, "DB port");
   options.addTarget("db-timeout", dbTimeout, "DB timeout");
+  options.addTarget("db-pool-min", poolMin, "Number of DB connections to "
+                    "keep open even when idle");
+  options.addTarget("db-pool-max", poolMax, "Maximum number of open DB "
+                    "connections");
+  options.addTarget("db-pool-idle-timeout", poolIdleTimeout, "Close idle DB "
+                    "connections, above db-pool-min, after this many seconds");
+  options.addTarget("db-pool-ping", poolPing, "Ping DB connections idle for "
+                    "at least this many seconds before reusing them.  Zero "
+                    "to disable.");
+  options.addTarget("db-pool-wait-timeout", poolWaitTimeout, "Fail requests "
+                    "which have waited this many seconds for a DB connection");
   options.popCategory();
 }
 
 
+double Connector::getUtilization() const {
+  return poolMax ? (double)active / poolMax : 0;
+}
+
+
 SmartPointer<MariaDB::EventDB> Connector::getConnection() {
-  // TODO Limit the total number of active connections
+  auto db = create();
+  db->connectNB(dbHost, dbUser, dbPass, dbName, dbPort);
+  return db;
+}
+
+
+void Connector::getConnection(callback_t cb) {
+  if (!maintainEvent->isPending()) {
+    maintainEvent->add(1);
+    warm();
+  }
 
+  if (waiters.empty() && (!idle.empty() || getTotal() < poolMax))
+    return checkout(cb, Timer::now());
+
+  LOG_DEBUG(4, "DB pool exhausted, " << waiters.size() << " waiting");
+  waiters.push_back(Waiter{cb, Timer::now()});
+}
+
+
+void Connector::release(const DBPtr &db) {
+  // Deferred so the connection is not reused from within its own callback
+  released.push_back(db);
+  schedule();
+}
+
+
+void Connector::writeStats(JSON::Sink &sink) const {
+  sink.beginDict();
+  sink.insert("active", active);
+  sink.insert("idle", idle.size());
+  sink.insert("connecting", connecting.size());
+  sink.insert("waiting", waiters.size());
+  sink.insert("max", poolMax);
+  sink.insert("utilization", getUtilization());
+  sink.insert("acquired", acquired);
+  sink.insert("waited", waited);
+  sink.insert("avg_wait", waited ? waitTime / waited : 0);
+  sink.insert("max_wait", maxWait);
+  sink.endDict();
+}
+
+
+SmartPointer<MariaDB::EventDB> Connector::create() {
   auto db = SmartPtr(new MariaDB::EventDB(base));
 
-  // Configure
   db->setConnectTimeout(dbTimeout);
   db->setReadTimeout(dbTimeout);
   db->setWriteTimeout(dbTimeout);
@@ -63,8 +153,158 @@ SmartPointer<MariaDB::EventDB> Connector::getConnection() {
   db->enableNonBlocking();
   db->setCharacterSet("utf8");
 
-  // Connect
-  db->connectNB(dbHost, dbUser, dbPass, dbName, dbPort);
-
   return db;
 }
+
+
+SmartPointer<MariaDB::EventDB> Connector::take(list<DBPtr> &l, EventDB *db) {
+  for (auto it = l.begin(); it != l.end(); it++)
+    if (it->get() == db) {
+      DBPtr ptr = *it;
+      l.erase(it);
+      return ptr;
+    }
+
+  THROW("DB connection not found");
+}
+
+
+bool Connector::isReusable(const DBPtr &db) const {
+  return db->isConnected() && !db->isPending() && !db->haveResult() &&
+    !db->isPaused();
+}
+
+
+void Connector::event(const string &key, double value) {
+  if (stats.isSet()) stats->event(key, value);
+}
+
+
+void Connector::checkout(callback_t cb, double since) {
+  double wait = Timer::now() - since;
+
+  active++;
+  acquired++;
+
+  if (0.001 <= wait) {
+    waited++;
+    waitTime += wait;
+    if (maxWait < wait) maxWait = wait;
+    event("db-pool-wait", wait);
+  }
+
+  if (!idle.empty()) {
+    // Most recently used first, so the oldest connections age out
+    Idle entry = idle.front();
+    idle.pop_front();
+    event("db-pool-hit");
+
+    if (poolPing && entry.since + poolPing <= Time::now())
+      return check(entry.db, cb);
+
+    return cb(entry.db);
+  }
+
+  event("db-pool-miss");
+  cb(getConnection());
+}
+
+
+void Connector::check(const DBPtr &db, callback_t cb) {
+  // The callback is owned by the connection, so it must not hold a reference
+  EventDB *ptr = db.get();
+  checking.push_back(db);
+
+  db->ping([this, ptr, cb] (EventDB::state_t state) {
+    auto db = take(checking, ptr);
+
+    if (state == EventDB::EVENTDB_DONE) ready.push_back(ready_t(db, cb));
+
+    else {
+      LOG_DEBUG(3, "DB ping failed: " << db->getError());
+      event("db-pool-ping-fail");
+      dead.push_back(db);
+      ready.push_back(ready_t(getConnection(), cb));
+    }
+
+    schedule();
+  });
+}
+
+
+void Connector::warm() {
+  for (unsigned i = getTotal(); i < poolMin; i++) {
+    auto db = create();
+    EventDB *ptr = db.get();
+    connecting.push_back(db);
+
+    db->connect([this, ptr] (EventDB::state_t state) {
+      auto db = take(connecting, ptr);
+      if (state == EventDB::EVENTDB_DONE) warmed.push_back(db);
+      else {
+        LOG_WARNING("DB connect failed: " << db->getError());
+        dead.push_back(db);
+      }
+      schedule();
+    }, dbHost, dbUser, dbPass, dbName, dbPort);
+  }
+}
+
+
+void Connector::schedule() {
+  if (!processEvent->isPending()) processEvent->activate();
+}
+
+
+void Connector::process() {
+  dead.clear();
+
+  while (!ready.empty()) {
+    auto r = ready.front();
+    ready.pop_front();
+    r.second(r.first);
+  }
+
+  while (!released.empty()) {
+    auto db = released.front();
+    released.pop_front();
+    active--;
+
+    if (isReusable(db)) {
+      db->setUnbuffered(false);
+      idle.push_front(Idle{db, Time::now()});
+
+    } else event("db-pool-evict");
+  }
+
+  for (auto &db: warmed) idle.push_back(Idle{db, Time::now()});
+  warmed.clear();
+
+  while (!waiters.empty() && (!idle.empty() || getTotal() < poolMax)) {
+    Waiter waiter = waiters.front();
+    waiters.pop_front();
+    checkout(waiter.cb, waiter.since);
+  }
+}
+
+
+void Connector::maintain() {
+  double now = Timer::now();
+
+  while (!waiters.empty() && waiters.front().since + poolWaitTimeout <= now) {
+    LOG_WARNING("Timed out waiting for DB connection");
+    event("db-pool-timeout");
+    auto cb = waiters.front().cb;
+    waiters.pop_front();
+    cb(0);
+  }
+
+  // Idle connections are ordered newest first
+  uint64_t cutoff = Time::now() - poolIdleTimeout;
+  while (!idle.empty() && poolMin < getTotal() && idle.back().since <= cutoff) {
+    idle.pop_back();
+    event("db-pool-evict");
+  }
+
+  warm();
+}
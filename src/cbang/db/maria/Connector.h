@@ -30,18 +30,31 @@
 
 \******************************************************************************/
 
+
 #pragma once
 
 #include "EventDB.h"
 
 #include <cbang/SmartPointer.h>
 
+#include <list>
+#include <functional>
+
 
 namespace cb {
   class Options;
+  class RateSet;
   namespace Event {class Base;}
+  namespace JSON {class Sink;}
 
   namespace MariaDB {
+    /***
+     * Hands out pooled, nonblocking EventDB connections.  At most
+     * db-pool-max connections are open at once, further requests wait in
+     * FIFO order.  Connections idle longer than db-pool-ping are checked
+     * with a ping before reuse.  Pool stats are exported through Metrics
+     * as db_pool_*.
+     */
     class Connector {
       Event::Base &base;
 
@@ -52,12 +65,90 @@ namespace cb {
       uint32_t dbPort    = 3306;
       unsigned dbTimeout = 5;
 
+      unsigned poolMin         = 0;
+      unsigned poolMax         = 32;
+      unsigned poolIdleTimeout = 300;
+      unsigned poolPing        = 30;
+      unsigned poolWaitTimeout = 10;
+
+    public:
+      typedef SmartPointer<MariaDB::EventDB> DBPtr;
+      typedef std::function<void (const DBPtr &db)> callback_t;
+
+    protected:
+      SmartPointer<RateSet> stats;
+
+      struct Idle {
+        DBPtr db;
+        uint64_t since;
+      };
+      std::list<Idle> idle;
+
+      struct Waiter {
+        callback_t cb;
+        double since;
+      };
+      std::list<Waiter> waiters;
+
+      typedef std::pair<DBPtr, callback_t> ready_t;
+      std::list<ready_t> ready;
+      std::list<DBPtr> checking;
+      std::list<DBPtr> connecting;
+      std::list<DBPtr> released;
+      std::list<DBPtr> warmed;
+      std::list<DBPtr> dead;
+
+      unsigned active = 0;
+
+      uint64_t acquired = 0;
+      uint64_t waited   = 0;
+      double waitTime   = 0;
+      double maxWait    = 0;
+
+      SmartPointer<Event::Event> processEvent;
+      SmartPointer<Event::Event> maintainEvent;
+
     public:
-      Connector(Event::Base &base) : base(base) {}
+      Connector(Event::Base &base);
+      ~Connector();
 
       void addOptions(Options &options);
 
-      SmartPointer<MariaDB::EventDB> getConnection();
+      const SmartPointer<RateSet> &getStats() const {return stats;}
+      void setStats(const SmartPointer<RateSet> &stats) {this->stats = stats;}
+
+      unsigned getActive() const {return active;}
+      unsigned getIdle() const {return idle.size();}
+      unsigned getWaiting() const {return waiters.size();}
+      unsigned getTotal() const {return active + idle.size() + connecting.size();}
+      double getUtilization() const;
+
+      /// Open a new connection which is not managed by the pool
+      DBPtr getConnection();
+
+      /***
+       * Call @param cb with a pooled connection, possibly after waiting for
+       * one to be released.  A null pointer is passed if none became
+       * available within db-pool-wait-timeout.
+       */
+      void getConnection(callback_t cb);
+
+      /// Return a connection obtained from getConnection(callback_t)
+      void release(const DBPtr &db);
+
+      void writeStats(JSON::Sink &sink) const;
+
+    protected:
+      DBPtr create();
+      static DBPtr take(std::list<DBPtr> &l, EventDB *db);
+      bool isReusable(const DBPtr &db) const;
+      void event(const std::string &key, double value = 1);
+      void checkout(callback_t cb, double since);
+      void check(const DBPtr &db, callback_t cb);
+      void warm();
+      void schedule();
+      void process();
+      void maintain();
     };
   }
 }
@@ -325,7 +325,7 @@ void DB::useResult() {
   assertNotHaveResult();
 
   res = mysql_use_result(db);
-  if (!res) RAISE_DB_ERROR("Failed to use result");
+  if (!res && mysql_field_count(db)) RAISE_DB_ERROR("Failed to use result");
 
   stored = false;
 }
@@ -715,6 +715,7 @@ void DB::raiseError(const string &msg, bool withDBError) const {
 
 
 unsigned DB::getWarningCount() const {return mysql_warning_count(db);}
+unsigned long DB::getThreadID() const {return mysql_thread_id(db);}
 
 
 void DB::assertConnected() const {
@@ -221,6 +221,7 @@ namespace cb {
       unsigned getErrorNumber() const;
       void raiseError(const std::string &msg, bool withDBError = true) const;
       unsigned getWarningCount() const;
+      unsigned long getThreadID() const;
 
       // Assertions
       void assertConnected() const;
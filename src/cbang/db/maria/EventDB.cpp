@@ -37,6 +37,7 @@
 #include <cbang/event/Event.h>
 
 #include <cbang/Catch.h>
+#include <cbang/String.h>
 #include <cbang/log/Logger.h>
 #include <cbang/json/Value.h>
 
@@ -99,15 +100,120 @@ void EventDB::close(callback_t cb) {
 void EventDB::query(callback_t cb, const string &s,
                     const SmartPointer<const JSON::Value> &dict) {
   string query = dict.isNull() ? s : format(s, dict->getDict());
-  auto queryCB = SmartPtr(new QueryCallback(*this, cb, query));
+  start(new QueryCallback(*this, cb, query));
+}
+
+
+void EventDB::execute(callback_t cb, const string &sql, const string &args) {
+  // The server drops prepared statements when the connection is reset
+  if (statementsThread != getThreadID()) {
+    clearStatements();
+    statementsThread = getThreadID();
+  }
+
+  auto it = statements.find(sql);
+  bool prepared = it != statements.end();
+  string name;
+
+  if (prepared) {
+    name = it->second.name;
+    statementUse.splice(statementUse.begin(), statementUse, it->second.use);
+
+  } else name = allocStatement();
+
+  string prepare = "PREPARE " + name + " FROM " + format(sql) + ";";
+  string query = "EXECUTE " + name;
+  if (!args.empty()) query += " USING " + args;
+
+  LOG_DEBUG(5, "Statement " << name << ": " << sql);
+
+  // Cache the statement once its results show PREPARE succeeded
+  bool pending = !prepared;
+  unsigned long thread = statementsThread;
+  auto wrapped = [this, cb, sql, name, pending, thread] (state_t state)
+    mutable {
+    if (pending && state != EVENTDB_RETRY && thread == statementsThread) {
+      pending = false;
+      if (state == EVENTDB_ERROR) freeNames.push_back(name);
+      else addStatement(sql, name);
+    }
+
+    cb(state);
+  };
+
+  auto queryCB = SmartPtr(new QueryCallback(*this, wrapped, prepared ? query :
+                                            prepare + query));
+  if (prepared) queryCB->setPrepare(prepare);
+  start(queryCB);
+}
+
+
+void EventDB::clearStatements() {
+  statements.clear();
+  statementUse.clear();
+  freeNames.clear();
+  statementNames = 0;
+}
+
+
+string EventDB::allocStatement() {
+  if (!freeNames.empty()) {
+    string name = freeNames.back();
+    freeNames.pop_back();
+    return name;
+  }
 
+  if (statementNames < maxStatements || statements.empty())
+    return String::printf("cb_stmt_%u", statementNames++);
+
+  // Evict the least recently used.  Preparing again under its name makes
+  // the server deallocate it, so at most maxStatements exist.
+  auto it = statements.find(statementUse.back());
+  string name = it->second.name;
+  statements.erase(it);
+  statementUse.pop_back();
+
+  LOG_DEBUG(5, "Evicting statement " << name);
+
+  return name;
+}
+
+
+void EventDB::addStatement(const string &sql, const string &name) {
+  auto it = statements.find(sql);
+
+  // Prepared concurrently under two names, keep one
+  if (it != statements.end()) {
+    freeNames.push_back(name);
+    return;
+  }
+
+  statementUse.push_front(sql);
+  statements[sql] = Statement{name, statementUse.begin()};
+}
+
+
+void EventDB::start(const SmartPointer<QueryCallback> &queryCB) {
   // By wrapping the event callback in a lambda the SmartPointer is kept alive
   auto reply =
     [queryCB] (Event::Event &event, int fd, unsigned flags) {
       (*queryCB)(event, fd, flags);
     };
 
-  if (isPending() || !queryCB->next()) newEvent(reply);
+  if (isPending() || !queryCB->next()) {
+    if (isPending()) newEvent(reply);
+    else event = base.newEvent(reply, 0); // Paused
+  }
+}
+
+
+void EventDB::resume() {
+  paused = false;
+
+  if (suspended) {
+    suspended = false;
+    event->activate();
+  }
 }
 
 
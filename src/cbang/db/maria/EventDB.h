@@ -37,6 +37,9 @@
 #include <cbang/event/Base.h>
 
 #include <functional>
+#include <map>
+#include <list>
+#include <vector>
 
 namespace cb {
   namespace JSON {class Value;}
@@ -48,6 +51,24 @@ namespace cb {
       Event::Base &base;
       SmartPointer<Event::Event> event;
 
+      bool unbuffered = false;
+      bool paused     = false;
+      bool suspended  = false;
+
+      // Prepared statements by SQL, least recently used evicted
+      struct Statement {
+        std::string name;
+        std::list<std::string>::iterator use;
+      };
+
+      typedef std::map<std::string, Statement> statements_t;
+      statements_t statements;
+      std::list<std::string> statementUse; // Most recent first
+      std::vector<std::string> freeNames;  // Of statements which failed
+      unsigned statementNames = 0;
+      unsigned maxStatements = 128;
+      unsigned long statementsThread = 0;
+
     public:
       typedef enum {
         EVENTDB_ERROR,
@@ -68,6 +89,15 @@ namespace cb {
 
       unsigned getEventFlags() const;
 
+      /// Fetch rows from the server as they are read, see pause()
+      bool isUnbuffered() const {return unbuffered;}
+      void setUnbuffered(bool x) {unbuffered = x;}
+
+      /// Stop delivering query rows after the current one until resume()
+      void pause() {paused = true;}
+      bool isPaused() const {return paused;}
+      void resume();
+
       void connect(callback_t cb,
                    const std::string &host = "localhost",
                    const std::string &user = "root",
@@ -116,6 +146,30 @@ namespace cb {
         query(std::bind(member, obj, _1), s, dict);
       }
 
+      /***
+       * Run @param sql as a server-side prepared statement.  The statement
+       * is prepared on its first use on this connection and cached by SQL
+       * once that succeeds.  @param args is the comma separated list of SQL
+       * literals bound to the statement's ``?`` parameters.
+       */
+      void execute(callback_t cb, const std::string &sql,
+                   const std::string &args = std::string());
+
+      template <class T>
+      void execute(T *obj, typename Callback<T>::member_t member,
+                   const std::string &sql,
+                   const std::string &args = std::string()) {
+        using namespace std::placeholders;
+        execute(std::bind(member, obj, _1), sql, args);
+      }
+
+      unsigned getStatementCount() const {return statements.size();}
+      void clearStatements();
+
+      /// Bounds the cached statements, see the server's max_prepared_stmt_count
+      unsigned getMaxStatements() const {return maxStatements;}
+      void setMaxStatements(unsigned max) {maxStatements = max ? max : 1;}
+
       // From DB
       using DB::connect;
       using DB::close;
@@ -129,6 +183,9 @@ namespace cb {
       void addEvent() const;
 
       void callback(callback_t cb);
+      std::string allocStatement();
+      void addStatement(const std::string &sql, const std::string &name);
+      void start(const SmartPointer<QueryCallback> &queryCB);
 
       friend class QueryCallback;
     };
@@ -128,6 +128,16 @@ bool Field::isReal() const {
 }
 
 
+bool Field::isDecimal() const {
+  return getType() == TYPE_DECIMAL || getType() == TYPE_NEWDECIMAL;
+}
+
+
+bool Field::isUnsigned() const {
+  return field->flags & UNSIGNED_FLAG;
+}
+
+
 bool Field::isBit() const {
   return getType() == TYPE_BIT;
 }
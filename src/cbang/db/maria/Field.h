@@ -102,6 +102,8 @@ namespace cb {
       bool isInteger() const;
       bool isReal() const;
       bool isNumber() const {return isInteger() || isReal();}
+      bool isDecimal() const;
+      bool isUnsigned() const;
       bool isBit() const;
       bool isTime() const;
       bool isBlob() const;
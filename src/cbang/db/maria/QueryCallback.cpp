@@ -69,7 +69,8 @@ bool QueryCallback::next() {
 
   case STATE_QUERY:
     state = STATE_STORE;
-    if (!db.storeResultNB()) return false;
+    if (db.isUnbuffered()) db.useResult();
+    else if (!db.storeResultNB()) return false;
 
   case STATE_STORE:
     if (!db.haveResult()) {
@@ -85,6 +86,14 @@ bool QueryCallback::next() {
   case STATE_FETCH:
     while (db.haveRow()) {
       call(EventDB::EVENTDB_ROW);
+
+      if (db.isPaused()) {
+        LOG_DEBUG(5, "Query paused");
+        state = STATE_PAUSED;
+        db.suspended = true;
+        return false;
+      }
+
       if (!db.fetchRowNB()) return false;
     }
     state = STATE_FREE;
@@ -108,6 +117,11 @@ bool QueryCallback::next() {
     call(EventDB::EVENTDB_DONE);
     return true;
 
+  case STATE_PAUSED:
+    state = STATE_FETCH;
+    if (!db.fetchRowNB()) return false;
+    return next();
+
   default: THROW("Invalid state");
   }
 }
@@ -115,8 +129,9 @@ bool QueryCallback::next() {
 
 void QueryCallback::operator()(Event::Event &, int, unsigned flags) {
   try {
-    if (db.continueNB(db.eventFlagsToDBReady(flags))) {
-      if (!next()) db.renewEvent();
+    // Nothing is pending when resumed after a pause
+    if (!db.isPending() || db.continueNB(db.eventFlagsToDBReady(flags))) {
+      if (!next() && db.isPending()) db.renewEvent();
     } else db.addEvent();
 
   } catch (const Exception &e) {
@@ -125,7 +140,17 @@ void QueryCallback::operator()(Event::Event &, int, unsigned flags) {
       LOG_WARNING("DB deadlock detected, retrying");
       call(EventDB::EVENTDB_RETRY);
       state = STATE_START;
-      if (!next()) db.renewEvent();
+      if (!next() && db.isPending()) db.renewEvent();
+
+    } else if (db.getErrorNumber() == ER_UNKNOWN_STMT_HANDLER &&
+               !prepare.empty()) {
+      // Prepared statements do not survive a reconnect
+      LOG_DEBUG(3, "DB prepared statement lost, preparing again");
+      call(EventDB::EVENTDB_RETRY);
+      query = prepare + query;
+      prepare.clear();
+      state = STATE_START;
+      if (!next() && db.isPending()) db.renewEvent();
 
     } else {
       LOG_DEBUG(5, e);
@@ -41,6 +41,7 @@ namespace cb {
       EventDB &db;
       EventDB::callback_t cb;
       std::string query;
+      std::string prepare;
       unsigned retry;
 
       typedef enum {
@@ -48,6 +49,7 @@ namespace cb {
         STATE_QUERY,
         STATE_STORE,
         STATE_FETCH,
+        STATE_PAUSED,
         STATE_FREE,
         STATE_NEXT,
         STATE_DONE,
@@ -59,6 +61,9 @@ namespace cb {
       QueryCallback(EventDB &db, EventDB::callback_t cb,
                     const std::string &query, unsigned retry = 5);
 
+      /// Prepend @param prepare and retry if the statement handle was lost
+      void setPrepare(const std::string &prepare) {this->prepare = prepare;}
+
       void call(EventDB::state_t state);
       bool next();
       void operator()(Event::Event &event, int fd, unsigned flags);
@@ -42,6 +42,7 @@
 #include <cbang/net/Socket.h>
 #include <cbang/os/SysError.h>
 #include <cbang/dns/Base.h>
+#include <cbang/time/Clock.h>
 
 using namespace std;
 using namespace cb;
@@ -59,6 +60,13 @@ namespace {
     counts.insert(pair<int, unsigned>(priority, 0)).first->second++;
     return 0;
   }
+
+
+  // Cache the clocks while this thread runs the loop
+  struct ClockCache {
+    ClockCache() {Clock::update();}
+    ~ClockCache() {Clock::clearCache();}
+  };
 }
 
 bool Base::_threadsEnabled = false;
@@ -127,21 +135,27 @@ void Base::countActiveEventsByPriority(map<int, unsigned> &counts) const {
 
 
 void Base::dispatch() {
+  ClockCache cache;
   int ret = event_base_dispatch(base);
   if (ret < 0) THROW("Dispatch failed: " << SysError());
   if (ret == 1) THROW("No pending events");
 }
 
 
-void Base::loop() {if (event_base_loop(base, 0)) THROW("Loop failed");}
+void Base::loop() {
+  ClockCache cache;
+  if (event_base_loop(base, 0)) THROW("Loop failed");
+}
 
 
 void Base::loopOnce() {
+  ClockCache cache;
   if (event_base_loop(base, EVLOOP_ONCE)) THROW("Loop once failed");
 }
 
 
 bool Base::loopNonBlock() {
+  ClockCache cache;
   int ret = event_base_loop(base, EVLOOP_NONBLOCK);
   if (ret == -1) THROW("Loop nonblock failed");
   return ret == 0;
@@ -31,6 +31,7 @@
 \******************************************************************************/
 
 #include "Buffer.h"
+#include "FileSegment.h"
 
 #include <cbang/Exception.h>
 #include <cbang/Catch.h>
@@ -311,6 +312,12 @@ void Buffer::addFile(const string &path) {
 }
 
 
+void Buffer::add(const FileSegment &seg, uint64_t offset, uint64_t length) {
+  if (evbuffer_add_file_segment(evb, seg.getSegment(), offset, length))
+    THROW("Failed to add file segment to buffer");
+}
+
+
 void Buffer::prepend(const Buffer &buf) {
   if (evbuffer_prepend_buffer(evb, buf.getBuffer()))
     THROW("Prepend buffer failed");
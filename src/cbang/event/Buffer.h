@@ -54,6 +54,8 @@ struct iovec;
 
 namespace cb {
   namespace Event {
+    class FileSegment;
+
     class Buffer {
     public:
       typedef std::function<void (int added, int deleted, int orig)> callback_t;
@@ -120,6 +122,7 @@ namespace cb {
       void add(const char *s);
       void add(const std::string &s);
       void addFile(const std::string &path);
+      void add(const FileSegment &seg, uint64_t offset, uint64_t length);
 
       void prepend(const Buffer &buf);
       void prepend(const char *data, unsigned length);
@@ -33,12 +33,20 @@
 #include "ConcurrentPool.h"
 
 #include <cbang/Catch.h>
+#include <cbang/json/Sink.h>
 
 using namespace cb::Event;
 using namespace cb;
 using namespace std;
 
 
+namespace {
+  // The pool and worker the current thread belongs to, if any
+  thread_local const void *localPool = 0;
+  thread_local unsigned localWorker = 0;
+}
+
+
 bool ConcurrentPool::Task::shouldShutdown() {
   return Thread::current().shouldShutdown();
 }
@@ -46,43 +54,71 @@ bool ConcurrentPool::Task::shouldShutdown() {
 
 ConcurrentPool::ConcurrentPool(Base &base, unsigned size) :
   ThreadPool(size), base(base),
-  event(base.newEvent(this, &ConcurrentPool::complete)) {
+  event(base.newEvent(this, &ConcurrentPool::complete)), pending(0),
+  active(0), numCompleted(0), sleeping(0), steals(0),
+  completionPending(false) {
   if (!Base::threadsEnabled())
     THROW("Cannot use Event::ConcurrentPool without threads enabled.  "
           "Call Event::Base::enableThreads() before creating Event::Base.");
+
+  // At least one queue so tasks can be submitted to an empty pool
+  for (unsigned i = 0; i < size || !i; i++) workers.push_back(new Worker);
 }
 
 
 ConcurrentPool::~ConcurrentPool() {}
 
 
-unsigned ConcurrentPool::getNumReady() const {
-  SmartLock lock(this);
-  return ready.size();
+void ConcurrentPool::getQueueLengths(vector<unsigned> &lengths) const {
+  for (auto &worker: workers) lengths.push_back(worker->length);
 }
 
 
-unsigned ConcurrentPool::getNumActive() const {
-  SmartLock lock(this);
-  return active;
-}
-
+void ConcurrentPool::writeStats(JSON::Sink &sink) const {
+  sink.beginDict();
+  sink.insert("ready",     getNumReady());
+  sink.insert("active",    getNumActive());
+  sink.insert("completed", getNumCompleted());
+  sink.insert("steals",    (double)getNumSteals());
+  sink.insert("injected",  (unsigned)injected.length);
+
+  sink.insertList("workers");
+  for (auto &worker: workers) {
+    sink.appendDict();
+    sink.insert("ready",    (unsigned)worker->length);
+    sink.insert("executed", (double)worker->executed);
+    sink.insert("stolen",   (double)worker->stolen);
+    sink.endDict();
+  }
+  sink.endList();
 
-unsigned ConcurrentPool::getNumCompleted() const {
-  SmartLock lock(this);
-  return completed.size();
+  sink.endDict();
 }
 
 
 void ConcurrentPool::submit(const SmartPointer<Task> &task) {
-  SmartLock lock(this);
-  ready.push(task);
-  Condition::signal();
+  // Workers keep their own subtasks, others are injected
+  Queue &queue = localPool == this ? *workers[localWorker] : injected;
+
+  {
+    SmartLock lock(&queue);
+    queue.ready[task->getPriority()].push_back(task);
+    queue.length++;
+    pending++;
+  }
+
+  // Only take the pool lock if a worker may be sleeping
+  if (sleeping) {
+    SmartLock lock(this);
+    Condition::signal();
+  }
 }
 
 
 void ConcurrentPool::stop() {
   ThreadPool::stop();
+
+  SmartLock lock(this);
   Condition::broadcast();
 }
 
@@ -93,55 +129,165 @@ void ConcurrentPool::join() {
 }
 
 
-void ConcurrentPool::run() {
-  SmartLock lock(this);
+unsigned ConcurrentPool::getWorkerIndex() const {
+  unsigned index = 0;
 
-  while (!Thread::current().shouldShutdown()) {
-    if (ready.empty()) Condition::wait();
-    if (Thread::current().shouldShutdown()) break;
+  for (auto it = begin(); it != end(); it++, index++)
+    if (it->get() == &Thread::current()) return index;
+
+  THROW("Not a worker thread");
+}
 
-    // Get Task from ready queue
-    if (ready.empty()) continue;
-    SmartPointer<Task> task = ready.top();
-    ready.pop();
-    active++;
 
-    {
-      SmartUnlock unlock(this);
+SmartPointer<ConcurrentPool::Task>
+ConcurrentPool::take(Queue &queue, bool newest) {
+  // The caller holds the queue's lock
+  if (queue.ready.empty()) return 0;
 
-      // Run Task
-      try {
-        task->run();
+  // Newest or oldest Task of the highest priority
+  auto it = queue.ready.begin();
+  SmartPointer<Task> task;
 
-      } catch (const Exception &e) {
-        task->setException(e);
+  if (newest) {
+    task = it->second.back();
+    it->second.pop_back();
+
+  } else {
+    task = it->second.front();
+    it->second.pop_front();
+  }
+
+  if (it->second.empty()) queue.ready.erase(it);
+
+  queue.length--;
+  pending--;
+
+  return task;
+}
 
-      } catch (const exception &e) {
-        task->setException(string(e.what()));
 
-      } catch (...) {
-        task->setException(string("Unknown exception"));
-      }
+SmartPointer<ConcurrentPool::Task> ConcurrentPool::pop(Worker &worker) {
+  // Own subtasks LIFO unless an injected Task is more urgent
+  bool own = false;
+  int priority = 0;
+
+  if (worker.length) {
+    SmartLock lock(&worker);
+
+    if (!worker.ready.empty()) {
+      own = true;
+      priority = worker.ready.begin()->first;
     }
+  }
+
+  if (injected.length) {
+    SmartLock lock(&injected);
 
-    // Put Task in completed queue
-    completed.push(task);
-    if (!event->isPending()) event->activate();
-    active--;
+    if (!injected.ready.empty() &&
+        (!own || priority < injected.ready.begin()->first))
+      return take(injected, false);
   }
+
+  if (!own) return 0;
+
+  SmartLock lock(&worker);
+  return take(worker, true);
+}
+
+
+SmartPointer<ConcurrentPool::Task> ConcurrentPool::steal(unsigned index) {
+  for (unsigned i = 1; i < workers.size(); i++) {
+    Worker &victim = *workers[(index + i) % workers.size()];
+    if (!victim.length) continue;
+
+    SmartLock lock(&victim);
+    SmartPointer<Task> task = take(victim, false);
+    if (task.isNull()) continue;
+
+    steals++;
+    workers[index]->stolen++;
+
+    return task;
+  }
+
+  return 0;
+}
+
+
+void ConcurrentPool::execute(Worker &worker, const SmartPointer<Task> &task) {
+  active++;
+
+  try {
+    task->run();
+
+  } catch (const Exception &e) {
+    task->setException(e);
+
+  } catch (const exception &e) {
+    task->setException(string(e.what()));
+
+  } catch (...) {
+    task->setException(string("Unknown exception"));
+  }
+
+  // Count before publishing so complete() never subtracts uncounted Tasks
+  worker.executed++;
+  numCompleted++;
+
+  {
+    SmartLock lock(&worker);
+    worker.completed.push_back(task);
+  }
+
+  active--;
+
+  // One event activation per batch of completions
+  if (!completionPending.exchange(true)) event->activate();
+}
+
+
+void ConcurrentPool::run() {
+  unsigned index = getWorkerIndex();
+  Worker &worker = *workers[index];
+
+  localPool = this;
+  localWorker = index;
+
+  while (!Thread::current().shouldShutdown()) {
+    SmartPointer<Task> task = pop(worker);
+    if (task.isNull()) task = steal(index);
+    if (task.isSet()) {execute(worker, task); continue;}
+
+    // Sleep until work is submitted
+    SmartLock lock(this);
+    sleeping++;
+    while (!pending && !Thread::current().shouldShutdown())
+      Condition::wait();
+    sleeping--;
+  }
+
+  localPool = 0;
 }
 
 
 void ConcurrentPool::complete() {
-  SmartLock lock(this);
+  completionPending = false;
+
+  // Collect this batch of completed tasks in priority order
+  queue_t completed;
+
+  for (auto &worker: workers) {
+    SmartLock lock(worker.get());
+    for (auto &task: worker->completed) completed.push(task);
+    worker->completed.clear();
+  }
+
+  numCompleted -= completed.size();
 
-  // Dequeue completed tasks
   while (!completed.empty()) {
     SmartPointer<Task> task = completed.top();
     completed.pop();
 
-    SmartUnlock unlock(this);
-
     try {
       if (task->getFailed()) task->error(task->getException());
       else task->success();
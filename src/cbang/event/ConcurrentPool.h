@@ -42,11 +42,31 @@
 #include <cbang/time/Time.h>
 
 #include <queue>
+#include <deque>
+#include <map>
+#include <vector>
+#include <atomic>
 #include <functional>
 
 
 namespace cb {
+  namespace JSON {class Sink;}
+
   namespace Event {
+    /**
+     * Runs Tasks on a pool of threads and delivers their results back on the
+     * Event::Base thread.
+     *
+     * Tasks submitted from outside the pool go to a shared FIFO injection
+     * queue.  Each worker also owns a deque of ready Tasks per priority
+     * class, holding the subtasks it submitted itself.  Workers take their
+     * own newest Task of the highest priority unless the oldest injected
+     * Task has a higher priority and, when out of work, steal the oldest
+     * Task of the highest priority from another worker.  Priority is
+     * therefore honored per worker rather than strictly across the whole
+     * pool.  Completed Tasks are handed back to the event loop in batches,
+     * in priority order.
+     */
     class ConcurrentPool : protected ThreadPool, protected Condition {
     public:
       class Task {
@@ -59,6 +79,8 @@ namespace cb {
         Task(int priority) : priority(priority) {}
         virtual ~Task() {}
 
+        int getPriority() const {return priority;}
+
         bool getFailed() const {return failed;}
         void setException(const Exception &e) {this->e = e; failed = true;}
         const Exception &getException() const {return e;}
@@ -162,9 +184,34 @@ namespace cb {
       typedef std::priority_queue<SmartPointer<Task>,
                                   std::vector<SmartPointer<Task> >,
                                   TaskPtrCompare> queue_t;
-      unsigned active = 0;
-      queue_t ready;
-      queue_t completed;
+      typedef std::deque<SmartPointer<Task> > deque_t;
+
+      struct Queue : public Mutex {
+        // Priority classes, highest first.  Oldest Task at the front.
+        std::map<int, deque_t, std::greater<int> > ready;
+        std::atomic<unsigned> length;
+
+        Queue() : length(0) {}
+      };
+
+      struct Worker : public Queue {
+        std::vector<SmartPointer<Task> > completed;
+
+        std::atomic<uint64_t> executed;
+        std::atomic<uint64_t> stolen;
+
+        Worker() : executed(0), stolen(0) {}
+      };
+
+      Queue injected;
+      std::vector<SmartPointer<Worker> > workers;
+
+      std::atomic<unsigned> pending;
+      std::atomic<unsigned> active;
+      std::atomic<unsigned> numCompleted;
+      std::atomic<unsigned> sleeping;
+      std::atomic<uint64_t> steals;
+      std::atomic<bool> completionPending;
 
     public:
       ConcurrentPool(Base &base, unsigned size);
@@ -172,9 +219,14 @@ namespace cb {
 
       void setEventPriority(int priority) {event->setPriority(priority);}
 
-      unsigned getNumReady() const;
-      unsigned getNumActive() const;
-      unsigned getNumCompleted() const;
+      unsigned getNumWorkers() const {return workers.size();}
+      unsigned getNumReady() const {return pending;}
+      unsigned getNumActive() const {return active;}
+      unsigned getNumCompleted() const {return numCompleted;}
+      uint64_t getNumSteals() const {return steals;}
+      void getQueueLengths(std::vector<unsigned> &lengths) const;
+
+      void writeStats(JSON::Sink &sink) const;
 
       void submit(const SmartPointer<Task> &task);
 
@@ -193,6 +245,12 @@ namespace cb {
       void join() override;
 
     protected:
+      unsigned getWorkerIndex() const;
+      SmartPointer<Task> take(Queue &queue, bool newest);
+      SmartPointer<Task> pop(Worker &worker);
+      SmartPointer<Task> steal(unsigned index);
+      void execute(Worker &worker, const SmartPointer<Task> &task);
+
       void run() override;
 
       void complete();
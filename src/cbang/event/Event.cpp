@@ -33,6 +33,7 @@
 #include "Event.h"
 
 #include <cbang/Catch.h>
+#include <cbang/time/Clock.h>
 #include <cbang/time/Timer.h>
 #include <cbang/log/Logger.h>
 #include <cbang/debug/Debugger.h>
@@ -142,6 +143,7 @@ void Event::activate(int flags) {event_active(e, flags, 0);}
 void Event::call(int fd, short flags) {
   LOG_DEBUG(0 <= fd ? 5 : 6, "Event callback fd=" << fd << " flags=" << flags);
   auto self = SmartPtr(this); // Don't deallocate while in callback
+  Clock::update(); // libevent has no per pass hook
   TRY_CATCH_ERROR(cb(*this, fd, flags));
   if (!isPending()) endOfLife();
 }
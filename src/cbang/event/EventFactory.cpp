@@ -45,7 +45,7 @@ SmartPointer<cb::Event::Event> EventFactory::newEvent(
 
 SmartPointer<cb::Event::Event> EventFactory::newEvent(
   socket_t fd, callback_t cb, unsigned flags) {
-  return new Event(base, fd, cb, flags);
+  return SmartNew<Event>(base, fd, cb, flags);
 }
 
 
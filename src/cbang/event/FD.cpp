@@ -88,12 +88,12 @@ FD::LTOPtr FD::read(const SmartPointer<Transfer> transfer) {
 
 FD::LTOPtr FD::read(Transfer::cb_t cb, const Buffer &buffer, unsigned length,
               const string &until) {
-  return read(new TransferRead(fd, ssl, cb, buffer, length, until));
+  return read(SmartNew<TransferRead>(fd, ssl, cb, buffer, length, until));
 }
 
 
 FD::LTOPtr FD::canRead(Transfer::cb_t cb) {
-  return read(new Transfer(fd, ssl, cb));
+  return read(SmartNew<Transfer>(fd, ssl, cb));
 }
 
 
@@ -106,12 +106,12 @@ FD::LTOPtr FD::write(const SmartPointer<Transfer> transfer) {
 
 
 FD::LTOPtr FD::write(Transfer::cb_t cb, const Buffer &buffer) {
-  return write(new TransferWrite(fd, ssl, cb, buffer));
+  return write(SmartNew<TransferWrite>(fd, ssl, cb, buffer));
 }
 
 
 FD::LTOPtr FD::canWrite(Transfer::cb_t cb) {
-  return write(new Transfer(fd, ssl, cb));
+  return write(SmartNew<Transfer>(fd, ssl, cb));
 }
 
 
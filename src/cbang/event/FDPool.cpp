@@ -33,11 +33,24 @@
 #include "FDPool.h"
 #include "FDPoolEPoll.h"
 #include "FDPoolEvent.h"
+#include "FDPoolIOUring.h"
 
 #include <cbang/os/SystemUtilities.h>
+#include <cbang/os/SystemInfo.h>
+#include <cbang/json/Sink.h>
+#include <cbang/log/Logger.h>
+#include <cbang/util/Metrics.h>
+
+#include <atomic>
 
 using namespace cb::Event;
 using namespace cb;
+using namespace std;
+
+
+namespace {
+  atomic<unsigned> nextPoolID(0);
+}
 
 
 SmartPointer<FDPool> FDPool::create(Base &base) {
@@ -51,11 +64,52 @@ SmartPointer<FDPool> FDPool::create(Base &base) {
 #endif
   }
 
-  if (String::toLower(type) == "event") return new FDPoolEvent(base);
+  string name = String::toLower(type);
+
+#ifdef HAVE_LIBURING
+  if (name == "iouring") {
+    if (FDPoolIOUring::isSupported()) return new FDPoolIOUring(base);
+    LOG_WARNING("io_uring not supported by this kernel, falling back");
+
+#ifdef HAVE_EPOLL
+    name = "epoll";
+#else
+    name = "event";
+#endif
+  }
+#endif // HAVE_LIBURING
+
+  if (name == "event") return new FDPoolEvent(base);
 
 #ifdef HAVE_EPOLL
-  if (String::toLower(type) == "epoll") return new FDPoolEPoll(base);
+  if (name == "epoll") {
+    // 0 threads means one per CPU
+    unsigned threads = 1;
+    const char *s = SystemUtilities::getenv("CBANG_EVENT_POOL_THREADS");
+    if (s) threads = String::parseU32(s);
+    if (!threads) threads = SystemInfo::instance().getCPUCount();
+
+    return new FDPoolEPoll(base, threads);
+  }
 #endif
 
   THROW("Unsupported event pool type: " << type);
 }
+
+
+void FDPool::writeStats(JSON::Sink &sink) const {
+  sink.beginDict();
+  sink.insert("read", getReadRate().get());
+  sink.insert("write", getWriteRate().get());
+  sink.endDict();
+}
+
+
+void FDPool::addMetrics() {
+  string labels = "pool=\"" + String(nextPoolID++) + "\"";
+  Metrics::instance().addStats(
+    this, "fdpool", labels, [this] (JSON::Sink &sink) {writeStats(sink);});
+}
+
+
+void FDPool::removeMetrics() {Metrics::instance().removeStats(this);}
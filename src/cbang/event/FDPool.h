@@ -39,6 +39,8 @@
 
 
 namespace cb {
+  namespace JSON {class Sink;}
+
   namespace Event {
     class Base;
 
@@ -59,6 +61,13 @@ namespace cb {
       virtual void write(const SmartPointer<Transfer> &t) = 0;
       virtual void open(FD &fd) = 0;
       virtual void flush(int fd) = 0;
+      virtual void writeStats(JSON::Sink &sink) const;
+
+    protected:
+      /// Export writeStats() through Metrics, call once fully constructed
+      void addMetrics();
+      /// Must be called before the stats become invalid
+      void removeMetrics();
     };
   }
 }
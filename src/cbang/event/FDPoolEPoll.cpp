@@ -36,15 +36,18 @@
 
 #include "Event.h"
 
+#include <cbang/json/Sink.h>
 #include <cbang/thread/SmartLock.h>
 #include <cbang/log/Logger.h>
 #include <cbang/os/SysError.h>
 #include <cbang/net/Socket.h>
+#include <cbang/time/Clock.h>
 
 #include <cstring>
 #include <cerrno>
 
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 using namespace cb::Event;
@@ -113,8 +116,7 @@ void FDPoolEPoll::FDQueue::updateTimeout(bool wasActive, bool nowActive) {
   else if (!wasActive) {
     last = Time::now();
 
-    if (getTimeout())
-      fdr.getPool().queueTimeout(getNextTimeout(), read, fdr.getFD());
+    if (getTimeout()) fdr.getShard().queueTimeout(*this, getNextTimeout());
   }
 }
 
@@ -128,19 +130,20 @@ void FDPoolEPoll::FDQueue::timeout(uint64_t now) {
     close();
     timedout = true;
 
-  } else fdr.getPool().queueTimeout(getNextTimeout(), read, fdr.getFD());
+  } else fdr.getShard().queueTimeout(*this, getNextTimeout());
 }
 
 
 void FDPoolEPoll::FDQueue::transfer() {
   if (closed || empty()) return;
 
-  auto &pool = fdr.getPool();
+  auto &shard = fdr.getShard();
 
   if (newTransfer) {
     newTransfer = false;
+    flushProgress();
     cmd_t cmd = read ? CMD_READ_SIZE : CMD_WRITE_SIZE;
-    pool.queueProgress(cmd, fdr.getFD(), Time::now(), front()->getLength());
+    shard.queueProgress(cmd, fdr.getFD(), Time::now(), front()->getLength());
   }
 
   int ret = front()->transfer();
@@ -149,13 +152,15 @@ void FDPoolEPoll::FDQueue::transfer() {
   else {
     last = Time::now();
 
-    cmd_t cmd = read ? CMD_READ_PROGRESS : CMD_WRITE_PROGRESS;
-    pool.queueProgress(cmd, fdr.getFD(), last, ret);
+    pendingBytes += ret;
+    pendingTime = last;
+    shard.markDirty(fdr);
 
     if (front()->isFinished()) {
-      cmd = read ? CMD_READ_FINISHED : CMD_WRITE_FINISHED;
-      pool.queueProgress(cmd, fdr.getFD(), last, front()->getLength());
-      pool.queueComplete(front());
+      flushProgress();
+      cmd_t cmd = read ? CMD_READ_FINISHED : CMD_WRITE_FINISHED;
+      shard.queueProgress(cmd, fdr.getFD(), last, front()->getLength());
+      shard.queueComplete(front());
       pop();
     }
   }
@@ -168,23 +173,36 @@ void FDPoolEPoll::FDQueue::transferPending() {
 
 
 void FDPoolEPoll::FDQueue::flush() {
+  fdr.getShard().cancelTimeout(*this);
   while (!empty()) pop();
   closed = timedout = false;
-  last = 0;
+  last = pendingTime = 0;
+  pendingBytes = 0;
 }
 
 
 void FDPoolEPoll::FDQueue::add(const SmartPointer<Transfer> &tran) {
-  if (closed) fdr.getPool().queueComplete(tran);
+  if (closed) fdr.getShard().queueComplete(tran);
   else push(tran);
 }
 
 
+void FDPoolEPoll::FDQueue::flushProgress() {
+  if (!pendingTime) return;
+
+  cmd_t cmd = read ? CMD_READ_PROGRESS : CMD_WRITE_PROGRESS;
+  fdr.getShard().queueProgress(cmd, fdr.getFD(), pendingTime, pendingBytes);
+  pendingBytes = 0;
+  pendingTime = 0;
+}
+
+
 void FDPoolEPoll::FDQueue::close() {
+  flushProgress();
   closed = true;
 
   while (!empty()) {
-    fdr.getPool().queueComplete(front());
+    fdr.getShard().queueComplete(front());
     pop();
   }
 }
@@ -198,8 +216,8 @@ void FDPoolEPoll::FDQueue::pop() {
 
 
 /******************************************************************************/
-FDPoolEPoll::FDRec::FDRec(FDPoolEPoll &pool, int fd) :
-  pool(pool), fd(fd), readQ(*this, true), writeQ(*this, false) {}
+FDPoolEPoll::FDRec::FDRec(Shard &shard, int fd) :
+  shard(shard), fd(fd), readQ(*this, true), writeQ(*this, false) {}
 
 
 void FDPoolEPoll::FDRec::timeout(uint64_t now, bool read) {
@@ -242,14 +260,15 @@ void FDPoolEPoll::FDRec::transfer(unsigned events) {
 void FDPoolEPoll::FDRec::flush() {
   readQ.flush();
   writeQ.flush();
-  pool.queueFlushed(fd);
+  reportedStatus = getStatus();
+  shard.queueFlushed(fd);
 }
 
 
 void FDPoolEPoll::FDRec::process(cmd_t cmd,
                                  const SmartPointer<Transfer> &tran) {
   if ((cmd == CMD_READ || cmd == CMD_WRITE) && tran->isFinished())
-    return pool.queueComplete(tran);
+    return shard.queueComplete(tran);
 
   switch (cmd) {
   case CMD_READ:  readQ.add(tran);  break;
@@ -262,6 +281,18 @@ void FDPoolEPoll::FDRec::process(cmd_t cmd,
 }
 
 
+void FDPoolEPoll::FDRec::report() {
+  readQ.flushProgress();
+  writeQ.flushProgress();
+
+  int status = getStatus();
+  if (status != reportedStatus) {
+    reportedStatus = status;
+    shard.queueStatus(fd, status);
+  }
+}
+
+
 void FDPoolEPoll::FDRec::update() {
   readQ.transferPending();
 
@@ -274,7 +305,7 @@ void FDPoolEPoll::FDRec::update() {
   ev.data.fd = fd;
   int op = events ? (newEvents ? EPOLL_CTL_MOD : EPOLL_CTL_DEL) : EPOLL_CTL_ADD;
 
-  if (epoll_ctl(pool.getFD(), op, fd, &ev))
+  if (epoll_ctl(shard.getFD(), op, fd, &ev))
     if (op != EPOLL_CTL_DEL)
       LOG_ERROR("epoll_ctl(" << epollOpString(op) << ") failed for fd " << fd
                 << ": " << SysError());
@@ -290,171 +321,149 @@ void FDPoolEPoll::FDRec::update() {
 
 
 /******************************************************************************/
-FDPoolEPoll::FDPoolEPoll(Base &base) :
-  event(base.newEvent(this, &FDPoolEPoll::processResults)) {
+FDPoolEPoll::Shard::Shard(FDPoolEPoll &pool, unsigned index) :
+  pool(pool), index(index),
+  event(pool.getBase().newEvent(this, &Shard::processResults)),
+  timeouts(Time::now()), numFDs(0), numEvents(0), numCommands(0),
+  numResults(0), resultWakeups(0), wakePending(false), queuedCommands(0),
+  commandWakeups(0) {
 
   fd = epoll_create1(EPOLL_CLOEXEC);
-  if (!fd) THROW("Failed to create epoll");
-  start();
-}
+  if (fd == -1) THROW("Failed to create epoll: " << SysError());
 
+  // Wakes the shard thread when commands are queued
+  wakeFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wakeFD == -1) THROW("Failed to create eventfd: " << SysError());
 
-FDPoolEPoll::~FDPoolEPoll() {
-  join();
-  if (fd != -1) close(fd);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = wakeFD;
+  if (epoll_ctl(fd, EPOLL_CTL_ADD, wakeFD, &ev))
+    THROW("Failed to add eventfd to epoll: " << SysError());
 }
 
 
-void FDPoolEPoll::setEventPriority(int priority) {event->setPriority(priority);}
-int FDPoolEPoll::getEventPriority() const {return event->getPriority();}
+FDPoolEPoll::Shard::~Shard() {
+  join();
+  if (fd != -1) ::close(fd);
+  if (wakeFD != -1) ::close(wakeFD);
+}
 
 
-void FDPoolEPoll::read(const SmartPointer<Transfer> &t) {
-  if (t.isNull()) THROW("Transfer cannot be null");
-  queueCommand(CMD_READ, t->getFD(), t);
+void FDPoolEPoll::Shard::queueTimeout(FDQueue &q, uint64_t time) {
+  timeouts.schedule(q, time + 1); // Time out once strictly past
 }
 
 
-void FDPoolEPoll::write(const SmartPointer<Transfer> &t) {
-  if (t.isNull()) THROW("Transfer cannot be null");
-  queueCommand(CMD_WRITE, t->getFD(), t);
-}
+void FDPoolEPoll::Shard::cancelTimeout(FDQueue &q) {timeouts.cancel(q);}
 
 
-void FDPoolEPoll::open(FD &fd) {
-  if (fd.getFD() < 0) THROW("Invalid fd " << fd.getFD());
-  if (!fds.insert(fds_t::value_type(fd.getFD(), &fd)).second)
-    THROW("FD " << fd.getFD() << " already in pool");
+void FDPoolEPoll::Shard::queueComplete(const SmartPointer<Transfer> &t) {
+  queueResult({CMD_COMPLETE, t->getFD(), t, 0, 0});
 }
 
 
-void FDPoolEPoll::flush(int fd) {
-  if (fd < 0) THROW("Invalid fd " << fd);
-  if (flushing.find(fd) != flushing.end())
-    THROW("FD " << fd << " already flushing");
-
-  flushing.insert(fd);
-  queueCommand(CMD_FLUSH, fd, 0);
+void FDPoolEPoll::Shard::queueFlushed(int fd) {
+  queueResult({CMD_FLUSHED, fd, 0, 0, 0});
 }
 
 
-void FDPoolEPoll::queueTimeout(uint64_t time, bool read, int fd) {
-  if (inTimeoutQ.find({fd, read}) == inTimeoutQ.end()) {
-    inTimeoutQ.insert({fd, read});
-    timeoutQ.push({time, read, fd});
-  }
+void FDPoolEPoll::Shard::queueProgress(
+  cmd_t cmd, int fd, uint64_t time, int value) {
+  queueResult({cmd, fd, 0, time, value});
 }
 
 
-void FDPoolEPoll::queueComplete(const SmartPointer<Transfer> &t) {
-  results.push({CMD_COMPLETE, t->getFD(), t, 0, 0});
-  event->activate();
+void FDPoolEPoll::Shard::queueStatus(int fd, int status) {
+  queueResult({CMD_STATUS, fd, 0, 0, status});
 }
 
 
-void FDPoolEPoll::queueFlushed(int fd) {
-  results.push({CMD_FLUSHED, fd, 0, 0, 0});
-  event->activate();
+void FDPoolEPoll::Shard::queueCommand(cmd_t cmd, int fd,
+                                      const SmartPointer<Transfer> &tran) {
+  LOG_DEBUG(5, CBANG_FUNC << "() shard=" << index << " fd=" << fd
+            << " cmd=" << cmd);
+  cmds.push({cmd, fd, tran, 0, 0});
+  queuedCommands++;
+  wake();
 }
 
 
-void FDPoolEPoll::queueProgress(cmd_t cmd, int fd, uint64_t time, int value) {
-  results.push({cmd, fd, 0, time, value});
-  event->activate();
+void FDPoolEPoll::Shard::markDirty(FDRec &rec) {
+  if (rec.isDirty()) return;
+  rec.setDirty(true);
+  dirty.push_back(&rec);
 }
 
 
-void FDPoolEPoll::queueStatus(int fd, int status) {
-  results.push({CMD_STATUS, fd, 0, 0, status});
-  event->activate();
+void FDPoolEPoll::Shard::writeStats(JSON::Sink &sink) const {
+  sink.beginDict();
+  sink.insert("fds",      getOpenFDs());
+  sink.insert("slots",    getNumFDs());
+  sink.insert("events",   (double)getNumEvents());
+  sink.insert("commands", (double)getNumCommands());
+  sink.insert("command_depth", (double)(queuedCommands - numCommands));
+  sink.insert("command_wakeups", (double)commandWakeups);
+  sink.insert("results", (double)numResults);
+  sink.insert("result_depth", (double)(numResults - processedResults));
+  sink.insert("result_wakeups", (double)resultWakeups);
+  sink.insert("read",     readRate.get());
+  sink.insert("write",    writeRate.get());
+  sink.endDict();
 }
 
 
-void FDPoolEPoll::queueCommand(cmd_t cmd, int fd,
-                               const SmartPointer<Transfer> &tran) {
-  LOG_DEBUG(5, CBANG_FUNC << "() fd=" << fd << " cmd=" << cmd);
-  cmds.push({cmd, fd, tran});
-}
+FDPoolEPoll::FDRec &FDPoolEPoll::Shard::getRec(int fd) {
+  if (fd < 0) THROW("Invalid fd " << fd);
 
+  unsigned i = (unsigned)fd / pool.getNumShards();
+  if (recs.size() <= i) recs.resize(i + 1);
 
-FDPoolEPoll::FDRec &FDPoolEPoll::getFD(int fd) {
-  auto it = pool.find(fd);
-  if (it != pool.end()) return *it->second;
-  auto result = pool.insert(pool_t::value_type(fd, new FDRec(*this, fd)));
-  return *result.first->second;
+  auto &rec = recs[i];
+  if (rec.isNull()) {
+    rec = new FDRec(*this, fd);
+    numFDs++;
+  }
+
+  return *rec;
 }
 
 
-void FDPoolEPoll::processResults() {
-  while (!results.empty()) {
-    auto &cmd = results.top();
-    LOG_DEBUG(5, CBANG_FUNC << "() fd=" << cmd.fd << " cmd=" << cmd.cmd);
+void FDPoolEPoll::Shard::queueResult(const Command &cmd) {
+  // The event loop is woken once at the end of the pass
+  results.push(cmd);
+  numResults++;
+  resultsPending = true;
+}
 
-    auto it = fds.find(cmd.fd);
-    if (it == fds.end()) {
-      results.pop();
-      continue;
-    }
 
-    FD &fd = *it->second;
+void FDPoolEPoll::Shard::wake() {
+  if (wakePending.exchange(true)) return;
 
-    // Drop results from flushing FDs
-    if (flushing.find(cmd.fd) != flushing.end() && cmd.cmd != CMD_FLUSHED) {
-      results.pop();
-      continue;
-    }
+  uint64_t one = 1;
+  if (::write(wakeFD, &one, sizeof(one)) != sizeof(one))
+    LOG_ERROR("Failed to wake epoll shard: " << SysError());
+  commandWakeups++;
+}
 
-    switch (cmd.cmd) {
-    case CMD_FLUSHED:
-      Socket::close(cmd.fd);
-      flushing.erase(cmd.fd);
-      fds.erase(cmd.fd);
-      break;
-
-    case CMD_COMPLETE: TRY_CATCH_ERROR(cmd.tran->complete()); break;
-
-    case CMD_READ_PROGRESS:
-      readRate.event(cmd.value, cmd.time);
-      fd.getReadProgress().event(cmd.value, cmd.time);
-      break;
-
-    case CMD_WRITE_PROGRESS:
-      writeRate.event(cmd.value, cmd.time);
-      fd.getWriteProgress().event(cmd.value, cmd.time);
-      break;
-
-    case CMD_READ_SIZE:
-      fd.getReadProgress().reset();
-      fd.getReadProgress().setSize(cmd.value);
-      fd.getReadProgress().setStart(cmd.time);
-      fd.getReadProgress().setEnd(cmd.time);
-      break;
-
-    case CMD_WRITE_SIZE:
-      fd.getWriteProgress().reset();
-      fd.getWriteProgress().setSize(cmd.value);
-      fd.getWriteProgress().setStart(cmd.time);
-      fd.getWriteProgress().setEnd(cmd.time);
-      break;
-
-    case CMD_READ_FINISHED:  fd.getReadProgress().setSize(cmd.value);  break;
-    case CMD_WRITE_FINISHED: fd.getWriteProgress().setSize(cmd.value); break;
-
-    case CMD_STATUS: fd.setStatus(cmd.value); break;
-
-    default: LOG_ERROR("Invalid results command");
-    }
 
+void FDPoolEPoll::Shard::processResults() {
+  while (!results.empty()) {
+    pool.processResult(*this, results.top());
     results.pop();
+    processedResults++;
   }
 }
 
 
-void FDPoolEPoll::run() {
+void FDPoolEPoll::Shard::run() {
   epoll_event records[1024];
 
   while (!shouldShutdown()) {
     int count = epoll_wait(this->fd, records, 1024, 100);
+    Clock::update();
+
     if (count == -1) {
       if (errno != EINTR) {
         LOG_ERROR("epoll_wait() failed");
@@ -462,46 +471,206 @@ void FDPoolEPoll::run() {
       }
     }
 
-    map<int, int> changed;
-
-#define CHECK_STATUS(STMT)                                              \
-    int oldStatus = fd.getStatus();                                     \
-    STMT;                                                               \
-    int newStatus = fd.getStatus();                                     \
-    if (oldStatus != newStatus) changed[fd.getFD()] = newStatus;
-
     for (int i = 0; i < count; i++)
       try {
+        if (records[i].data.fd == wakeFD) {
+          uint64_t value;
+          if (::read(wakeFD, &value, sizeof(value)) < 0 && errno != EAGAIN)
+            LOG_ERROR("Failed to read eventfd: " << SysError());
+          continue;
+        }
+
         unsigned events = epoll_to_fd_events(records[i].events);
-        auto &fd        = getFD(records[i].data.fd);
-        CHECK_STATUS(fd.transfer(events));
+        auto &rec       = getRec(records[i].data.fd);
+        rec.transfer(events);
+        markDirty(rec);
       } CATCH_ERROR;
 
-    // Process pending commands
+    if (0 < count) numEvents += count;
+
+    // Process pending commands, later commands will wake us again
+    wakePending = false;
     while (!cmds.empty()) {
       auto &cmd = cmds.top();
-      auto &fd  = getFD(cmd.fd);
-      CHECK_STATUS(fd.process(cmd.cmd, cmd.tran));
+      auto &rec = getRec(cmd.fd);
+      rec.process(cmd.cmd, cmd.tran);
+      markDirty(rec);
       cmds.pop();
+      numCommands++;
     }
 
     // Process timeouts
     uint64_t now = Time::now();
-    while (!timeoutQ.empty() && timeoutQ.top().time < now) {
-      auto t = timeoutQ.top();
-      timeoutQ.pop();
-      inTimeoutQ.erase({t.fd, t.read});
-
-      auto it = pool.find(t.fd);
-      if (it != pool.end()) {
-        auto &fd = *it->second;
-        CHECK_STATUS(fd.timeout(now, t.read));
-      }
+    timeouts.expire(now, [this, now] (TimerWheel::Timer &t) {
+      auto &q = static_cast<FDQueue &>(t);
+      q.timeout(now);
+      markDirty(q.getRec());
+    });
+
+    // Queue merged progress and status changes
+    for (auto rec: dirty) {
+      rec->setDirty(false);
+      rec->report();
+    }
+
+    dirty.clear();
+
+    // Deliver this pass's results with a single wakeup
+    if (resultsPending) {
+      resultsPending = false;
+      resultWakeups++;
+      event->activate();
     }
+  }
+}
+
+
+
+/******************************************************************************/
+FDPoolEPoll::FDPoolEPoll(Base &base, unsigned threads) : base(base) {
+  if (!threads) threads = 1;
+
+  for (unsigned i = 0; i < threads; i++)
+    shards.push_back(new Shard(*this, i));
+
+  for (auto &shard: shards) shard->start();
+  addMetrics();
+}
+
+
+FDPoolEPoll::~FDPoolEPoll() {
+  removeMetrics();
+  for (auto &shard: shards) shard->stop();
+  shards.clear();
+}
+
+
+void FDPoolEPoll::setEventPriority(int priority) {
+  for (auto &shard: shards) shard->getEvent().setPriority(priority);
+}
+
+
+int FDPoolEPoll::getEventPriority() const {
+  return shards[0]->getEvent().getPriority();
+}
+
+
+void FDPoolEPoll::read(const SmartPointer<Transfer> &t) {
+  if (t.isNull()) THROW("Transfer cannot be null");
+  getShard(t->getFD()).queueCommand(CMD_READ, t->getFD(), t);
+}
+
+
+void FDPoolEPoll::write(const SmartPointer<Transfer> &t) {
+  if (t.isNull()) THROW("Transfer cannot be null");
+  getShard(t->getFD()).queueCommand(CMD_WRITE, t->getFD(), t);
+}
+
+
+void FDPoolEPoll::open(FD &fd) {
+  auto &e = getEntry(fd.getFD());
+  if (e.fd) THROW("FD " << fd.getFD() << " already in pool");
+  e.fd = &fd;
+  getShard(fd.getFD()).incOpenFDs();
+}
+
+
+void FDPoolEPoll::flush(int fd) {
+  auto &e = getEntry(fd);
+  if (e.flushing) THROW("FD " << fd << " already flushing");
+
+  e.flushing = true;
+  getShard(fd).queueCommand(CMD_FLUSH, fd, 0);
+}
+
+
+void FDPoolEPoll::writeStats(JSON::Sink &sink) const {
+  sink.beginDict();
+  sink.insert("read", readRate.get());
+  sink.insert("write", writeRate.get());
+
+  // Load balance, the busiest shard relative to the average.  1 is perfect.
+  double total = 0;
+  double busiest = 0;
+  for (auto &shard: shards) {
+    double load = shard->getReadRate().get() + shard->getWriteRate().get();
+    total += load;
+    if (busiest < load) busiest = load;
+  }
+
+  sink.insert("balance", total ? busiest * shards.size() / total : 1);
+
+  sink.insertList("shards");
+  for (auto &shard: shards) {
+    sink.beginAppend();
+    shard->writeStats(sink);
+  }
+  sink.endList();
+
+  sink.endDict();
+}
+
+
+FDPoolEPoll::FDEntry &FDPoolEPoll::getEntry(int fd) {
+  if (fd < 0) THROW("Invalid fd " << fd);
+  if (fds.size() <= (unsigned)fd) fds.resize(fd + 1);
+  return fds[fd];
+}
+
+
+void FDPoolEPoll::processResult(Shard &shard, const Command &cmd) {
+  LOG_DEBUG(5, CBANG_FUNC << "() fd=" << cmd.fd << " cmd=" << cmd.cmd);
+
+  if (cmd.fd < 0 || fds.size() <= (unsigned)cmd.fd) return;
+  auto &e = fds[cmd.fd];
+  if (!e.fd) return;
+
+  FD &fd = *e.fd;
+
+  // Drop results from flushing FDs
+  if (e.flushing && cmd.cmd != CMD_FLUSHED) return;
+
+  switch (cmd.cmd) {
+  case CMD_FLUSHED:
+    Socket::close(cmd.fd);
+    e = FDEntry();
+    shard.decOpenFDs();
+    break;
+
+  case CMD_COMPLETE: TRY_CATCH_ERROR(cmd.tran->complete()); break;
+
+  case CMD_READ_PROGRESS:
+    readRate.event(cmd.value, cmd.time);
+    shard.getReadRate().event(cmd.value, cmd.time);
+    fd.getReadProgress().event(cmd.value, cmd.time);
+    break;
+
+  case CMD_WRITE_PROGRESS:
+    writeRate.event(cmd.value, cmd.time);
+    shard.getWriteRate().event(cmd.value, cmd.time);
+    fd.getWriteProgress().event(cmd.value, cmd.time);
+    break;
+
+  case CMD_READ_SIZE:
+    fd.getReadProgress().reset();
+    fd.getReadProgress().setSize(cmd.value);
+    fd.getReadProgress().setStart(cmd.time);
+    fd.getReadProgress().setEnd(cmd.time);
+    break;
+
+  case CMD_WRITE_SIZE:
+    fd.getWriteProgress().reset();
+    fd.getWriteProgress().setSize(cmd.value);
+    fd.getWriteProgress().setStart(cmd.time);
+    fd.getWriteProgress().setEnd(cmd.time);
+    break;
+
+  case CMD_READ_FINISHED:  fd.getReadProgress().setSize(cmd.value);  break;
+  case CMD_WRITE_FINISHED: fd.getWriteProgress().setSize(cmd.value); break;
+
+  case CMD_STATUS: fd.setStatus(cmd.value); break;
 
-    // Queue status changes
-    for (auto it: changed)
-      queueStatus(it.first, it.second);
+  default: LOG_ERROR("Invalid results command");
   }
 }
 
@@ -41,22 +41,18 @@
 
 #include <cbang/thread/Thread.h>
 #include <cbang/util/SPSCQueue.h>
+#include <cbang/util/TimerWheel.h>
 
-#include <map>
-#include <set>
 #include <queue>
+#include <vector>
+#include <atomic>
 
 
 namespace cb {
   namespace Event {
     class Base;
 
-    class FDPoolEPoll :
-      public FDPool, public Thread, public FDPoolEPollCommand::Enum {
-      int fd = -1;
-
-      SmartPointer<Event> event;
-
+    class FDPoolEPoll : public FDPool, public FDPoolEPollCommand::Enum {
       typedef FDPoolEPollCommand cmd_t;
 
       enum {
@@ -74,27 +70,11 @@ namespace cb {
         int value;
       };
 
-      struct TimeoutMember {
-        int fd;
-        bool read;
-
-        bool operator<(const TimeoutMember &o) const {
-          if (fd == o.fd) return read < o.read;
-          return fd < o.fd;
-        }
-      };
-
-      struct Timeout {
-        uint64_t time;
-        bool read;
-        int fd;
-
-        bool operator<(const Timeout &o) const {return o.time < time;}
-      };
-
+      class Shard;
       class FDRec;
 
-      class FDQueue : public std::queue<SmartPointer<Transfer> > {
+      class FDQueue :
+        public std::queue<SmartPointer<Transfer> >, public TimerWheel::Timer {
         FDRec &fdr;
         bool read;
         bool closed = false;
@@ -102,9 +82,14 @@ namespace cb {
         uint64_t last = 0;
         bool newTransfer = true;
 
+        // Progress merged until the end of the loop pass
+        int pendingBytes = 0;
+        uint64_t pendingTime = 0;
+
       public:
         FDQueue(FDRec &fdr, bool read) : fdr(fdr), read(read) {}
 
+        FDRec &getRec() {return fdr;}
         bool isClosed() const {return closed;}
         bool isTimedout() const {return timedout;}
         bool wantsRead() const;
@@ -117,6 +102,7 @@ namespace cb {
         void transferPending();
         void flush();
         void add(const SmartPointer<Transfer> &tran);
+        void flushProgress();
 
       protected:
         void close();
@@ -124,16 +110,21 @@ namespace cb {
       };
 
       class FDRec {
-        FDPoolEPoll &pool;
+        Shard &shard;
         int fd = -1;
         unsigned events = 0;
+        int reportedStatus = 0;
+        bool dirty = false;
         FDQueue readQ;
         FDQueue writeQ;
 
       public:
-        FDRec(FDPoolEPoll &pool, int fd);
+        FDRec(Shard &shard, int fd);
 
-        FDPoolEPoll &getPool() {return pool;}
+        bool isDirty() const {return dirty;}
+        void setDirty(bool dirty) {this->dirty = dirty;}
+
+        Shard &getShard() {return shard;}
         int getFD() const {return fd;}
 
         void timeout(uint64_t now, bool read);
@@ -143,27 +134,105 @@ namespace cb {
         void transfer(unsigned events);
         void flush();
         void process(cmd_t cmd, const SmartPointer<Transfer> &tran);
+        void report();
+      };
+
+      /// Each shard owns an epoll fd and a thread which services its FDs
+      class Shard : public Thread {
+        FDPoolEPoll &pool;
+        unsigned index;
+        int fd = -1;
+        int wakeFD = -1;
+
+        SmartPointer<Event> event;
+
+        SPSCQueue<Command> cmds;
+        SPSCQueue<Command> results;
+        TimerWheel timeouts;
+
+        // Indexed by fd / number of shards
+        std::vector<SmartPointer<FDRec> > recs;
+        std::vector<FDRec *> dirty;
+
+        // Written by the shard thread, read by stats
+        std::atomic<unsigned> numFDs;
+        std::atomic<uint64_t> numEvents;
+        std::atomic<uint64_t> numCommands;
+        std::atomic<uint64_t> numResults;
+        std::atomic<uint64_t> resultWakeups;
+        bool resultsPending = false;
+
+        // Written by the event loop thread
+        std::atomic<bool> wakePending;
+        std::atomic<uint64_t> queuedCommands;
+        std::atomic<uint64_t> commandWakeups;
+        uint64_t processedResults = 0;
+        unsigned openFDs = 0;
+        Rate readRate = 60;
+        Rate writeRate = 60;
+
+      public:
+        Shard(FDPoolEPoll &pool, unsigned index);
+        ~Shard();
+
+        FDPoolEPoll &getPool() {return pool;}
+        unsigned getIndex() const {return index;}
+        int getFD() const {return fd;}
+        Event &getEvent() {return *event;}
+
+        unsigned getNumFDs() const {return numFDs;}
+        uint64_t getNumEvents() const {return numEvents;}
+        uint64_t getNumCommands() const {return numCommands;}
+
+        unsigned getOpenFDs() const {return openFDs;}
+        void incOpenFDs() {openFDs++;}
+        void decOpenFDs() {if (openFDs) openFDs--;}
+        Rate &getReadRate() {return readRate;}
+        Rate &getWriteRate() {return writeRate;}
+        const Rate &getReadRate() const {return readRate;}
+        const Rate &getWriteRate() const {return writeRate;}
+
+        void queueTimeout(FDQueue &q, uint64_t time);
+        void cancelTimeout(FDQueue &q);
+        void queueComplete(const SmartPointer<Transfer> &t);
+        void queueFlushed(int fd);
+        void queueProgress(cmd_t cmd, int fd, uint64_t time, int value);
+        void queueStatus(int fd, int status);
+        void queueCommand(cmd_t cmd, int fd,
+                          const SmartPointer<Transfer> &tran);
+        void markDirty(FDRec &rec);
+
+        void writeStats(JSON::Sink &sink) const;
+
+      protected:
+        FDRec &getRec(int fd);
+        void queueResult(const Command &cmd);
+        void wake();
+        void processResults();
+
+        // From Thread
+        void run() override;
       };
 
-      SPSCQueue<Command> cmds;
-      SPSCQueue<Command> results;
-      std::set<TimeoutMember> inTimeoutQ;
-      std::priority_queue<Timeout> timeoutQ;
-      std::set<int> flushing;
+      Base &base;
+      std::vector<SmartPointer<Shard> > shards;
 
-      typedef std::map<int, SmartPointer<FDRec> > pool_t;
-      pool_t pool;
+      struct FDEntry {
+        FD *fd = 0;
+        bool flushing = false;
+      };
 
-      typedef std::map<int, FD *> fds_t;
-      fds_t fds;
+      // Indexed by fd
+      std::vector<FDEntry> fds;
       Rate readRate = 60;
       Rate writeRate = 60;
 
     public:
-      FDPoolEPoll(Base &base);
+      FDPoolEPoll(Base &base, unsigned threads = 1);
       ~FDPoolEPoll();
 
-      int getFD() const {return fd;}
+      Base &getBase() {return base;}
+      unsigned getNumShards() const {return shards.size();}
 
       // From FDPool
       void setEventPriority(int priority) override;
@@ -175,20 +244,12 @@ namespace cb {
       void write(const SmartPointer<Transfer> &t) override;
       void open(FD &fd) override;
       void flush(int fd) override;
-
-      void queueTimeout(uint64_t time, bool read, int fd);
-      void queueComplete(const SmartPointer<Transfer> &t);
-      void queueFlushed(int fd);
-      void queueProgress(cmd_t cmd, int fd, uint64_t time, int value);
+      void writeStats(JSON::Sink &sink) const override;
 
     protected:
-      void queueStatus(int fd, int status);
-      void queueCommand(cmd_t cmd, int fd, const SmartPointer<Transfer> &tran);
-      FDRec &getFD(int fd);
-      void processResults();
-
-      // From Thread
-      void run() override;
+      Shard &getShard(int fd) {return *shards[(unsigned)fd % shards.size()];}
+      FDEntry &getEntry(int fd);
+      void processResult(Shard &shard, const Command &cmd);
     };
   }
 }
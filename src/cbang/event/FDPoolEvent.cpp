@@ -216,7 +216,12 @@ void FDPoolEvent::FDRec::timeout() {
 
 /******************************************************************************/
 FDPoolEvent::FDPoolEvent(Base &base) :
-  base(base), flushEvent(base.newEvent(this, &FDPoolEvent::flushFDs)) {}
+  base(base), flushEvent(base.newEvent(this, &FDPoolEvent::flushFDs)) {
+  addMetrics();
+}
+
+
+FDPoolEvent::~FDPoolEvent() {removeMetrics();}
 
 
 void FDPoolEvent::read(const cb::SmartPointer<Transfer> &t) {
@@ -107,6 +107,7 @@ namespace cb {
 
     public:
       FDPoolEvent(Base &base);
+      ~FDPoolEvent();
 
       Base &getBase() {return base;}
 
@@ -0,0 +1,449 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "FDPoolIOUring.h"
+
+#ifdef HAVE_LIBURING
+
+#include "Base.h"
+#include "Event.h"
+#include "FD.h"
+
+#include <cbang/Catch.h>
+#include <cbang/json/Sink.h>
+#include <cbang/log/Logger.h>
+#include <cbang/os/SysError.h>
+#include <cbang/net/Socket.h>
+
+#include <cerrno>
+
+#include <poll.h>
+#include <sys/socket.h>
+
+using namespace cb::Event;
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  uint64_t op_data(int fd, unsigned op) {return (uint64_t)fd << 2 | op;}
+}
+
+
+/******************************************************************************/
+bool FDPoolIOUring::FDQueue::wantsRead() const {
+  return !empty() && front()->wantsRead();
+}
+
+
+bool FDPoolIOUring::FDQueue::wantsWrite() const {
+  return !empty() && front()->wantsWrite();
+}
+
+
+void FDPoolIOUring::FDQueue::add(const SmartPointer<Transfer> &tran) {
+  if (closed) TRY_CATCH_ERROR(tran->complete());
+  else push(tran);
+}
+
+
+void FDPoolIOUring::FDQueue::arm() {
+  while (!active && !closed && !empty() && !fdr.isFlushing()) {
+    auto t = front();
+
+    if (t->isFinished()) {pop(); continue;}
+
+    if (newTransfer) {
+      newTransfer = false;
+      auto &owner = fdr.getOwner();
+      Progress &p =
+        read ? owner.getReadProgress() : owner.getWriteProgress();
+      uint64_t now = Time::now();
+      p.reset();
+      p.setSize(t->getLength());
+      p.setStart(now);
+      p.setEnd(now);
+    }
+
+    // Data already buffered by TLS will never show up in a poll
+    if (read && t->isPending()) {
+      int ret = t->transfer();
+      if (ret < 0) close();
+      else progress(ret);
+      continue;
+    }
+
+    auto &pool = fdr.getPool();
+    int fd = fdr.getFD();
+    unsigned op = read ? OP_READ : OP_WRITE;
+    pool.reserveSQEs(2);
+    auto &sqe = pool.getSQE(fd, op);
+
+    polling = (read ? t->wantsWrite() : t->wantsRead()) || !t->prepare(space);
+
+    if (polling) {
+      bool in = read ? !t->wantsWrite() : t->wantsRead();
+      io_uring_prep_poll_add(&sqe, fd, in ? POLLIN : POLLOUT);
+
+    } else if (read)
+      io_uring_prep_recv(&sqe, fd, space.iov_base, space.iov_len, 0);
+    else io_uring_prep_send(&sqe, fd, space.iov_base, space.iov_len,
+                            MSG_NOSIGNAL);
+
+    io_uring_sqe_set_data64(&sqe, op_data(fd, op));
+    active = true;
+    fdr.incInflight();
+
+    // Time out if the operation makes no progress
+    if (t->getTimeout()) {
+      ts.tv_sec = t->getTimeout();
+      ts.tv_nsec = 0;
+      sqe.flags |= IOSQE_IO_LINK;
+
+      auto &tsqe = pool.getSQE(fd, OP_TIMEOUT);
+      io_uring_prep_link_timeout(&tsqe, &ts, 0);
+      io_uring_sqe_set_data64(&tsqe, op_data(fd, OP_TIMEOUT));
+      fdr.incInflight();
+    }
+  }
+}
+
+
+void FDPoolIOUring::FDQueue::complete(int res) {
+  active = false;
+  if (closed || empty() || fdr.isFlushing()) return;
+
+  if (res == -ECANCELED) {
+    LOG_DEBUG(4, (read ? "Read" : "Write") << " timedout on fd="
+              << fdr.getFD());
+    timedout = true;
+    return close();
+  }
+
+  auto t = front();
+  int ret;
+
+  if (polling) ret = res < 0 ? -1 : t->transfer();
+  else ret = t->commit(space, res);
+
+  if (ret < 0) close();
+  else progress(ret);
+}
+
+
+void FDPoolIOUring::FDQueue::cancel() {
+  if (!active) return;
+
+  int fd = fdr.getFD();
+  auto &sqe = fdr.getPool().getSQE(fd, OP_CANCEL);
+  io_uring_prep_cancel64(&sqe, op_data(fd, read ? OP_READ : OP_WRITE), 0);
+  io_uring_sqe_set_data64(&sqe, op_data(fd, OP_CANCEL));
+  fdr.incInflight();
+}
+
+
+void FDPoolIOUring::FDQueue::progress(int bytes) {
+  auto &pool = fdr.getPool();
+  auto &owner = fdr.getOwner();
+  uint64_t now = Time::now();
+
+  (read ? pool.getReadRate() : pool.getWriteRate()).event(bytes, now);
+
+  Progress &p = read ? owner.getReadProgress() : owner.getWriteProgress();
+  p.event(bytes, now);
+
+  if (!empty() && front()->isFinished()) {
+    p.setSize(front()->getLength());
+    pop();
+  }
+}
+
+
+void FDPoolIOUring::FDQueue::close() {
+  closed = true;
+  while (!empty()) pop();
+}
+
+
+void FDPoolIOUring::FDQueue::pop() {
+  auto t = front();
+  queue<SmartPointer<Transfer> >::pop();
+  newTransfer = true;
+  TRY_CATCH_ERROR(t->complete());
+}
+
+
+/******************************************************************************/
+FDPoolIOUring::FDRec::FDRec(FDPoolIOUring &pool, FD &owner) :
+  pool(pool), fd(owner.getFD()), owner(owner), readQ(*this, true),
+  writeQ(*this, false) {}
+
+
+int FDPoolIOUring::FDRec::getStatus() const {
+  return
+    ((readQ.empty()  || readQ.isClosed())  ? 0 : FD::READ_EVENT)  |
+    ((writeQ.empty() || writeQ.isClosed()) ? 0 : FD::WRITE_EVENT) |
+    (readQ.isClosed()    ? STATUS_READ_CLOSED    : 0) |
+    (writeQ.isClosed()   ? STATUS_WRITE_CLOSED   : 0) |
+    (readQ.isTimedout()  ? STATUS_READ_TIMEDOUT  : 0) |
+    (writeQ.isTimedout() ? STATUS_WRITE_TIMEDOUT : 0);
+}
+
+
+void FDPoolIOUring::FDRec::read(const SmartPointer<Transfer> &t) {
+  readQ.add(t);
+  update();
+}
+
+
+void FDPoolIOUring::FDRec::write(const SmartPointer<Transfer> &t) {
+  writeQ.add(t);
+  update();
+}
+
+
+void FDPoolIOUring::FDRec::complete(unsigned op, int res) {
+  decInflight();
+
+  switch (op) {
+  case OP_READ:  readQ.complete(res);  break;
+  case OP_WRITE: writeQ.complete(res); break;
+  default: break; // Timeout and cancel results need no action
+  }
+
+  update();
+}
+
+
+void FDPoolIOUring::FDRec::update() {
+  if (flushing) return;
+
+  readQ.arm();
+  writeQ.arm();
+
+  // Transfer callbacks may have flushed this FD
+  if (!flushing) owner.setStatus(getStatus());
+}
+
+
+void FDPoolIOUring::FDRec::flush() {
+  flushing = true;
+
+  // Transfers are held until the kernel is done with their buffers
+  readQ.cancel();
+  writeQ.cancel();
+}
+
+
+/******************************************************************************/
+FDPoolIOUring::FDPoolIOUring(Base &base, unsigned entries) : base(base) {
+  int ret = io_uring_queue_init(entries, &ring, 0);
+  if (ret < 0) THROW("Failed to create io_uring: " << SysError(-ret));
+
+  // The ring fd becomes readable when completions are waiting
+  event = base.newEvent(ring.ring_fd, this, &FDPoolIOUring::reap,
+                        EF::EVENT_READ | EF::EVENT_PERSIST);
+  event->add();
+
+  submitEvent  = base.newEvent(this, &FDPoolIOUring::submit);
+  releaseEvent = base.newEvent(this, &FDPoolIOUring::releaseFDs);
+  addMetrics();
+}
+
+
+FDPoolIOUring::~FDPoolIOUring() {
+  removeMetrics();
+  event->del();
+  io_uring_queue_exit(&ring);
+}
+
+
+bool FDPoolIOUring::isSupported() {
+  io_uring ring;
+  if (io_uring_queue_init(8, &ring, 0)) return false;
+
+  io_uring_probe *probe = io_uring_get_probe_ring(&ring);
+  bool supported = probe &&
+    io_uring_opcode_supported(probe, IORING_OP_RECV) &&
+    io_uring_opcode_supported(probe, IORING_OP_SEND) &&
+    io_uring_opcode_supported(probe, IORING_OP_POLL_ADD) &&
+    io_uring_opcode_supported(probe, IORING_OP_LINK_TIMEOUT) &&
+    io_uring_opcode_supported(probe, IORING_OP_ASYNC_CANCEL);
+
+  if (probe) io_uring_free_probe(probe);
+  io_uring_queue_exit(&ring);
+
+  return supported;
+}
+
+
+void FDPoolIOUring::reserveSQEs(unsigned count) {
+  if (io_uring_sq_space_left(&ring) < count) submit();
+}
+
+
+io_uring_sqe &FDPoolIOUring::getSQE(int fd, unsigned op) {
+  io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+
+  if (!sqe) {
+    submit();
+    sqe = io_uring_get_sqe(&ring);
+    if (!sqe) THROW("io_uring submission queue full");
+  }
+
+  sqes++;
+
+  // Submit everything queued during this event loop pass at once
+  if (!submitPending) {
+    submitPending = true;
+    submitEvent->activate();
+  }
+
+  return *sqe;
+}
+
+
+void FDPoolIOUring::submit() {
+  submitPending = false;
+
+  int ret = io_uring_submit(&ring);
+  if (ret < 0) LOG_ERROR("io_uring_submit() failed: " << SysError(-ret));
+  else submits++;
+}
+
+
+void FDPoolIOUring::setEventPriority(int priority) {
+  event->setPriority(priority);
+  submitEvent->setPriority(priority);
+  releaseEvent->setPriority(priority);
+}
+
+
+int FDPoolIOUring::getEventPriority() const {return event->getPriority();}
+
+
+void FDPoolIOUring::read(const SmartPointer<Transfer> &t) {
+  if (t.isNull()) THROW("Transfer cannot be null");
+  get(t->getFD()).read(t);
+}
+
+
+void FDPoolIOUring::write(const SmartPointer<Transfer> &t) {
+  if (t.isNull()) THROW("Transfer cannot be null");
+  get(t->getFD()).write(t);
+}
+
+
+void FDPoolIOUring::open(FD &fd) {
+  int i = fd.getFD();
+  if (i < 0) THROW("Invalid fd " << i);
+  if ((unsigned)i < fds.size() && fds[i].isSet())
+    THROW("FD " << i << " already in pool");
+
+  if (fds.size() <= (unsigned)i) fds.resize(i + 1);
+  fds[i] = new FDRec(*this, fd);
+}
+
+
+void FDPoolIOUring::flush(int fd) {
+  auto &rec = get(fd);
+  if (rec.isFlushing()) THROW("FD " << fd << " already flushing");
+
+  rec.flush();
+  if (rec.isDone()) release(fd);
+}
+
+
+void FDPoolIOUring::writeStats(JSON::Sink &sink) const {
+  sink.beginDict();
+  sink.insert("read",    readRate.get());
+  sink.insert("write",   writeRate.get());
+  sink.insert("submits", (double)submits);
+  sink.insert("sqes",    (double)sqes);
+  sink.insert("cqes",    (double)cqes);
+  sink.endDict();
+}
+
+
+FDPoolIOUring::FDRec &FDPoolIOUring::get(int fd) {
+  if (fd < 0 || fds.size() <= (unsigned)fd || fds[fd].isNull())
+    THROW("FD " << fd << " not found in pool");
+  return *fds[fd];
+}
+
+
+void FDPoolIOUring::release(int fd) {
+  // Defer FDRec deallocation, it may be executing
+  released.push_back(fds[fd]);
+  fds[fd].release();
+  releaseEvent->activate();
+
+  Socket::close((socket_t)fd);
+}
+
+
+void FDPoolIOUring::releaseFDs() {released.clear();}
+
+
+void FDPoolIOUring::reap() {
+  const unsigned batch = 256;
+  io_uring_cqe *cqes[batch];
+  uint64_t data[batch];
+  int results[batch];
+
+  while (true) {
+    unsigned count = io_uring_peek_batch_cqe(&ring, cqes, batch);
+    if (!count) break;
+
+    // Copy out so completion handlers may freely submit more work
+    for (unsigned i = 0; i < count; i++) {
+      data[i] = io_uring_cqe_get_data64(cqes[i]);
+      results[i] = cqes[i]->res;
+    }
+
+    io_uring_cq_advance(&ring, count);
+    this->cqes += count;
+
+    for (unsigned i = 0; i < count; i++) {
+      int fd = data[i] >> 2;
+      if (fds.size() <= (unsigned)fd || fds[fd].isNull()) continue;
+
+      auto &rec = *fds[fd];
+      TRY_CATCH_ERROR(rec.complete(data[i] & 3, results[i]));
+
+      // The callback may already have released the fd, or it may be reused
+      if (fds[fd].get() == &rec && rec.isDone()) release(fd);
+    }
+  }
+}
+
+#endif // HAVE_LIBURING
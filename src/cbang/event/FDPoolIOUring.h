@@ -0,0 +1,188 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/config.h>
+
+#ifdef HAVE_LIBURING
+
+#include "FDPool.h"
+
+#include <queue>
+#include <vector>
+
+#include <liburing.h>
+
+
+namespace cb {
+  namespace Event {
+    class Base;
+
+    /**
+     * An FDPool which performs I/O through io_uring on the event loop
+     * thread.  Plain socket reads and writes are submitted as recv/send
+     * directly into and out of the transfer's Buffer.  Transfers which
+     * must do their own I/O, such as TLS, wait on a poll request then call
+     * Transfer::transfer().  Requests made during one event loop pass are
+     * submitted together with a single system call.
+     */
+    class FDPoolIOUring : public FDPool {
+      Base &base;
+      io_uring ring;
+      SmartPointer<Event> event;
+      SmartPointer<Event> submitEvent;
+      SmartPointer<Event> releaseEvent;
+
+      enum {
+        OP_READ,
+        OP_WRITE,
+        OP_TIMEOUT,
+        OP_CANCEL,
+      };
+
+      enum {
+        STATUS_READ_CLOSED    = 1 << 4,
+        STATUS_WRITE_CLOSED   = 1 << 5,
+        STATUS_READ_TIMEDOUT  = 1 << 6,
+        STATUS_WRITE_TIMEDOUT = 1 << 7,
+      };
+
+      class FDRec;
+
+      class FDQueue : public std::queue<SmartPointer<Transfer> > {
+        FDRec &fdr;
+        bool read;
+        bool closed = false;
+        bool timedout = false;
+        bool active = false;
+        bool polling = false;
+        bool newTransfer = true;
+        iovec space;
+        __kernel_timespec ts;
+
+      public:
+        FDQueue(FDRec &fdr, bool read) : fdr(fdr), read(read) {}
+
+        bool isClosed() const {return closed;}
+        bool isTimedout() const {return timedout;}
+        bool isActive() const {return active;}
+        bool wantsRead() const;
+        bool wantsWrite() const;
+        void add(const SmartPointer<Transfer> &tran);
+        void arm();
+        void complete(int res);
+        void cancel();
+
+      protected:
+        void progress(int bytes);
+        void close();
+        void pop();
+      };
+
+      class FDRec {
+        FDPoolIOUring &pool;
+        int fd;
+        FD &owner;
+        FDQueue readQ;
+        FDQueue writeQ;
+        unsigned inflight = 0;
+        bool flushing = false;
+
+      public:
+        FDRec(FDPoolIOUring &pool, FD &fd);
+
+        FDPoolIOUring &getPool() {return pool;}
+        int getFD() const {return fd;}
+        FD &getOwner() {return owner;}
+        bool isFlushing() const {return flushing;}
+        bool isDone() const {return flushing && !inflight;}
+
+        void incInflight() {inflight++;}
+        void decInflight() {if (inflight) inflight--;}
+
+        int getStatus() const;
+        void read(const SmartPointer<Transfer> &t);
+        void write(const SmartPointer<Transfer> &t);
+        void complete(unsigned op, int res);
+        void update();
+        void flush();
+      };
+
+      // Indexed by fd
+      std::vector<SmartPointer<FDRec> > fds;
+      std::vector<SmartPointer<FDRec> > released;
+
+      bool submitPending = false;
+      uint64_t submits = 0;
+      uint64_t sqes = 0;
+      uint64_t cqes = 0;
+
+      Rate readRate = 60;
+      Rate writeRate = 60;
+
+    public:
+      FDPoolIOUring(Base &base, unsigned entries = 4096);
+      ~FDPoolIOUring();
+
+      /// @return True if the running kernel supports the needed operations
+      static bool isSupported();
+
+      Base &getBase() {return base;}
+      Rate &getReadRate() {return readRate;}
+      Rate &getWriteRate() {return writeRate;}
+
+      void reserveSQEs(unsigned count);
+      io_uring_sqe &getSQE(int fd, unsigned op);
+      void submit();
+
+      // From FDPool
+      void setEventPriority(int priority) override;
+      int getEventPriority() const override;
+      const Rate &getReadRate()  const override {return readRate;}
+      const Rate &getWriteRate() const override {return writeRate;}
+      void read(const SmartPointer<Transfer> &t) override;
+      void write(const SmartPointer<Transfer> &t) override;
+      void open(FD &fd) override;
+      void flush(int fd) override;
+      void writeStats(JSON::Sink &sink) const override;
+
+    protected:
+      FDRec &get(int fd);
+      void release(int fd);
+      void releaseFDs();
+      void reap();
+    };
+  }
+}
+
+#endif // HAVE_LIBURING
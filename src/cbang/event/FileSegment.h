@@ -0,0 +1,64 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <cbang/util/NonCopyable.h>
+
+#include <string>
+#include <cstdint>
+
+struct evbuffer_file_segment;
+
+
+namespace cb {
+  namespace Event {
+    /// An open file which can be added to any number of Buffers without copying
+    class FileSegment : public NonCopyable {
+      evbuffer_file_segment *seg = 0;
+      uint64_t size  = 0;
+      uint64_t mtime = 0;
+      uint64_t inode = 0;
+
+    public:
+      FileSegment(const std::string &path);
+      ~FileSegment();
+
+      evbuffer_file_segment *getSegment() const {return seg;}
+
+      uint64_t getSize() const {return size;}
+      uint64_t getModified() const {return mtime;}
+      uint64_t getInode() const {return inode;}
+    };
+  }
+}
@@ -45,6 +45,9 @@ JSONBufferWriter::JSONBufferWriter(unsigned indent, bool compact) :
   JSON::Writer(*SmartPointer<ostream>::get(), indent, compact) {}
 
 
+void JSONBufferWriter::flush() {SmartPointer<ostream>::operator->()->flush();}
+
+
 void JSONBufferWriter::close() {
   JSON::Writer::close();
   SmartPointer<ostream>::operator->()->flush();
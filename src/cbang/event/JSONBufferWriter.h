@@ -46,6 +46,9 @@ namespace cb {
     public:
       JSONBufferWriter(unsigned indent = 0, bool compact = true);
 
+      /// Move everything written so far in to the Buffer
+      void flush();
+
       // From JSON::Writer
       using JSON::Writer::write;
       void close() override;
@@ -99,7 +99,8 @@ namespace cb {
       void deny(const std::string &spec);
 
       const SmartPointer<RateSet> &getStats() const {return stats;}
-      void setStats(const SmartPointer<RateSet> &stats) {this->stats = stats;}
+      virtual void setStats(const SmartPointer<RateSet> &stats)
+      {this->stats = stats;}
 
       unsigned getConnectionCount() const {return connections.size();}
 
@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include "Buffer.h"
+
 #include <cbang/openssl/SSL.h>
 #include <cbang/util/ControlledCallback.h>
 
@@ -82,6 +84,14 @@ namespace cb {
 
       virtual bool isPending() const {return false;}
       virtual int transfer() {finished = success = true; return 0;}
+
+      /**
+       * Completion based I/O.  Fill in @param space for the kernel to read
+       * into or write from.  Returns false if transfer() must be used.
+       */
+      virtual bool prepare(iovec &space) {return false;}
+      /// Account for @param ret bytes of completed I/O into @param space
+      virtual int commit(iovec &space, int ret) {return ret;}
       virtual void complete() {if (cb) cb(success);}
     };
   }
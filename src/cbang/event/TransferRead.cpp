@@ -95,6 +95,36 @@ int TransferRead::transfer() {
 }
 
 
+bool TransferRead::prepare(iovec &space) {
+  unsigned length = this->length - buffer.getLength();
+  if (ssl.isSet() || finished || !length) return false;
+
+  buffer.reserve(min(length, 1U << 20), space);
+  if (!space.iov_len) return false;
+  if (length < space.iov_len) space.iov_len = length;
+
+  return true;
+}
+
+
+int TransferRead::commit(iovec &space, int ret) {
+  if (ret <= 0) {
+    finished = true;
+    return -1; // EOF or error
+  }
+
+#ifdef VALGRIND_MAKE_MEM_DEFINED
+  (void)VALGRIND_MAKE_MEM_DEFINED(space.iov_base, ret);
+#endif
+
+  space.iov_len = ret;
+  buffer.commit(space);
+  checkFinished();
+
+  return ret;
+}
+
+
 int TransferRead::read(Buffer &buffer, unsigned length) {
   if (!length) return 0;
 
@@ -52,6 +52,8 @@ namespace cb {
       // From Transfer
       bool isPending() const override;
       int transfer() override;
+      bool prepare(iovec &space) override;
+      int commit(iovec &space, int ret) override;
 
     protected:
       int read(Buffer &buffer, unsigned length);
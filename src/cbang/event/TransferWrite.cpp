@@ -71,6 +71,26 @@ int TransferWrite::transfer() {
 }
 
 
+bool TransferWrite::prepare(iovec &space) {
+  if (ssl.isSet() || finished || !buffer.getLength()) return false;
+  buffer.peek(buffer.getLength(), space);
+  return space.iov_len;
+}
+
+
+int TransferWrite::commit(iovec &space, int ret) {
+  if (ret <= 0) {
+    finished = true;
+    return success ? ret : -1;
+  }
+
+  buffer.drain(ret);
+  checkFinished();
+
+  return ret;
+}
+
+
 int TransferWrite::write(Buffer &buffer, unsigned length) {
   if (!length) return 0;
 
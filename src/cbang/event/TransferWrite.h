@@ -47,6 +47,8 @@ namespace cb {
 
       // From Transfer
       int transfer() override;
+      bool prepare(iovec &space) override;
+      int commit(iovec &space, int ret) override;
 
     protected:
       int write(Buffer &buffer, unsigned length);
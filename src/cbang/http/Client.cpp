@@ -33,7 +33,9 @@
 #include "Client.h"
 #include "ConnOut.h"
 
+#include <cbang/String.h>
 #include <cbang/openssl/SSLContext.h>
+#include <cbang/log/Logger.h>
 
 using namespace std;
 using namespace cb;
@@ -45,7 +47,80 @@ Client::Client(
   base(base), sslCtx(sslCtx) {}
 
 
-Client::~Client() {}
+Client::~Client() {
+  pool_t pool;
+  pool.swap(this->pool);
+  idleCount = 0;
+
+  for (auto &it: pool)
+    for (auto &conn: it.second) conn->close();
+}
+
+
+SmartPointer<ConnOut> Client::acquire(const URI &uri) {
+  bool ssl = uri.schemeRequiresSSL();
+  string key = uri.getHost() + ":" + String(uri.getPort()) + (ssl ? "s" : "");
+
+  auto it = pool.find(key);
+  if (it != pool.end()) {
+    auto &conns = it->second;
+
+    // Most recently used first, it is the least likely to have timed out
+    while (!conns.empty()) {
+      auto conn = conns.back();
+      conns.pop_back();
+      idleCount--;
+
+      if (!conn->isConnected()) continue;
+
+      conn->reuse();
+      if (stats.isSet()) stats->event("pool-hit");
+      LOG_DEBUG(4, "Reusing connection to " << key);
+
+      if (conns.empty()) pool.erase(it);
+      return conn;
+    }
+
+    pool.erase(it);
+  }
+
+  if (maxIdle && stats.isSet()) stats->event("pool-miss");
+
+  auto conn = SmartPtr(new ConnOut(base));
+  if (maxIdle) conn->setPool(this, key);
+  return conn;
+}
+
+
+void Client::release(const SmartPointer<ConnOut> &conn) {
+  auto &conns = pool[conn->getPoolKey()];
+
+  if (maxIdle <= idleCount || maxIdlePerHost <= conns.size()) {
+    if (conns.empty()) pool.erase(conn->getPoolKey());
+    return; // Will close when no longer referenced
+  }
+
+  conns.push_back(conn);
+  idleCount++;
+  conn->idle(idleTTL);
+}
+
+
+void Client::remove(const ConnOut &conn) {
+  auto it = pool.find(conn.getPoolKey());
+  if (it == pool.end()) return;
+
+  auto &conns = it->second;
+  for (auto it2 = conns.begin(); it2 != conns.end(); it2++)
+    if (it2->get() == &conn) {
+      if (stats.isSet()) stats->event("pool-evict");
+      conns.erase(it2);
+      idleCount--;
+      break;
+    }
+
+  if (conns.empty()) pool.erase(it);
+}
 
 
 void Client::send(const SmartPointer<Request> &req) const {
@@ -59,6 +134,10 @@ void Client::send(const SmartPointer<Request> &req) const {
   conn->setReadTimeout(readTimeout);
   conn->setWriteTimeout(writeTimeout);
 
+  // Ask the server to keep pooled connections open
+  if (maxIdle && !req->outHas("Connection"))
+    req->outSet("Connection", "keep-alive");
+
   // Check if already connected
   if (req->isConnected()) return conn->makeRequest(req);
 
@@ -82,7 +161,7 @@ void Client::send(const SmartPointer<Request> &req) const {
 Client::RequestPtr Client::call(
   const URI &uri, Method method, const char *data, unsigned length,
   callback_t cb) {
-  auto con = SmartPtr(new ConnOut(base));
+  auto con = acquire(uri);
   auto req = SmartPtr(new OutgoingRequest(*this, con, uri, method, cb));
 
   if (data) req->getOutputBuffer().add(data, length);
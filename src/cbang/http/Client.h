@@ -39,6 +39,7 @@
 #include <cbang/openssl/SSLContext.h>
 
 #include <map>
+#include <list>
 #include <functional>
 
 
@@ -47,6 +48,8 @@ namespace cb {
   namespace Event {class Base;}
 
   namespace HTTP {
+    class ConnOut;
+
     class Client {
       Event::Base &base;
       SmartPointer<SSLContext> sslCtx;
@@ -55,6 +58,16 @@ namespace cb {
       unsigned writeTimeout = 0;
       SmartPointer<RateSet> stats;
 
+      // Idle connection pool
+      unsigned maxIdle        = 32;
+      unsigned maxIdlePerHost = 4;
+      double   idleTTL        = 30;
+
+      typedef std::list<SmartPointer<ConnOut> > conns_t;
+      typedef std::map<std::string, conns_t> pool_t;
+      pool_t pool;
+      unsigned idleCount = 0;
+
     public:
       typedef SmartPointer<OutgoingRequest> RequestPtr;
 
@@ -85,6 +98,22 @@ namespace cb {
       const SmartPointer<RateSet> &getStats() const {return stats;}
       void setStats(const SmartPointer<RateSet> &stats) {this->stats = stats;}
 
+      /// Zero disables connection reuse
+      unsigned getMaxIdle() const {return maxIdle;}
+      void setMaxIdle(unsigned max) {maxIdle = max;}
+
+      unsigned getMaxIdlePerHost() const {return maxIdlePerHost;}
+      void setMaxIdlePerHost(unsigned max) {maxIdlePerHost = max;}
+
+      double getIdleTTL() const {return idleTTL;}
+      void setIdleTTL(double ttl) {idleTTL = ttl;}
+
+      unsigned getIdleCount() const {return idleCount;}
+
+      SmartPointer<ConnOut> acquire(const URI &uri);
+      void release(const SmartPointer<ConnOut> &conn);
+      void remove(const ConnOut &conn);
+
       void send(const SmartPointer<Request> &req) const;
 
       RequestPtr call(const URI &uri, Method method, const char *data,
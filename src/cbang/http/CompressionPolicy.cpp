@@ -0,0 +1,154 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "CompressionPolicy.h"
+#include "Request.h"
+#include "Conn.h"
+
+#include <cbang/String.h>
+#include <cbang/config/Options.h>
+#include <cbang/event/Buffer.h>
+#include <cbang/event/BufferStream.h>
+#include <cbang/comp/CompressionFilter.h>
+#include <cbang/boost/IOStreams.h>
+
+using namespace std;
+using namespace cb;
+using namespace cb::HTTP;
+
+
+CompressionPolicy::CompressionPolicy() {setMethods(methods);}
+
+
+void CompressionPolicy::setMethods(const string &methods) {
+  vector<string> names;
+  String::tokenize(methods, names, ", \t");
+
+  allowed.clear();
+  for (auto &name: names) {
+    Compression compression = compressionFromPath("." + name);
+    if (compression == Compression::COMPRESSION_NONE)
+      THROW("Unsupported HTTP compression method '" << name << "'");
+
+    if (!isAllowed(compression))
+      allowed.push_back(Method{compression, String::toLower(name)});
+  }
+
+  this->methods = methods;
+}
+
+
+void CompressionPolicy::addOptions(Options &options) {
+  options.pushCategory("HTTP Server Compression");
+  options.addTarget("http-compression", enabled, "Compress text and JSON "
+                    "responses when the client accepts it");
+  options.addTarget("http-compression-min-size", minSize, "Do not compress "
+                    "responses smaller than this many bytes");
+  options.addTarget("http-compression-max-cpu", maxCPU, "Maximum fraction of "
+                    "a CPU each connection may spend on response compression");
+  options.addTarget("http-compression-methods", methods, "Space separated "
+                    "list of allowed compression methods, most preferred "
+                    "first.  Any of gzip, zlib, lz4 and bzip2");
+  options.popCategory();
+}
+
+
+void CompressionPolicy::init() {setMethods(methods);}
+
+
+bool CompressionPolicy::isAllowed(Compression compression) const {
+  for (auto &method: allowed)
+    if (method.compression == compression) return true;
+  return false;
+}
+
+
+bool CompressionPolicy::isStreamable(Compression compression) {
+  return compression == Compression::COMPRESSION_GZIP ||
+    compression == Compression::COMPRESSION_ZLIB;
+}
+
+
+bool CompressionPolicy::isCompressible(const string &contentType) {
+  string type = String::toLower(contentType.substr(0, contentType.find(';')));
+
+  return String::startsWith(type, "text/") ||
+    String::endsWith(type, "json") || String::endsWith(type, "+xml") ||
+    type == "application/javascript" || type == "application/xml" ||
+    type == "image/svg+xml";
+}
+
+
+Compression CompressionPolicy::select(const Request &req,
+                                      int64_t length) const {
+  if (!enabled || (0 <= length && length < minSize))
+    return Compression::COMPRESSION_NONE;
+
+  auto &conn = req.getConnection();
+  if (conn.isNull() || !conn->isIncoming() || !req.mustHaveBody())
+    return Compression::COMPRESSION_NONE;
+
+  if (req.outHas("Content-Encoding") || req.outHas("Content-Range") ||
+      (0 <= length && req.outHas("Content-Length")) ||
+      !isCompressible(req.getContentType()))
+    return Compression::COMPRESSION_NONE;
+
+  if (!conn->canCompress(maxCPU)) return Compression::COMPRESSION_NONE;
+
+  // The allowed method the client ranks highest, ties in configured order
+  Compression best = Compression::COMPRESSION_NONE;
+  double bestQ = 0;
+
+  for (auto &method: allowed) {
+    if (length < 0 && !isStreamable(method.compression)) continue;
+    double q = req.getEncodingQuality(method.name);
+    if (bestQ < q) {best = method.compression; bestQ = q;}
+  }
+
+  return best;
+}
+
+
+void CompressionPolicy::compress(Compression compression,
+                                 const Event::Buffer &in, Event::Buffer &out) {
+  Event::BufferStream<> target(out);
+
+  {
+    io::filtering_ostream stream;
+    pushCompression(compression, stream);
+    stream.push(target);
+    Event::Buffer(in).copy(stream);
+  }
+
+  target.flush();
+}
@@ -0,0 +1,100 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <cbang/comp/Compression.h>
+
+#include <string>
+#include <vector>
+
+
+namespace cb {
+  class Options;
+  namespace Event {class Buffer;}
+
+  namespace HTTP {
+    class Request;
+
+    /***
+     * Server wide response compression.  When enabled, text and JSON
+     * responses of at least http-compression-min-size bytes are compressed
+     * with the allowed method the client ranks highest.  Chunked replies
+     * are compressed only with gzip or zlib, which can flush each chunk.
+     * Responses with a preset Content-Length are left alone.  Time spent
+     * compressing is limited per connection to a fraction of a CPU, above
+     * which responses are sent uncompressed.
+     */
+    class CompressionPolicy {
+      bool enabled     = false;
+      unsigned minSize = 1024;
+      double maxCPU    = 0.25;
+      std::string methods = "gzip zlib lz4";
+
+      struct Method {
+        Compression compression;
+        std::string name;
+      };
+
+      std::vector<Method> allowed; // In order of preference
+
+    public:
+      CompressionPolicy();
+
+      bool isEnabled() const {return enabled;}
+      void setEnabled(bool enabled) {this->enabled = enabled;}
+
+      unsigned getMinSize() const {return minSize;}
+      void setMinSize(unsigned size) {minSize = size;}
+
+      double getMaxCPU() const {return maxCPU;}
+      void setMaxCPU(double maxCPU) {this->maxCPU = maxCPU;}
+
+      void setMethods(const std::string &methods);
+
+      void addOptions(Options &options);
+      void init();
+
+      bool isAllowed(Compression compression) const;
+      /// True if chunks can be flushed to the client as they are sent
+      static bool isStreamable(Compression compression);
+      static bool isCompressible(const std::string &contentType);
+
+      /// @param length is the body length or -1 if not known, i.e. chunked
+      Compression select(const Request &req, int64_t length) const;
+
+      static void compress(Compression compression, const Event::Buffer &in,
+                           Event::Buffer &out);
+    };
+  }
+}
@@ -36,6 +36,7 @@
 
 #include <cbang/Catch.h>
 #include <cbang/log/Logger.h>
+#include <cbang/time/Timer.h>
 
 using namespace cb::HTTP;
 using namespace cb;
@@ -49,6 +50,19 @@ Conn::Conn(Event::Base &base) : Event::Connection(base) {}
 Conn::~Conn() {}
 
 
+bool Conn::canCompress(double maxCPU) {
+  // Compression time drains at maxCPU seconds per second
+  double now = Timer::now();
+  if (compressUpdate) {
+    compressTime -= (now - compressUpdate) * maxCPU;
+    if (compressTime < 0) compressTime = 0;
+  }
+  compressUpdate = now;
+
+  return compressTime < maxCPU;
+}
+
+
 void Conn::readChunks(
   const SmartPointer<Request> &req, function<void (bool)> cb) {
   LOG_DEBUG(4, CBANG_FUNC << "()");
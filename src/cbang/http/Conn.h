@@ -57,6 +57,9 @@ namespace cb {
       typedef std::list<SmartPointer<Request> > requests_t;
       requests_t requests;
 
+      double compressTime   = 0;
+      double compressUpdate = 0;
+
     public:
       Conn(Event::Base &base);
       virtual ~Conn();
@@ -70,6 +73,10 @@ namespace cb {
       unsigned getNumRequests() const {return requests.size();}
       const requests_t &getRequests() const {return requests;}
 
+      /// True if the time recently spent compressing is within @param maxCPU
+      bool canCompress(double maxCPU);
+      void addCompressTime(double seconds) {compressTime += seconds;}
+
       virtual bool isIncoming() const = 0;
       virtual void writeRequest(const SmartPointer<Request> &req,
                                 Event::Buffer buffer, bool hasMore = false,
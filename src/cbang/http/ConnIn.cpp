@@ -59,7 +59,7 @@ void ConnIn::writeRequest(
 
   checkActive(req);
 
-  if (getStats().isSet()) getStats()->event(req->getResponseCode().toString());
+  server.countResponse(req->getResponseCode());
 
   auto cb2 =
     [this, req, hasMore, cb] (bool success) {
@@ -73,6 +73,9 @@ void ConnIn::writeRequest(
       if (!success) return close();
       if (hasMore) return; // Still writing
 
+      req->mark(Request::TIME_WRITTEN);
+      TRY_CATCH_ERROR(server.getRequestStats().record(*req));
+
       if (getNumRequests()) pop();
 
       // Free connection if not persistent
@@ -139,6 +142,7 @@ void ConnIn::processHeader() {
   // Headers callback
   try {
     req->onHeaders();
+    req->mark(Request::TIME_HEADERS);
   } catch (const Exception &e) {
     return error((Status::enum_t)e.getCode(), e.getMessage());
   }
@@ -237,8 +241,10 @@ void ConnIn::checkChunked(const SmartPointer<Request> &req) {
 
 
 void ConnIn::processRequest(const SmartPointer<Request> &req) {
+  req->mark(Request::TIME_BODY);
   TRY_CATCH_ERROR(req->onRequest());
   server.dispatch(*req);
+  req->mark(Request::TIME_DISPATCHED);
 }
 
 
@@ -48,6 +48,49 @@ using namespace std;
 ConnOut::ConnOut(Event::Base &base) : Conn(base) {}
 
 
+void ConnOut::setPool(Client *client, const string &key) {
+  this->client = client;
+  poolKey = key;
+}
+
+
+void ConnOut::idle(double ttl) {
+  LOG_DEBUG(4, "Connection idle");
+
+  setTTL(ttl);
+
+  // Data or EOF while idle means the peer is done with us
+  auto cb = [this] (bool success) {
+    LOG_DEBUG(4, "Idle connection " << (success ? "closed by peer" : "failed"));
+    close();
+  };
+
+  // Wait without the read timeout
+  unsigned timeout = getReadTimeout();
+  setReadTimeout(0);
+  idleWatch = canRead(cb);
+  setReadTimeout(timeout);
+}
+
+
+void ConnOut::reuse() {
+  setTTL(0);
+  idleWatch.release(); // Cancels callback
+}
+
+
+void ConnOut::close() {
+  auto self = SmartPtr(this);
+
+  if (isIdle()) {
+    idleWatch.release();
+    if (client) client->remove(*this);
+  }
+
+  Conn::close();
+}
+
+
 void ConnOut::writeRequest(
   const SmartPointer<Request> &req, Event::Buffer buffer, bool hasMore,
   function<void (bool)> cb) {
@@ -208,8 +251,14 @@ void ConnOut::process(const SmartPointer<Request> &req) {
     // Callback
     req->onResponse(CONN_ERR_OK);
 
-    // If not closing send next request
-    if (!req->needsClose()) return dispatch();
+    // If not closing send next request or return to the pool
+    if (!req->needsClose()) {
+      if (client && !getNumRequests() && req->isPersistent() &&
+          !req->isWebsocket() && isConnected())
+        client->release(this);
+
+      return dispatch();
+    }
   } CATCH_ERROR;
 
   close();
@@ -34,19 +34,38 @@
 
 #include "Conn.h"
 
+#include <cbang/util/LifetimeObject.h>
+
 
 namespace cb {
   namespace HTTP {
+    class Client;
+
     class ConnOut : public Conn {
+      Client *client = 0;
+      std::string poolKey;
+      SmartPointer<LifetimeObject> idleWatch;
+
     public:
       ConnOut(Event::Base &base);
 
+      /// Return to @param client's idle pool after persistent responses
+      void setPool(Client *client, const std::string &key);
+      const std::string &getPoolKey() const {return poolKey;}
+
+      bool isIdle() const {return idleWatch.isSet();}
+      void idle(double ttl);
+      void reuse();
+
       // From Conn
       bool isIncoming() const override {return false;}
       void writeRequest(const SmartPointer<Request> &req, Event::Buffer buffer,
                         bool hasMore, std::function<void (bool)> cb) override;
       void makeRequest(const SmartPointer<Request> &req) override;
 
+      // From FD
+      void close() override;
+
     protected:
       void fail(Event::ConnectionError err, const std::string &msg);
       void readHeader(const SmartPointer<Request> &req);
@@ -0,0 +1,275 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "FileCache.h"
+
+#include <cbang/String.h>
+#include <cbang/thread/SmartLock.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/log/Logger.h>
+
+#include <cstring>
+#include <list>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+using namespace std;
+using namespace cb;
+using namespace cb::HTTP;
+
+
+namespace {
+  const char *encodings[]  = {"br", "gzip", "lz4", 0};
+  const char *extensions[] = {".br", ".gz", ".lz4", 0};
+
+
+  FileCache::File loadFile(const string &path, const string &encoding) {
+    FileCache::File file;
+
+    file.encoding = encoding;
+    file.segment = new Event::FileSegment(path);
+
+    auto &seg = *file.segment;
+    file.etag = String::printf("\"%llx-%llx-%llx", (long long)seg.getInode(),
+                               (long long)seg.getModified(),
+                               (long long)seg.getSize());
+    if (!encoding.empty()) file.etag += "-" + encoding;
+    file.etag += "\"";
+
+    return file;
+  }
+}
+
+
+struct FileCache::Private {
+  int fd = -1;
+  map<int, string> dirs;
+  map<string, int> watches;
+
+  struct Cached {
+    EntryPtr entry;
+    list<string>::iterator use;
+  };
+
+  typedef map<string, Cached> entries_t;
+  entries_t entries;
+  list<string> lru; // Most recently used first
+
+  Private() {
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1) LOG_WARNING("inotify unavailable, not caching files");
+#endif
+  }
+
+
+  ~Private() {
+#ifdef __linux__
+    if (fd != -1) ::close(fd);
+#endif
+  }
+
+
+  bool watch(const string &dir) {
+#ifdef __linux__
+    if (fd == -1) return false;
+    if (watches.find(dir) != watches.end()) return true;
+
+    uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE |
+      IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+    int wd = inotify_add_watch(fd, dir.c_str(), mask);
+    if (wd == -1) return false;
+
+    dirs[wd] = dir;
+    watches[dir] = wd;
+    return true;
+
+#else
+    return false;
+#endif
+  }
+
+
+  EntryPtr find(const string &path) {
+    auto it = entries.find(path);
+    if (it == entries.end()) return 0;
+
+    lru.splice(lru.begin(), lru, it->second.use);
+    return it->second.entry;
+  }
+
+
+  void insert(const string &path, const EntryPtr &entry, unsigned max) {
+    while (!lru.empty() && max <= entries.size())
+      erase(entries.find(lru.back()));
+
+    lru.push_front(path);
+    entries[path] = Cached{entry, lru.begin()};
+  }
+
+
+  entries_t::iterator erase(entries_t::iterator it) {
+    lru.erase(it->second.use);
+    return entries.erase(it);
+  }
+
+
+  void erase(const string &path) {
+    auto it = entries.find(path);
+    if (it != entries.end()) erase(it);
+  }
+
+
+  void clear() {
+    entries.clear();
+    lru.clear();
+  }
+
+
+  void invalidate(const string &path) {
+    erase(path);
+
+    // A changed sibling changes the variants of the original
+    for (int i = 0; extensions[i]; i++)
+      if (String::endsWith(path, extensions[i]))
+        erase(path.substr(0, path.length() - strlen(extensions[i])));
+  }
+
+
+  void invalidateDir(const string &dir) {
+    auto it = entries.lower_bound(dir + "/");
+
+    while (it != entries.end() && String::startsWith(it->first, dir + "/"))
+      it = erase(it);
+  }
+
+
+  void update() {
+#ifdef __linux__
+    if (fd == -1) return;
+
+    char buf[4096] __attribute__((aligned(__alignof__(inotify_event))));
+
+    while (true) {
+      ssize_t len = read(fd, buf, sizeof(buf));
+      if (len <= 0) break;
+
+      for (char *ptr = buf; ptr < buf + len;) {
+        auto *event = (const inotify_event *)ptr;
+        ptr += sizeof(inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+          clear();
+          continue;
+        }
+
+        auto it = dirs.find(event->wd);
+        if (it == dirs.end()) continue;
+        string dir = it->second;
+
+        if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+          invalidateDir(dir);
+
+          if (event->mask & IN_IGNORED) {
+            watches.erase(dir);
+            dirs.erase(it);
+          }
+
+        } else if (event->len) invalidate(dir + "/" + event->name);
+      }
+    }
+#endif
+  }
+};
+
+
+FileCache::FileCache(unsigned maxEntries) :
+  pri(new Private), maxEntries(maxEntries) {}
+
+
+FileCache::~FileCache() {}
+
+
+FileCache::EntryPtr FileCache::get(const string &path) {
+  SmartLock lock(this);
+
+  pri->update();
+
+  EntryPtr entry = pri->find(path);
+  if (entry.isSet()) return entry;
+
+  // Watch before loading so no change is missed
+  bool cache = maxEntries && pri->watch(SystemUtilities::dirname(path));
+
+  entry = load(path);
+  if (entry.isSet() && cache) pri->insert(path, entry, maxEntries);
+
+  return entry;
+}
+
+
+void FileCache::invalidate(const string &path) {
+  SmartLock lock(this);
+  pri->invalidate(path);
+}
+
+
+void FileCache::clear() {
+  SmartLock lock(this);
+  pri->clear();
+}
+
+
+FileCache::EntryPtr FileCache::load(const string &path) {
+  if (!SystemUtilities::isFile(path)) return 0;
+
+  EntryPtr entry = new Entry;
+  entry->file = loadFile(path, "");
+
+  // Precompressed siblings which are not older than the original
+  for (int i = 0; encodings[i]; i++) {
+    string variant = path + extensions[i];
+
+    if (SystemUtilities::isFile(variant) &&
+        entry->file.segment->getModified() <=
+        SystemUtilities::getModificationTime(variant))
+      entry->variants.push_back(loadFile(variant, encodings[i]));
+  }
+
+  return entry;
+}
@@ -0,0 +1,87 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/thread/Mutex.h>
+#include <cbang/event/FileSegment.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+
+namespace cb {
+  namespace HTTP {
+    /**
+     * Caches open files and their metadata by path.  Cached files are
+     * watched with inotify and dropped when they or their precompressed
+     * siblings change.  Without inotify nothing is cached.  Once
+     * maxEntries files are cached the least recently used is dropped.
+     */
+    class FileCache : public Mutex {
+      struct Private;
+      SmartPointer<Private> pri;
+
+      unsigned maxEntries;
+
+    public:
+      struct File {
+        std::string encoding; // Empty for identity
+        std::string etag;
+        SmartPointer<Event::FileSegment> segment;
+      };
+
+      struct Entry {
+        File file;
+        std::vector<File> variants; // Precompressed, in order of preference
+      };
+
+      typedef SmartPointer<Entry> EntryPtr;
+
+      FileCache(unsigned maxEntries = 1024);
+      ~FileCache();
+
+      unsigned getMaxEntries() const {return maxEntries;}
+      void setMaxEntries(unsigned max) {maxEntries = max;}
+
+      /// Returns null if @param path is not a regular file
+      EntryPtr get(const std::string &path);
+      void invalidate(const std::string &path);
+      void clear();
+
+      static EntryPtr load(const std::string &path);
+    };
+  }
+}
@@ -34,6 +34,8 @@
 #include "Request.h"
 
 #include <cbang/event/Buffer.h>
+#include <cbang/event/FileSegment.h>
+#include <cbang/time/Time.h>
 #include <cbang/os/SystemUtilities.h>
 #include <cbang/log/Logger.h>
 
@@ -81,12 +83,154 @@ bool FileHandler::operator()(Request &req) {
 
   LOG_INFO(5, "FileHandler() " << path);
 
-  if (!SystemUtilities::isFile(path)) return false;
+  auto entry = cache.get(path);
+  if (entry.isNull()) return false;
 
-  // Send file
-  Event::Buffer buf;
-  buf.addFile(path);
-  req.reply(buf);
+  const FileCache::File &file = selectEncoding(req, *entry);
+  auto &seg = *file.segment;
+
+  // Validators
+  if (!entry->variants.empty()) req.outSet("Vary", "Accept-Encoding");
+  req.outSet("ETag", file.etag);
+  req.outSet("Last-Modified",
+             Time(seg.getModified()).toString(Time::httpFormat));
+  req.outSet("Accept-Ranges", "bytes");
+
+  if (isNotModified(req, file)) {
+    req.reply(HTTP_NOT_MODIFIED);
+    return true;
+  }
+
+  if (!file.encoding.empty()) req.outSet("Content-Encoding", file.encoding);
+
+  // Range
+  uint64_t offset = 0;
+  uint64_t length = seg.getSize();
+  Status::enum_t code = parseRange(req, file, offset, length);
+
+  if (code == HTTP_REQUESTED_RANGE_NOT_SATISFIABLE) {
+    req.outSet("Content-Range", "bytes */" + String(seg.getSize()));
+    req.reply(code);
+    return true;
+  }
+
+  if (code == HTTP_PARTIAL_CONTENT)
+    req.outSet("Content-Range", "bytes " + String(offset) + "-" +
+               String(offset + length - 1) + "/" + String(seg.getSize()));
+
+  // An explicit length also keeps the CompressionPolicy from copying and
+  // recompressing the file on every request.  Use precompressed variants.
+  req.outSet("Content-Length", String(length));
+
+  // Send file without copying it
+  if (req.getMethod() != HTTP_HEAD && length) {
+    Event::Buffer buf;
+    buf.add(seg, offset, length);
+    req.send(buf);
+  }
+
+  req.reply(code);
 
   return true;
 }
+
+
+const FileCache::File &FileHandler::selectEncoding(
+  const Request &req, const FileCache::Entry &entry) const {
+  if (entry.variants.empty() || !req.inHas("Accept-Encoding"))
+    return entry.file;
+
+  const FileCache::File *best = &entry.file;
+  double bestQ = 0;
+
+  for (auto &variant: entry.variants) {
+    double q = req.getEncodingQuality(variant.encoding);
+    if (bestQ < q) {best = &variant; bestQ = q;}
+  }
+
+  return *best;
+}
+
+
+bool FileHandler::isNotModified(
+  const Request &req, const FileCache::File &file) const {
+  if (req.inHas("If-None-Match")) {
+    vector<string> tags;
+    String::tokenize(req.inGet("If-None-Match"), tags, ", \t");
+
+    for (auto &tag: tags)
+      if (tag == "*" || tag == file.etag || tag == "W/" + file.etag)
+        return true;
+
+    return false;
+  }
+
+  if (req.inHas("If-Modified-Since"))
+    try {
+      // Time::parse() does not fail on bad input, so only accept dates which
+      // format back to the same string.  Others, including future dates,
+      // are ignored as RFC 9110 requires.
+      string header = String::trim(req.inGet("If-Modified-Since"));
+      uint64_t since = Time::parse(header, Time::httpFormat);
+
+      if (since <= Time::now() &&
+          Time(since).toString(Time::httpFormat) == header)
+        return file.segment->getModified() <= since;
+    } catch (const Exception &e) {}
+
+  return false;
+}
+
+
+Status::enum_t FileHandler::parseRange(
+  const Request &req, const FileCache::File &file, uint64_t &offset,
+  uint64_t &length) const {
+  if (!req.inHas("Range")) return HTTP_OK;
+
+  // Send everything if the client's copy is out of date
+  if (req.inHas("If-Range")) {
+    const string &ifRange = req.inGet("If-Range");
+    uint64_t modified = file.segment->getModified();
+
+    if (ifRange != file.etag &&
+        ifRange != Time(modified).toString(Time::httpFormat)) return HTTP_OK;
+  }
+
+  // Only single byte ranges are supported, others get the whole file
+  string range = String::trim(req.inGet("Range"));
+  if (!String::startsWith(range, "bytes=")) return HTTP_OK;
+  range = String::trim(range.substr(6));
+  if (range.find(',') != string::npos) return HTTP_OK;
+
+  size_t dash = range.find('-');
+  if (dash == string::npos) return HTTP_OK;
+
+  uint64_t size = file.segment->getSize();
+  uint64_t first;
+  uint64_t last = size ? size - 1 : 0;
+
+  try {
+    if (!dash) { // Suffix
+      uint64_t suffix = String::parseU64(range.substr(1));
+      if (!suffix || !size) return HTTP_REQUESTED_RANGE_NOT_SATISFIABLE;
+      first = suffix < size ? size - suffix : 0;
+
+    } else {
+      first = String::parseU64(range.substr(0, dash));
+
+      if (dash + 1 < range.length()) {
+        last = String::parseU64(range.substr(dash + 1));
+        if (last < first) return HTTP_OK; // Invalid
+        if (size <= last) last = size - 1;
+      }
+
+      if (size <= first) return HTTP_REQUESTED_RANGE_NOT_SATISFIABLE;
+    }
+
+  } catch (const Exception &e) {return HTTP_OK;}
+
+  offset = first;
+  length = last - first + 1;
+
+  return HTTP_PARTIAL_CONTENT;
+}
@@ -33,6 +33,8 @@
 #pragma once
 
 #include "RequestHandler.h"
+#include "FileCache.h"
+#include "Status.h"
 
 #include <cbang/json/Value.h>
 #include <cbang/time/Time.h>
@@ -48,13 +50,23 @@ namespace cb {
       std::string root;
       unsigned    pathPrefix;
       bool        directory;
+      FileCache   cache;
 
     public:
       FileHandler(const JSON::ValuePtr &config);
       FileHandler(const std::string &root, unsigned pathPrefix = 0);
 
+      FileCache &getCache() {return cache;}
+
       // From RequestHandler
       bool operator()(Request &req) override;
+
+    protected:
+      const FileCache::File &selectEncoding(
+        const Request &req, const FileCache::Entry &entry) const;
+      bool isNotModified(const Request &req, const FileCache::File &file) const;
+      Status::enum_t parseRange(const Request &req, const FileCache::File &file,
+                                uint64_t &offset, uint64_t &length) const;
     };
   }
 }
@@ -33,6 +33,7 @@
 #include "HandlerGroup.h"
 #include "RE2PatternMatcher.h"
 #include "MethodMatcher.h"
+#include "URLRouter.h"
 #include "ResourceHandler.h"
 #include "IndexHandler.h"
 #include "FileHandler.h"
@@ -62,6 +63,22 @@ void HandlerGroup::addHandler(const string &pattern, const string &path) {
 }
 
 
+void HandlerGroup::addRoute(unsigned methods, const string &pattern,
+                            const SmartPointer<RequestHandler> &handler) {
+  // Consecutive routes share a URLRouter
+  if (handlers.empty() || handlers.back().get() != router.get()) {
+    router = new URLRouter;
+    addHandler(router);
+  }
+
+  SmartPointer<RequestHandler> child = handler;
+  if (methods != (unsigned)Method::HTTP_ANY)
+    child = new MethodMatcher(methods, child);
+
+  router->add(prefix + pattern, child);
+}
+
+
 SmartPointer<HandlerGroup> HandlerGroup::addGroup() {
   SmartPointer<HandlerGroup> group = new HandlerGroup;
   addHandler(group);
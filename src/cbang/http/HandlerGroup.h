@@ -33,6 +33,7 @@
 #pragma once
 
 #include "RequestHandlerFactory.h"
+#include "URLRouter.h"
 
 #include <vector>
 
@@ -44,6 +45,7 @@ namespace cb {
     class HandlerGroup : public RequestHandler {
       typedef std::vector<SmartPointer<RequestHandler> > handlers_t;
       handlers_t handlers;
+      SmartPointer<URLRouter> router;
 
       std::string prefix;
       bool autoIndex = true;
@@ -71,6 +73,10 @@ namespace cb {
       void addHandler(const std::string &pattern, const std::string &path);
       void addHandler(const std::string &path) {addHandler("", path);}
 
+      /// Add a URLPatternMatcher style route, see URLRouter
+      void addRoute(unsigned methods, const std::string &pattern,
+                    const SmartPointer<RequestHandler> &handler);
+
       SmartPointer<HandlerGroup> addGroup();
       SmartPointer<HandlerGroup>
       addGroup(unsigned methods, const std::string &pattern,
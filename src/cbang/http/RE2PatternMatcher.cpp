@@ -36,8 +36,6 @@
 #include <cbang/Exception.h>
 #include <cbang/log/Logger.h>
 
-#include <vector>
-
 #include <re2/re2.h>
 
 using namespace std;
@@ -53,7 +51,7 @@ struct RE2PatternMatcher::Private {
 
 RE2PatternMatcher::RE2PatternMatcher(
   const string &pattern, const SmartPointer<RequestHandler> &child) :
-  pri(new Private(pattern)), child(child) {
+  pri(new Private(pattern)), child(child), name(pattern) {
   if (pri->regex.error_code())
     THROW("Failed to compile RE2: " << pri->regex.error());
 
@@ -66,10 +64,13 @@ RE2PatternMatcher::RE2PatternMatcher(
 
 
 bool RE2PatternMatcher::match(const URI &uri, JSON::ValuePtr resultArgs) const {
-  int n = pri->regex.NumberOfCapturingGroups();
-  vector<RE2::Arg>   args(n);
-  vector<RE2::Arg *> argPtrs(n);
-  vector<string>     results(n);
+  // Captures beyond maxArgs are not reported
+  const int maxArgs = 16;
+  int n = min(pri->regex.NumberOfCapturingGroups(), maxArgs);
+
+  re2::StringPiece results[maxArgs];
+  RE2::Arg args[maxArgs];
+  const RE2::Arg *argPtrs[maxArgs];
 
   // Connect args
   for (int i = 0; i < n; i++) {
@@ -78,8 +79,8 @@ bool RE2PatternMatcher::match(const URI &uri, JSON::ValuePtr resultArgs) const {
   }
 
   // Attempt match
-  string path = uri.getPath();
-  if (!RE2::FullMatchN(path, pri->regex, argPtrs.data(), n)) {
+  const string &path = uri.getPath();
+  if (!RE2::FullMatchN(path, pri->regex, argPtrs, n)) {
     LOG_DEBUG(6, path << " did not match " << pri->regex.pattern());
     return false;
   }
@@ -95,7 +96,7 @@ bool RE2PatternMatcher::match(const URI &uri, JSON::ValuePtr resultArgs) const {
         auto it = names.find(i + 1);
 
         if (it != names.end() && !resultArgs->has(it->second))
-          resultArgs->insert(it->second, results[i]);
+          resultArgs->insert(it->second, results[i].as_string());
       }
   }
 
@@ -105,5 +106,11 @@ bool RE2PatternMatcher::match(const URI &uri, JSON::ValuePtr resultArgs) const {
 
 bool RE2PatternMatcher::operator()(Request &req) {
   if (!match(req.getURI(), req.getArgs())) return false;
-  return (*child)(req);
+
+  const string *pattern = req.getPattern();
+  req.setPattern(&name);
+  if ((*child)(req)) return true;
+  req.setPattern(pattern);
+
+  return false;
 }
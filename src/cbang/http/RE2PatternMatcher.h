@@ -47,6 +47,7 @@ namespace cb {
       SmartPointer<Private> pri;
       SmartPointer<RequestHandler> child;
       std::set<std::string> args;
+      std::string name;
 
     public:
       RE2PatternMatcher(const std::string &pattern,
@@ -55,6 +56,10 @@ namespace cb {
       const SmartPointer<RequestHandler> &getChild() const {return child;}
       const std::set<std::string> &getArgs() const {return args;}
 
+      /// The pattern name reported to Request::getPattern()
+      const std::string &getName() const {return name;}
+      void setName(const std::string &name) {this->name = name;}
+
       bool match(const URI &uri, JSON::ValuePtr args) const;
 
       // From RequestHandler
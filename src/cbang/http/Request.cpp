@@ -31,7 +31,8 @@
 \******************************************************************************/
 
 #include "Request.h"
-#include "Conn.h"
+#include "ConnIn.h"
+#include "Server.h"
 #include "Cookie.h"
 
 #include <cbang/Exception.h>
@@ -43,8 +44,10 @@
 #include <cbang/log/Logger.h>
 #include <cbang/json/JSON.h>
 #include <cbang/time/Time.h>
+#include <cbang/time/Timer.h>
 #include <cbang/util/Regex.h>
 #include <cbang/comp/CompressionFilter.h>
+#include <cbang/comp/ZLibDeflater.h>
 #include <cbang/boost/IOStreams.h>
 
 using namespace cb::HTTP;
@@ -67,6 +70,40 @@ namespace {
   };
 
 
+  // The Date header only changes once a second
+  const string &httpDate() {
+    thread_local uint64_t last = 0;
+    thread_local string date;
+
+    uint64_t now = Time::now();
+    if (now != last) {
+      date = Time(now).toString(Time::httpFormat);
+      last = now;
+    }
+
+    return date;
+  }
+
+
+  struct FilteringOStreamWithRef : public io::filtering_ostream {
+    SmartPointer<ostream> ref;
+    virtual ~FilteringOStreamWithRef() {reset();}
+  };
+
+
+  SmartPointer<ostream> newCompressionStream(Compression compression,
+                                             Event::Buffer &buffer) {
+    SmartPointer<ostream> target = new Event::BufferStream<>(buffer);
+
+    SmartPointer<FilteringOStreamWithRef> out = new FilteringOStreamWithRef;
+    pushCompression(compression, *out);
+    out->ref = target;
+    out->push(*target);
+
+    return out;
+  }
+
+
   const char *getContentEncoding(Compression compression) {
     switch (compression) {
     case Compression::COMPRESSION_ZLIB:  return "zlib";
@@ -87,7 +124,7 @@ Request::Request(
   const SmartPointer<Conn> &connection, Method method,
   const URI &uri, const Version &version) :
   connection(connection), method(method), uri(uri), version(version),
-  args(new JSON::Dict) {}
+  args(new JSON::Dict) {mark(TIME_CREATED);}
 
 
 Request::~Request() {}
@@ -124,6 +161,9 @@ bool Request::logResponseErrors() const {
 }
 
 
+void Request::mark(timing_t t) {times[t] = Timer::now();}
+
+
 bool Request::isConnected() const {
   return hasConnection() && connection->isConnected();
 }
@@ -244,7 +284,7 @@ void Request::setPersistent(bool x) {
 
 
 void Request::setCache(uint32_t age) {
-  string now = Time().toString(Time::httpFormat);
+  const string &now = httpDate();
 
   outSet("Date", now);
 
@@ -343,6 +383,75 @@ Compression Request::getRequestedCompression() const {
 }
 
 
+double Request::getEncodingQuality(const string &encoding) const {
+  if (!inHas("Accept-Encoding")) return 0;
+
+  vector<string> tokens;
+  String::tokenize(inGet("Accept-Encoding"), tokens, ",");
+
+  string target = String::toLower(encoding);
+  bool named = false;
+  double q = 0;
+  double other = 0;
+
+  for (auto &token: tokens) {
+    string name = String::toLower(String::trim(token));
+    double value = 1;
+
+    size_t pos = name.find(';');
+    if (pos != string::npos) {
+      string arg = String::trim(name.substr(pos + 1));
+      name = String::trim(name.substr(0, pos));
+
+      size_t eq = arg.find('=');
+      if (eq != string::npos && String::trim(arg.substr(0, eq)) == "q")
+        try {
+          value = String::parseDouble(String::trim(arg.substr(eq + 1)));
+          value = value < 0 ? 0 : (1 < value ? 1 : value);
+        } catch (...) {}
+    }
+
+    // An explicitly named encoding overrides "*", even with q=0
+    if (name == target) {q = value; named = true;}
+    else if (name == "*") other = value;
+  }
+
+  return named ? q : other;
+}
+
+
+const CompressionPolicy *Request::getCompressionPolicy() const {
+  if (connection.isNull() || !connection->isIncoming()) return 0;
+  return &connection.cast<ConnIn>()->getServer().getCompression();
+}
+
+
+Compression Request::selectCompression(int64_t length) const {
+  auto policy = getCompressionPolicy();
+  if (!policy) return COMPRESSION_NONE;
+  return policy->select(*this, length);
+}
+
+
+void Request::outTagEncoding() {
+  if (!outHas("ETag") || !outHas("Content-Encoding")) return;
+
+  // Distinguish the encoded representation's strong validator
+  string tag = outGet("ETag");
+  if (tag.length() < 2 || tag.back() != '"') return;
+
+  tag = tag.substr(0, tag.length() - 1) + "-" + outGet("Content-Encoding");
+  outSet("ETag", tag + "\"");
+}
+
+
+void Request::outAddVary(const string &header) {
+  if (!outHas("Vary")) return outSet("Vary", header);
+  if (!outputHeaders.keyContains("Vary", header))
+    outSet("Vary", outGet("Vary") + ", " + header);
+}
+
+
 bool Request::hasCookie(const string &name) const {
   if (!inHas("Cookie")) return false;
 
@@ -396,9 +505,11 @@ string Request::getOutput() const {return outputBuffer.toString();}
 
 SmartPointer<JSON::Value> Request::getInputJSON() const {
   Event::Buffer buf = inputBuffer;
-  if (!buf.getLength()) return 0;
-  Event::BufferStream<> stream(buf);
-  return JSON::Reader(stream).parse();
+  unsigned length = buf.getLength();
+  if (!length) return 0;
+
+  // Make the input contiguous, this only copies if it is fragmented
+  return JSON::BufferReader(buf.pullup(), length).parse();
 }
 
 
@@ -436,21 +547,10 @@ SmartPointer<ostream> Request::getOutputStream(Compression compression) {
   if (compression == COMPRESSION_AUTO) compression = getRequestedCompression();
   outSetContentEncoding(compression);
 
-  SmartPointer<ostream> target = new Event::BufferStream<>(outputBuffer);
-
-  if (compression == Compression::COMPRESSION_NONE) return target;
-
-  struct FilteringOStreamWithRef : public io::filtering_ostream {
-    SmartPointer<ostream> ref;
-    virtual ~FilteringOStreamWithRef() {reset();}
-  };
-
-  SmartPointer<FilteringOStreamWithRef> out = new FilteringOStreamWithRef;
-  pushCompression(compression, *out);
-  out->ref = target;
-  out->push(*target);
+  if (compression == Compression::COMPRESSION_NONE)
+    return new Event::BufferStream<>(outputBuffer);
 
-  return out;
+  return newCompressionStream(compression, outputBuffer);
 }
 
 
@@ -556,29 +656,67 @@ void Request::startChunked(Status code) {
   if (outputBuffer.getLength())
     THROW("Cannot start chunked data in output buffer");
 
+  Compression compression = selectCompression(-1);
+  if (compression != COMPRESSION_NONE) {
+    outSetContentEncoding(compression);
+    outTagEncoding();
+    outAddVary("Accept-Encoding");
+    deflater = new ZLibDeflater(compression == COMPRESSION_GZIP);
+  }
+
   outSet("Transfer-Encoding", "chunked");
   chunked = true;
   reply(code);
 }
 
 
-void Request::sendChunk(const Event::Buffer &buf) {
+void Request::sendChunk(const Event::Buffer &buf) {sendChunk(buf, 0);}
+
+
+void Request::sendChunk(const Event::Buffer &buf, function<void (bool)> cb) {
   if (!chunked) THROW("Not chunked");
+  if (deflater.isNull()) return writeChunk(buf, cb);
+
+  // Each chunk is sync flushed so the client can decode it right away
+  double start = Timer::now();
+  bool last = !buf.getLength();
+  string data = buf.toString();
+
+  if (last) {
+    data = deflater->finish();
+    deflater.release();
+
+  } else data = deflater->flush(data.data(), data.length());
 
+  if (connection.isSet()) connection->addCompressTime(Timer::now() - start);
+
+  if (!data.empty()) writeChunk(Event::Buffer(data), last ? 0 : cb);
+  if (last) writeChunk(Event::Buffer(""), cb);
+}
+
+
+void Request::writeChunk(const Event::Buffer &buf, function<void (bool)> cb) {
   LOG_DEBUG(4, "Sending " << buf.getLength() << " byte chunk");
 
   // Check for final empty chunk.  Must be before add() below
   if (!buf.getLength()) chunked = false;
 
-  if (connection.isNull()) return; // Ignore write
+  if (connection.isNull()) { // Ignore write
+    if (cb) cb(false);
+    return;
+  }
 
   Event::Buffer out;
   out.add(String::printf("%x\r\n", buf.getLength()));
   out.add(buf);
   out.add("\r\n");
 
-  auto cb = [this] (bool success) {onWriteComplete(success);};
-  connection->writeRequest(this, out, chunked || isWebsocket(), cb);
+  auto cb2 = [this, cb] (bool success) {
+    onWriteComplete(success);
+    if (cb) cb(success);
+  };
+
+  connection->writeRequest(this, out, chunked || isWebsocket(), cb2);
 }
 
 
@@ -663,7 +801,9 @@ void Request::parseResponseLine(const string &line) {
 
 
 void Request::write() {
+  markOnce(TIME_REPLY);
   if (connection.isNull()) return onWriteComplete(false); // Ignore write
+  if (!chunked && !isWebsocket()) compressOutput();
 
   Event::Buffer out;
   writeHeaders(out);
@@ -676,12 +816,35 @@ void Request::write() {
 }
 
 
+void Request::compressOutput() {
+  if (outputBuffer.isEmpty()) return;
+  if (mustHaveBody() && !hasContentType()) guessContentType();
+
+  Compression compression = selectCompression(outputBuffer.getLength());
+  if (compression == COMPRESSION_NONE) return;
+
+  double start = Timer::now();
+  Event::Buffer out;
+  CompressionPolicy::compress(compression, outputBuffer, out);
+  connection->addCompressTime(Timer::now() - start);
+
+  outAddVary("Accept-Encoding");
+
+  if (out.getLength() < outputBuffer.getLength()) {
+    outputBuffer.clear();
+    outputBuffer.add(out);
+    outSetContentEncoding(compression);
+    outTagEncoding();
+  }
+}
+
+
 void Request::writeResponse(Event::Buffer &buf) {
   buf.add(getResponseLine() + "\r\n");
 
   if (version.getMajor() == 1) {
     if (1 <= version.getMinor() && !outHas("Date"))
-      outSet("Date", Time().toString("%a, %d %b %Y %H:%M:%S GMT"));
+      outSet("Date", httpDate());
 
     // If the protocol is 1.0 and onnection was keep-alive add keep-alive
     bool keepAlive = inputHeaders.connectionKeepAlive();
@@ -53,11 +53,28 @@
 namespace cb {
   class URI;
   class SSL;
+  class ZLibDeflater;
 
   namespace HTTP {
     class Conn;
+    class CompressionPolicy;
 
     class Request : virtual public RefCounted, public Enum {
+    public:
+      /// Points in the request lifecycle, see mark()
+      typedef enum {
+        TIME_CREATED,    // Header received
+        TIME_HEADERS,    // Header parsed
+        TIME_BODY,       // Body read, before dispatch
+        TIME_DISPATCHED, // Handlers returned
+        TIME_DB_START,   // First DB query sent
+        TIME_DB_DONE,    // Last DB result received
+        TIME_REPLY,      // Response started
+        TIME_WRITTEN,    // Response written
+        TIME_COUNT
+      } timing_t;
+
+    private:
       Headers inputHeaders;
       Headers outputHeaders;
 
@@ -79,9 +96,14 @@ namespace cb {
       bool chunked  = false;
       bool replying = false;
 
+      SmartPointer<ZLibDeflater> deflater; // Compressed chunked output
+
       uint64_t bytesRead    = 0;
       uint64_t bytesWritten = 0;
 
+      double times[TIME_COUNT] = {};
+      const std::string *pattern = 0;
+
       JSON::ValuePtr args;
       JSON::ValuePtr msg;
 
@@ -153,6 +175,16 @@ namespace cb {
       uint64_t getBytesRead() const {return bytesRead;}
       uint64_t getBytesWritten() const {return bytesWritten;}
 
+      /// Record the current time for @param t, replacing any previous mark
+      void mark(timing_t t);
+      void markOnce(timing_t t) {if (!times[t]) mark(t);}
+      /// @return Timer::now() time of @param t or zero if not marked
+      double getTime(timing_t t) const {return times[t];}
+
+      /// The pattern of the route which handled this request, if any
+      const std::string *getPattern() const {return pattern;}
+      void setPattern(const std::string *pattern) {this->pattern = pattern;}
+
       bool isSecure() const;
       SSL getSSL() const;
 
@@ -187,6 +219,15 @@ namespace cb {
 
       void outSetContentEncoding(Compression compression);
       Compression getRequestedCompression() const;
+      /// Accept-Encoding quality of @param encoding, zero if not accepted
+      double getEncodingQuality(const std::string &encoding) const;
+      const CompressionPolicy *getCompressionPolicy() const;
+      /// Negotiate compression for a response of @param length or -1 if
+      /// chunked, according to the server's CompressionPolicy
+      Compression selectCompression(int64_t length) const;
+      void outAddVary(const std::string &header);
+      /// Append the Content-Encoding to a set ETag
+      void outTagEncoding();
 
       bool hasCookie(const std::string &name) const;
       std::string findCookie(const std::string &name) const;
@@ -234,6 +275,7 @@ namespace cb {
 
       virtual void startChunked(Status code = HTTP_OK);
       virtual void sendChunk(const Event::Buffer &buf);
+      void sendChunk(const Event::Buffer &buf, std::function<void (bool)> cb);
       virtual void sendChunk(const char *data, unsigned length);
       virtual SmartPointer<JSON::Writer> getJSONChunkWriter();
       virtual void endChunked();
@@ -260,6 +302,8 @@ namespace cb {
       virtual void write();
 
     protected:
+      void compressOutput();
+      void writeChunk(const Event::Buffer &buf, std::function<void (bool)> cb);
       virtual void writeResponse(Event::Buffer &buf);
       virtual void writeRequest(Event::Buffer &buf);
       void writeHeaders(Event::Buffer &buf);
@@ -0,0 +1,168 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "RequestStats.h"
+#include "Request.h"
+
+#include <cbang/String.h>
+#include <cbang/config/Options.h>
+#include <cbang/json/Sink.h>
+#include <cbang/log/Logger.h>
+#include <cbang/thread/SmartLock.h>
+
+using namespace std;
+using namespace cb;
+using namespace cb::HTTP;
+
+
+const char *RequestStats::getPhaseName(phase_t phase) {
+  switch (phase) {
+  case PHASE_HEADER:  return "header";
+  case PHASE_BODY:    return "body";
+  case PHASE_HANDLER: return "handler";
+  case PHASE_DB:      return "db";
+  case PHASE_WRITE:   return "write";
+  case PHASE_TOTAL:   return "total";
+  default: return "unknown";
+  }
+}
+
+
+double RequestStats::getDuration(const Request &req, phase_t phase) {
+  Request::timing_t start;
+  Request::timing_t end;
+
+  switch (phase) {
+  case PHASE_HEADER:
+    start = Request::TIME_CREATED; end = Request::TIME_HEADERS; break;
+  case PHASE_BODY:
+    start = Request::TIME_HEADERS; end = Request::TIME_BODY; break;
+  case PHASE_HANDLER:
+    start = Request::TIME_BODY; end = Request::TIME_DISPATCHED; break;
+  case PHASE_DB:
+    start = Request::TIME_DB_START; end = Request::TIME_DB_DONE; break;
+  case PHASE_WRITE:
+    start = Request::TIME_REPLY; end = Request::TIME_WRITTEN; break;
+  case PHASE_TOTAL:
+    start = Request::TIME_CREATED; end = Request::TIME_WRITTEN; break;
+  default: return -1;
+  }
+
+  double t0 = req.getTime(start);
+  double t1 = req.getTime(end);
+
+  return t0 && t0 <= t1 ? t1 - t0 : -1;
+}
+
+
+void RequestStats::addOptions(Options &options) {
+  options.pushCategory("HTTP Server Timing");
+  options.addTarget("http-request-timing", enabled, "Collect per endpoint "
+                    "request latency histograms.  Every request then takes "
+                    "a shared lock.");
+  options.addTarget("http-slow-request", slowThreshold, "Log requests which "
+                    "take longer than this many seconds with a breakdown of "
+                    "where the time went, whether or not timing is "
+                    "collected.  Zero to disable.");
+  options.addTarget("http-max-timing-endpoints", maxEndpoints, "The maximum "
+                    "number of endpoints to collect timing for");
+  options.popCategory();
+}
+
+
+void RequestStats::record(const Request &req) {
+  double total = getDuration(req, PHASE_TOTAL);
+  bool slow = slowThreshold && slowThreshold <= total;
+  if (!enabled && !slow) return;
+
+  double durations[PHASE_COUNT];
+  for (unsigned i = 0; i < PHASE_COUNT; i++)
+    durations[i] = getDuration(req, (phase_t)i);
+
+  string key = req.getMethod().toString() + string(" ") +
+    (req.getPattern() ? *req.getPattern() : string("*"));
+
+  if (slow) {
+    string breakdown;
+
+    for (unsigned i = 0; i < PHASE_TOTAL; i++)
+      if (0 <= durations[i])
+        breakdown += String::printf(" %s=%.3fms", getPhaseName((phase_t)i),
+                                    durations[i] * 1e3);
+
+    LOG_WARNING("Slow request " << req.getMethod() << ' ' << req.getURI()
+                << " (" << key << ") " << req.getResponseCode() << ' '
+                << String::printf("%.3fs", total) << ':' << breakdown);
+  }
+
+  if (!enabled) return;
+
+  SmartLock lock(this);
+
+  auto it = endpoints.find(key);
+  if (it == endpoints.end()) {
+    if (maxEndpoints <= endpoints.size()) return;
+    it = endpoints.insert(endpoints_t::value_type(key, new Endpoint)).first;
+  }
+
+  for (unsigned i = 0; i < PHASE_COUNT; i++)
+    if (0 <= durations[i]) it->second->phases[i].record(durations[i]);
+}
+
+
+void RequestStats::reset() {
+  SmartLock lock(this);
+  endpoints.clear();
+}
+
+
+void RequestStats::write(JSON::Sink &sink) const {
+  SmartLock lock(this);
+
+  sink.beginDict();
+
+  for (auto &p: endpoints) {
+    sink.insertDict(p.first);
+
+    for (unsigned i = 0; i < PHASE_COUNT; i++) {
+      auto &hist = p.second->phases[i];
+      if (!hist.getCount()) continue;
+      sink.beginInsert(getPhaseName((phase_t)i));
+      hist.write(sink);
+    }
+
+    sink.endDict();
+  }
+
+  sink.endDict();
+}
@@ -0,0 +1,103 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/thread/Mutex.h>
+#include <cbang/json/Serializable.h>
+#include <cbang/util/LatencyHistogram.h>
+
+#include <string>
+#include <map>
+
+
+namespace cb {
+  class Options;
+
+  namespace HTTP {
+    class Request;
+
+    /***
+     * Aggregates the lifecycle timings recorded on each Request into
+     * latency histograms per phase and endpoint.  Endpoints are keyed by
+     * method and the pattern of the route which handled the request.
+     * Collection is off by default.  Requests slower than
+     * http-slow-request are logged with their phase breakdown either way.
+     */
+    class RequestStats : public Mutex, public JSON::Serializable {
+    public:
+      typedef enum {
+        PHASE_HEADER,  // Parsing the request header
+        PHASE_BODY,    // Reading the request body
+        PHASE_HANDLER, // Running handlers up to their return
+        PHASE_DB,      // From the first DB query to the last result
+        PHASE_WRITE,   // From the start of the response until written
+        PHASE_TOTAL,
+        PHASE_COUNT
+      } phase_t;
+
+    private:
+      struct Endpoint {
+        LatencyHistogram phases[PHASE_COUNT];
+      };
+
+      typedef std::map<std::string, SmartPointer<Endpoint> > endpoints_t;
+      endpoints_t endpoints;
+
+      bool enabled          = false;
+      double slowThreshold  = 5;
+      unsigned maxEndpoints = 1024;
+
+    public:
+      static const char *getPhaseName(phase_t phase);
+      /// @return the duration of @param phase or -1 if it did not occur
+      static double getDuration(const Request &req, phase_t phase);
+
+      bool isEnabled() const {return enabled;}
+      void setEnabled(bool enabled) {this->enabled = enabled;}
+
+      double getSlowThreshold() const {return slowThreshold;}
+      void setSlowThreshold(double x) {slowThreshold = x;}
+
+      void addOptions(Options &options);
+
+      void record(const Request &req);
+      void reset();
+
+      // From JSON::Serializable
+      using JSON::Serializable::write;
+      void write(JSON::Sink &sink) const override;
+    };
+  }
+}
@@ -32,9 +32,14 @@
 
 #include "ResourceHandler.h"
 #include "Request.h"
+#include "Conn.h"
+#include "CompressionPolicy.h"
 
 #include <cbang/String.h>
 #include <cbang/util/ResourceManager.h>
+#include <cbang/event/Buffer.h>
+#include <cbang/thread/SmartLock.h>
+#include <cbang/time/Timer.h>
 
 using namespace std;
 using namespace cb;
@@ -53,7 +58,102 @@ bool ResourceHandler::operator()(Request &req) {
 
   if (!res || res->isDirectory()) return false;
 
+  if (!req.hasContentType()) req.guessContentType();
+  if (res->getVariants()) req.outAddVary("Accept-Encoding");
+
+  // Precompressed
+  const ResourceVariant *variant = selectVariant(req, *res);
+  const char *etag = variant ? variant->etag : res->getETag();
+
+  if (etag) {
+    req.outSet("ETag", etag);
+
+    if (isNotModified(req, etag)) {
+      req.reply(HTTP_NOT_MODIFIED);
+      return true;
+    }
+  }
+
+  if (variant) {
+    req.outSet("Content-Encoding", variant->encoding);
+    req.reply(HTTP_OK, variant->data, variant->length);
+    return true;
+  }
+
+  // Compress on demand
+  Compression compression = req.selectCompression(res->getLength());
+  if (compression != Compression::COMPRESSION_NONE) {
+    const string &data = compress(req, *res, compression);
+    req.outAddVary("Accept-Encoding");
+
+    if (!data.empty()) {
+      req.outSetContentEncoding(compression);
+      req.outTagEncoding(); // As the generator does
+
+      req.reply(HTTP_OK, data.data(), data.length());
+      return true;
+    }
+  }
+
+  // An explicit length keeps the CompressionPolicy from compressing the
+  // resource again on every request when it did not shrink
+  req.outSet("Content-Length", String(res->getLength()));
   req.reply(HTTP_OK, res->getData(), res->getLength());
 
   return true;
 }
+
+
+const ResourceVariant *ResourceHandler::selectVariant(
+  const Request &req, const Resource &res) const {
+  const ResourceVariant *variants = res.getVariants();
+  if (!variants || !req.inHas("Accept-Encoding")) return 0;
+
+  const ResourceVariant *best = 0;
+  double bestQ = 0;
+
+  for (unsigned i = 0; variants[i].encoding; i++) {
+    double q = req.getEncodingQuality(variants[i].encoding);
+    if (bestQ < q) {best = &variants[i]; bestQ = q;}
+  }
+
+  return best;
+}
+
+
+bool ResourceHandler::isNotModified(const Request &req,
+                                    const string &etag) const {
+  if (!req.inHas("If-None-Match")) return false;
+
+  vector<string> tags;
+  String::tokenize(req.inGet("If-None-Match"), tags, ", \t");
+
+  for (auto &tag: tags)
+    if (tag == "*" || tag == etag || tag == "W/" + etag) return true;
+
+  return false;
+}
+
+
+const string &ResourceHandler::compress(Request &req, const Resource &res,
+                                        Compression compression) {
+  key_t key(&res, compression);
+
+  {
+    SmartLock lock(this);
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+  }
+
+  double start = Timer::now();
+  Event::Buffer out;
+  CompressionPolicy::compress(
+    compression, Event::Buffer(res.getData(), res.getLength()), out);
+  req.getConnection()->addCompressTime(Timer::now() - start);
+
+  string data;
+  if (out.getLength() < res.getLength()) data = out.toString();
+
+  SmartLock lock(this);
+  return cache.insert(make_pair(key, data)).first->second;
+}
@@ -35,21 +35,43 @@
 #include "RequestHandler.h"
 
 #include <cbang/util/Resource.h>
+#include <cbang/comp/Compression.h>
+#include <cbang/thread/Mutex.h>
+
+#include <string>
+#include <map>
 
 
 namespace cb {
   namespace HTTP {
     class Request;
 
-    class ResourceHandler : public RequestHandler {
+    /***
+     * Serves compiled in resources.  Resources built with precompressed
+     * variants and ETags are served as is, with conditional requests
+     * answered from the ETag.  Otherwise, when the server compression
+     * policy selects a method, the compressed body is computed once per
+     * resource and method and then reused.
+     */
+    class ResourceHandler : public RequestHandler, public Mutex {
       const Resource &root;
 
+      typedef std::pair<const Resource *, int> key_t;
+      std::map<key_t, std::string> cache; // Empty if not worth compressing
+
     public:
       ResourceHandler(const Resource &root) : root(root) {}
       ResourceHandler(const std::string &path);
 
       // From RequestHandler
       bool operator()(Request &req) override;
+
+    protected:
+      const ResourceVariant *selectVariant(const Request &req,
+                                           const Resource &res) const;
+      bool isNotModified(const Request &req, const std::string &etag) const;
+      const std::string &compress(Request &req, const Resource &res,
+                                  Compression compression);
     };
   }
 }
@@ -36,6 +36,8 @@
 #include "Request.h"
 
 #include <cbang/config.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Event.h>
 #include <cbang/Catch.h>
 #include <cbang/log/Logger.h>
 #include <cbang/config/Options.h>
@@ -43,14 +45,45 @@
 #include <cbang/openssl/SSLContext.h>
 
 #include <cinttypes>
+#include <atomic>
 
 using namespace std;
 using namespace cb;
 using namespace cb::HTTP;
 
 
+namespace {
+  // Metrics are process wide, so each server reports under its own label
+  atomic<unsigned> nextServerID(0);
+}
+
+
 Server::Server(Event::Base &base, const SmartPointer<SSLContext> &sslCtx) :
-  Event::Server(base), sslCtx(sslCtx) {}
+  Event::Server(base), sslCtx(sslCtx), responses(600),
+  metricsLabel("server=\"" + String(nextServerID++) + "\"") {
+  auto &metrics = Metrics::instance();
+
+  for (unsigned i = 0; i < Status::getCount(); i++) {
+    unsigned code = Status::getValue(i);
+    if (code && code < responses.size())
+      responses[code] = metrics.getCounter(
+        "http_responses_total", "HTTP responses by status code",
+        metricsLabel + ",code=\"" + String(code) + "\"");
+  }
+}
+
+
+Server::~Server() {
+  if (sampleEvent.isSet()) sampleEvent->del();
+
+  // The stats may outlive this server but the counters' slots are reused
+  auto &stats = getStats();
+  if (stats.isSet())
+    for (auto &counter: responses)
+      if (counter.isSet()) stats->remove(counter);
+
+  Metrics::instance().removeLabeled(metricsLabel);
+}
 
 
 void Server::addListenPort(const SockAddr &addr) {
@@ -65,6 +98,36 @@ void Server::addSecureListenPort(const SockAddr &addr) {
 }
 
 
+void Server::countResponse(Status code) {
+  if (code < responses.size() && responses[code].isSet())
+    responses[code].inc();
+  else if (getStats().isSet()) getStats()->event(code.toString());
+}
+
+
+void Server::setStats(const SmartPointer<RateSet> &stats) {
+  Event::Server::setStats(stats);
+
+  if (stats.isNull()) {
+    if (sampleEvent.isSet()) sampleEvent->del();
+    return;
+  }
+
+  // Report response counters with the keys the stats have always used
+  for (unsigned code = 0; code < responses.size(); code++)
+    if (responses[code].isSet())
+      stats->add(Status((Status::enum_t)code).toString(), responses[code]);
+
+  // Sample every period so counts land in the period they happened
+  if (sampleEvent.isNull())
+    sampleEvent = getBase().newEvent(this, &Server::sampleStats);
+  sampleEvent->add(stats->getPeriod());
+}
+
+
+void Server::sampleStats() {if (getStats().isSet()) getStats()->sample();}
+
+
 void Server::addOptions(Options &options) {
   Event::Server::addOptions(options);
 
@@ -89,6 +152,9 @@ void Server::addOptions(Options &options) {
 
   options.popCategory();
 
+  compression.addOptions(options);
+  requestStats.addOptions(options);
+
   if (sslCtx.isSet()) {
     options.pushCategory("HTTP Server SSL");
     opt = options.add("https-addresses", "A space separated list of secure "
@@ -109,6 +175,7 @@ void Server::addOptions(Options &options) {
 
 void Server::init(Options &options) {
   Event::Server::init(options);
+  compression.init();
 
   // Configure ports
   Option::strings_t addresses = options["http-addresses"].toStrings();
@@ -155,7 +222,7 @@ SmartPointer<Event::Connection> Server::createConnection() {
 SmartPointer<Request> Server::createRequest(
   const SmartPointer<Conn> &connection, Method method, const URI &uri,
   const Version &version) {
-  return new Request(connection, method, uri, version);
+  return SmartNew<Request>(connection, method, uri, version);
 }
 
 
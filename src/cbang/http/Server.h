@@ -33,9 +33,13 @@
 #pragma once
 
 #include "HandlerGroup.h"
+#include "CompressionPolicy.h"
+#include "RequestStats.h"
+#include "Status.h"
 
 #include <cbang/event/Server.h>
 #include <cbang/net/URI.h>
+#include <cbang/util/Metrics.h>
 #include <cbang/util/Version.h>
 
 
@@ -55,8 +59,17 @@ namespace cb {
       unsigned maxBodySize   = std::numeric_limits<int>::max();
       unsigned maxHeaderSize = std::numeric_limits<int>::max();
 
+      CompressionPolicy compression;
+      RequestStats requestStats;
+
+      // Indexed by status code
+      std::vector<Metrics::Counter> responses;
+      std::string metricsLabel;
+      SmartPointer<Event::Event> sampleEvent;
+
     public:
       Server(Event::Base &base, const SmartPointer<SSLContext> &sslCtx = 0);
+      ~Server();
 
       const SmartPointer<SSLContext> &getSSLContext() const {return sslCtx;}
 
@@ -75,10 +88,24 @@ namespace cb {
       unsigned getMaxHeaderSize() const {return maxHeaderSize;}
       void setMaxHeaderSize(unsigned size) {maxHeaderSize = size;}
 
+      const CompressionPolicy &getCompression() const {return compression;}
+      CompressionPolicy &getCompression() {return compression;}
+
+      const RequestStats &getRequestStats() const {return requestStats;}
+      RequestStats &getRequestStats() {return requestStats;}
+
       void addListenPort(const SockAddr &addr);
       void addSecureListenPort(const SockAddr &addr);
 
+      void countResponse(Status code);
+
+    protected:
+      void sampleStats();
+
+    public:
+
       // From Event::Server
+      void setStats(const SmartPointer<RateSet> &stats) override;
       void addOptions(Options &options) override;
       void init(Options &options) override;
       SmartPointer<Event::Connection> createConnection() override;
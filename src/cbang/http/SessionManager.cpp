@@ -33,21 +33,110 @@
 #include "SessionManager.h"
 
 #include <cbang/config.h>
+#include <cbang/Catch.h>
 #include <cbang/config/Options.h>
 #include <cbang/util/Random.h>
 #include <cbang/json/JSON.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/thread/SmartLock.h>
+#include <cbang/thread/Thread.h>
+#include <cbang/log/Logger.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Event.h>
 
 #ifdef HAVE_OPENSSL
 #include <cbang/openssl/Digest.h>
 #endif
 
 #include <vector>
+#include <limits>
+#include <cstring>
+#include <sstream>
 
 using namespace std;
 using namespace cb;
 using namespace cb::HTTP;
 
 
+namespace {
+  const char     snapshotMagic[4] = {'C', 'B', 'S', 'S'};
+  const uint32_t snapshotVersion  = 1;
+
+
+  template <typename T>
+  void writeInt(ostream &stream, T x) {
+    stream.write((const char *)&x, sizeof(T));
+  }
+
+
+  template <typename T>
+  T readInt(istream &stream) {
+    T x;
+    stream.read((char *)&x, sizeof(T));
+    if (stream.gcount() != sizeof(T)) THROW("Truncated session snapshot");
+    return x;
+  }
+
+
+  void writeString(ostream &stream, const string &s) {
+    writeInt<uint32_t>(stream, s.length());
+    stream.write(s.data(), s.length());
+  }
+
+
+  string readString(istream &stream) {
+    uint32_t length = readInt<uint32_t>(stream);
+    string s(length, 0);
+    stream.read(&s[0], length);
+    if ((uint32_t)stream.gcount() != length)
+      THROW("Truncated session snapshot");
+    return s;
+  }
+
+
+  // Fields stored natively in snapshots, the rest are stored as JSON
+  bool isSnapshotField(const string &key) {
+    return key == "id" || key == "addr" || key == "created" ||
+      key == "last_used" || key == "user" || key == "group";
+  }
+}
+
+
+SessionManager::Entry::Entry(
+  const SmartPointer<Session> &session, uint64_t created, uint64_t lastUsed,
+  uint64_t timeout, uint64_t lifetime) :
+  session(session), created(created), lastUsed(lastUsed), timeout(timeout),
+  lifetime(lifetime) {}
+
+
+uint64_t SessionManager::Entry::getExpires() const {
+  uint64_t expires = numeric_limits<uint64_t>::max();
+
+  if (timeout) expires = lastUsed + timeout + 1;
+  if (lifetime && created + lifetime + 1 < expires)
+    expires = created + lifetime + 1;
+
+  return expires;
+}
+
+
+SessionManager::Shard::Shard() : expirations(Time::now()) {}
+
+
+SessionManager::SessionManager() : lastCleanup(0) {}
+
+
+SessionManager::SessionManager(Options &options) : SessionManager() {
+  addOptions(options);
+}
+
+
+SessionManager::~SessionManager() {
+  TRY_CATCH_ERROR(shutdown());
+  if (!snapshotPath.empty()) TRY_CATCH_ERROR(snapshot());
+}
+
+
 void SessionManager::addOptions(Options &options) {
   options.pushCategory("Session Management");
 
@@ -57,11 +146,53 @@ void SessionManager::addOptions(Options &options) {
   options.addTarget("session-lifetime", lifetime, "The maximum session "
                     "lifetime in seconds.  Zero for unlimited lifetime.");
   options.addTarget("session-cookie", cookie, "The session cookie name.");
+  options.addTarget("session-snapshot", snapshotPath, "Periodically save "
+                    "sessions to this file and restore them on restart.");
+  options.addTarget("session-snapshot-interval", snapshotInterval, "Time in "
+                    "seconds between session snapshots.");
 
   options.popCategory();
 }
 
 
+void SessionManager::init(Event::Base &base) {
+  if (snapshotPath.empty()) return;
+
+  if (SystemUtilities::exists(snapshotPath))
+    try {
+      readSnapshot(*SystemUtilities::iopen(snapshotPath));
+      LOG_INFO(1, "Restored " << getCount() << " sessions from "
+               << snapshotPath);
+    } CATCH_ERROR;
+
+  if (snapshotInterval && snapshotThread.isNull()) {
+    snapshotThread = new ThreadFunc([this] {snapshotLoop();});
+    snapshotThread->start();
+
+    snapshotEvent = base.newEvent(this, &SessionManager::queueSnapshot);
+    snapshotEvent->add(snapshotInterval);
+  }
+}
+
+
+void SessionManager::shutdown() {
+  if (snapshotEvent.isSet()) {
+    snapshotEvent->del();
+    snapshotEvent.release();
+  }
+
+  if (snapshotThread.isNull()) return;
+
+  snapshotThread->stop();
+  {
+    SmartLock lock(&snapshotCondition);
+    snapshotCondition.signal();
+  }
+  snapshotThread->wait();
+  snapshotThread.release();
+}
+
+
 string SessionManager::generateID(const SockAddr &addr) {
 #ifdef HAVE_OPENSSL
   Digest digest("sha256");
@@ -78,6 +209,18 @@ string SessionManager::generateID(const SockAddr &addr) {
 }
 
 
+unsigned SessionManager::getCount() const {
+  unsigned count = 0;
+
+  for (unsigned i = 0; i < SHARDS; i++) {
+    SmartLock lock(&shards[i]);
+    count += shards[i].sessions.size();
+  }
+
+  return count;
+}
+
+
 bool SessionManager::isExpired(const Session &session) const {
   uint64_t now = Time::now();
   uint64_t timeout = session.getU64("timeout", this->timeout);
@@ -89,19 +232,47 @@ bool SessionManager::isExpired(const Session &session) const {
 
 
 bool SessionManager::hasSession(const string &sid) const {
-  auto it = sessions.find(sid);
-  return it != sessions.end() && !isExpired(*it->second);
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
+
+  auto it = shard.sessions.find(sid);
+  return it != shard.sessions.end() && !it->second.isExpired(Time::now());
 }
 
 
 SmartPointer<Session> SessionManager::lookupSession(const string &sid) const {
-  auto it = sessions.find(sid);
-  if (it == end() || isExpired(*it->second))
+  uint64_t now = Time::now();
+  maintain(now);
+
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
+  expire(shard, now);
+
+  auto it = shard.sessions.find(sid);
+  if (it == shard.sessions.end())
     THROW("Session ID '" << sid << "' does not exist");
 
-  it->second->touch(); // Update timestamp
+  // Pick up changes to the session's timeout or lifetime
+  Entry &entry = it->second;
+  bool reschedule = refresh(entry);
 
-  return it->second;
+  if (entry.isExpired(now))
+    THROW("Session ID '" << sid << "' does not exist");
+
+  // Update timestamp, at most once per second
+  if (entry.lastUsed != now) {
+    entry.lastUsed = now;
+    entry.session->setLastUsed(now);
+    if (entry.timeout) reschedule = true;
+  }
+
+  if (reschedule) {
+    if (entry.timeout || entry.lifetime)
+      shard.expirations.schedule(entry, entry.getExpires());
+    else shard.expirations.cancel(entry);
+  }
+
+  return entry.session;
 }
 
 
@@ -116,28 +287,165 @@ SmartPointer<Session> SessionManager::openSession(const SockAddr &addr) {
 }
 
 
-void SessionManager::closeSession(const string &sid) {sessions.erase(sid);}
+void SessionManager::closeSession(const string &sid) {
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
 
+  auto it = shard.sessions.find(sid);
+  if (it == shard.sessions.end()) return;
 
-void SessionManager::addSession(const SmartPointer<Session> &session) {
-  if (isExpired(*session)) return;
+  shard.expirations.cancel(it->second);
+  shard.sessions.erase(it);
+}
 
-  auto result =
-    sessions.insert(sessions_t::value_type(session->getID(), session));
 
-  if (!result.second) result.first->second = session;
+void SessionManager::addSession(const SmartPointer<Session> &session) {
+  uint64_t now = Time::now();
+  maintain(now);
 
-  if (lastCleanup + Time::SEC_PER_HOUR < Time::now()) cleanup();
+  insert(session, session->getCreationTime(), session->getLastUsed(),
+         session->getU64("timeout", timeout),
+         session->getU64("lifetime", lifetime));
 }
 
 
 void SessionManager::cleanup() {
-  lastCleanup = Time::now();
+  uint64_t now = Time::now();
+  lastCleanup = now;
+
+  for (unsigned i = 0; i < SHARDS; i++) {
+    SmartLock lock(&shards[i]);
+    expire(shards[i], now);
+  }
+}
+
+
+void SessionManager::forEach(callback_t cb) const {
+  uint64_t now = Time::now();
+  vector<SmartPointer<Session> > sessions;
+
+  for (unsigned i = 0; i < SHARDS; i++) {
+    // Copy so callbacks run without the shard locked
+    {
+      SmartLock lock(&shards[i]);
+      sessions.reserve(shards[i].sessions.size());
+
+      for (auto &p: shards[i].sessions)
+        if (!p.second.isExpired(now)) sessions.push_back(p.second.session);
+    }
 
-  // Remove expired Sessions
-  for (auto it = sessions.begin(); it != sessions.end();)
-    if (isExpired(*it->second)) sessions.erase(it++);
-    else it++;
+    for (auto &session: sessions) cb(session);
+    sessions.clear();
+  }
+}
+
+
+void SessionManager::snapshot() const {
+  if (snapshotPath.empty()) return;
+
+  ostringstream stream;
+  writeSnapshot(stream);
+  save(stream.str());
+}
+
+
+void SessionManager::writeSnapshot(ostream &stream) const {
+  uint64_t now = Time::now();
+
+  stream.write(snapshotMagic, sizeof(snapshotMagic));
+  writeInt(stream, snapshotVersion);
+
+  for (unsigned i = 0; i < SHARDS; i++) {
+    SmartLock lock(&shards[i]);
+    writeShard(stream, shards[i], now);
+  }
+
+  writeInt<uint8_t>(stream, 0);
+  stream.flush();
+  if (stream.fail()) THROW("Failed to write session snapshot");
+}
+
+
+void SessionManager::save(const string &data) const {
+  string tmp = snapshotPath + ".tmp";
+
+  auto stream = SystemUtilities::oopen(tmp, 0600);
+  stream->write(data.data(), data.length());
+  stream->flush();
+  if (stream->fail()) THROW("Failed to write session snapshot");
+  stream.release(); // Close before rename
+
+  SystemUtilities::rename(tmp, snapshotPath);
+  LOG_DEBUG(3, "Wrote session snapshot " << snapshotPath);
+}
+
+
+void SessionManager::writeShard(ostream &stream, const Shard &shard,
+                                uint64_t now) const {
+  for (auto &p: shard.sessions) {
+    const Entry &entry = p.second;
+    if (entry.isExpired(now)) continue;
+
+    const Session &session = *entry.session;
+    JSON::Dict extra;
+
+    for (unsigned j = 0; j < session.size(); j++)
+      if (!isSnapshotField(session.keyAt(j)))
+        extra.insert(session.keyAt(j), session.get(j));
+
+    writeInt<uint8_t>(stream, 1);
+    writeString(stream, p.first);
+    writeString(stream, session.getString("addr", ""));
+    writeString(stream, session.getString("user", ""));
+    writeInt(stream, entry.created);
+    writeInt(stream, entry.lastUsed);
+    writeInt(stream, entry.timeout);
+    writeInt(stream, entry.lifetime);
+
+    vector<string> groups = session.getGroups();
+    writeInt<uint32_t>(stream, groups.size());
+    for (auto &group: groups) writeString(stream, group);
+
+    writeString(stream, extra.size() ? extra.toString(0, true) : "");
+  }
+}
+
+
+void SessionManager::readSnapshot(istream &stream) {
+  char magic[sizeof(snapshotMagic)];
+  stream.read(magic, sizeof(magic));
+
+  if (stream.gcount() != sizeof(magic) ||
+      memcmp(magic, snapshotMagic, sizeof(magic)))
+    THROW("Not a session snapshot");
+
+  uint32_t version = readInt<uint32_t>(stream);
+  if (version != snapshotVersion)
+    THROW("Unsupported session snapshot version " << version);
+
+  while (readInt<uint8_t>(stream)) {
+    SmartPointer<Session> session = new Session;
+
+    session->setID(readString(stream));
+    session->insert("addr", readString(stream));
+    string user = readString(stream);
+    if (!user.empty()) session->setUser(user);
+
+    uint64_t created  = readInt<uint64_t>(stream);
+    uint64_t lastUsed = readInt<uint64_t>(stream);
+    uint64_t timeout  = readInt<uint64_t>(stream);
+    uint64_t lifetime = readInt<uint64_t>(stream);
+    session->setCreationTime(created);
+    session->setLastUsed(lastUsed);
+
+    uint32_t groups = readInt<uint32_t>(stream);
+    for (uint32_t i = 0; i < groups; i++) session->addGroup(readString(stream));
+
+    string extra = readString(stream);
+    if (!extra.empty()) session->read(*JSON::Reader::parse(extra));
+
+    insert(session, created, lastUsed, timeout, lifetime); // Drops expired
+  }
 }
 
 
@@ -153,11 +461,115 @@ void SessionManager::read(const JSON::Value &value) {
 void SessionManager::write(JSON::Sink &sink) const {
   sink.beginDict();
 
-  for (auto &p: *this) {
-    if (isExpired(*p.second)) continue;
-    sink.beginInsert(p.first);
-    p.second->write(sink);
-  }
+  forEach([&sink] (const SmartPointer<Session> &session) {
+    sink.beginInsert(session->getID());
+    session->write(sink);
+  });
 
   sink.endDict();
 }
+
+
+SessionManager::Shard &SessionManager::getShard(const string &sid) const {
+  return shards[hash<string>()(sid) % SHARDS];
+}
+
+
+bool SessionManager::refresh(Entry &entry) const {
+  uint64_t timeout  = entry.session->getU64("timeout",  this->timeout);
+  uint64_t lifetime = entry.session->getU64("lifetime", this->lifetime);
+
+  if (timeout == entry.timeout && lifetime == entry.lifetime) return false;
+
+  entry.timeout  = timeout;
+  entry.lifetime = lifetime;
+
+  return true;
+}
+
+
+void SessionManager::insert(
+  const SmartPointer<Session> &session, uint64_t created, uint64_t lastUsed,
+  uint64_t timeout, uint64_t lifetime) {
+  uint64_t now = Time::now();
+  const string &sid = session->getID();
+
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
+  expire(shard, now);
+
+  auto it = shard.sessions.find(sid);
+  if (it != shard.sessions.end()) {
+    shard.expirations.cancel(it->second);
+    shard.sessions.erase(it);
+  }
+
+  Entry &entry = shard.sessions.emplace(
+    piecewise_construct, forward_as_tuple(sid),
+    forward_as_tuple(session, created, lastUsed, timeout, lifetime))
+    .first->second;
+
+  if (entry.isExpired(now)) shard.sessions.erase(sid);
+  else if (entry.timeout || entry.lifetime)
+    shard.expirations.schedule(entry, entry.getExpires());
+}
+
+
+void SessionManager::expire(Shard &shard, uint64_t now) const {
+  shard.expirations.expire(now, [this, &shard, now] (TimerWheel::Timer &t) {
+    Entry &entry = static_cast<Entry &>(t);
+    refresh(entry);
+
+    // Timers beyond the wheel's range fire early so check again
+    if (entry.isExpired(now)) {
+      string sid = entry.session->getID();
+      shard.sessions.erase(sid);
+
+    } else if (entry.timeout || entry.lifetime)
+      shard.expirations.schedule(entry, entry.getExpires());
+  });
+}
+
+
+void SessionManager::maintain(uint64_t now) const {
+  uint64_t last = lastCleanup;
+  if (last + Time::SEC_PER_MIN <= now &&
+      lastCleanup.compare_exchange_strong(last, now))
+    for (unsigned i = 0; i < SHARDS; i++) {
+      SmartLock lock(&shards[i]);
+      expire(shards[i], now);
+    }
+}
+
+
+void SessionManager::queueSnapshot() {
+  if (snapshotPath.empty()) return;
+
+  try {
+    // Serialize here, where sessions are changed, and write on the thread
+    ostringstream stream;
+    writeSnapshot(stream);
+
+    SmartLock lock(&snapshotCondition);
+    pendingSnapshot = stream.str();
+    snapshotCondition.signal();
+  } CATCH_ERROR;
+}
+
+
+void SessionManager::snapshotLoop() {
+  Thread &thread = Thread::current();
+
+  while (!thread.shouldShutdown()) {
+    string data;
+
+    {
+      SmartLock lock(&snapshotCondition);
+      if (pendingSnapshot.empty() && !thread.shouldShutdown())
+        snapshotCondition.wait();
+      data.swap(pendingSnapshot);
+    }
+
+    if (!data.empty()) TRY_CATCH_ERROR(save(data));
+  }
+}
@@ -30,34 +30,92 @@
 
 \******************************************************************************/
 
+
 #pragma once
 
 #include "Session.h"
 
 #include <cbang/SmartPointer.h>
+#include <cbang/thread/Mutex.h>
+#include <cbang/thread/Condition.h>
+#include <cbang/util/TimerWheel.h>
 
 #include <string>
-#include <map>
+#include <unordered_map>
+#include <functional>
+#include <iostream>
+#include <atomic>
 
 
 namespace cb {
   class Options;
+  class Thread;
+  namespace Event {class Base; class Event;}
 
   namespace HTTP {
+    /***
+     * Sessions are hashed by ID into independently locked shards.  Each
+     * shard keeps a timer wheel of session expirations so expired sessions
+     * are evicted incrementally, as shards are accessed, at a cost
+     * proportional to the number of expired sessions.  Session timeout and
+     * lifetime are read from the Session when it is added and again each
+     * time it is looked up.
+     *
+     * If session-snapshot is set, init() restores sessions from a compact
+     * binary snapshot and periodically rewrites it.  Sessions are changed
+     * by request handlers without any lock, so the snapshot is serialized
+     * by an event on the event thread and only written to disk by a
+     * separate thread.
+     */
     class SessionManager : public JSON::Serializable {
-      typedef std::map<std::string, SmartPointer<Session> > sessions_t;
-      sessions_t sessions;
+      struct Entry : public TimerWheel::Timer {
+        SmartPointer<Session> session;
+        uint64_t created;
+        uint64_t lastUsed;
+        uint64_t timeout;
+        uint64_t lifetime;
+
+        Entry(const SmartPointer<Session> &session, uint64_t created,
+              uint64_t lastUsed, uint64_t timeout, uint64_t lifetime);
+
+        uint64_t getExpires() const;
+        bool isExpired(uint64_t now) const {return getExpires() <= now;}
+      };
+
+      struct Shard : public Mutex {
+        std::unordered_map<std::string, Entry> sessions;
+        TimerWheel expirations;
+
+        Shard();
+      };
+
+      static const unsigned SHARDS = 64;
+      mutable Shard shards[SHARDS];
 
       uint64_t lifetime    = Time::SEC_PER_DAY;
       uint64_t timeout     = Time::SEC_PER_HOUR;
       std::string cookie   = "sid";
-      uint64_t lastCleanup = 0;
+      mutable std::atomic<uint64_t> lastCleanup;
+
+      std::string snapshotPath;
+      uint64_t snapshotInterval = 5 * Time::SEC_PER_MIN;
+      SmartPointer<Event::Event> snapshotEvent;
+      SmartPointer<Thread> snapshotThread;
+      Condition snapshotCondition;
+      std::string pendingSnapshot; // Guarded by snapshotCondition
 
     public:
-      SessionManager() {}
-      SessionManager(Options &options) {addOptions(options);}
+      SessionManager();
+      SessionManager(Options &options);
+      virtual ~SessionManager();
 
       void addOptions(Options &options);
+      /***
+       * Restores the session snapshot and starts snapshots, if configured.
+       * @param base must be the event loop on which sessions are used.
+       */
+      void init(Event::Base &base);
+      void shutdown();
 
       uint64_t getLifetime() const {return lifetime;}
       void setLifetime(uint64_t lifetime) {this->lifetime = lifetime;}
@@ -68,7 +126,14 @@ namespace cb {
       const std::string &getSessionCookie() const {return cookie;}
       void setSessionCookie(const std::string &cookie) {this->cookie = cookie;}
 
+      const std::string &getSnapshotPath() const {return snapshotPath;}
+      void setSnapshotPath(const std::string &path) {snapshotPath = path;}
+
+      uint64_t getSnapshotInterval() const {return snapshotInterval;}
+      void setSnapshotInterval(uint64_t x) {snapshotInterval = x;}
+
       std::string generateID(const SockAddr &addr);
+      unsigned getCount() const;
 
       virtual bool isExpired(const Session &session) const;
       virtual bool hasSession(const std::string &sid) const;
@@ -78,13 +143,32 @@ namespace cb {
       virtual void addSession(const SmartPointer<Session> &session);
       virtual void cleanup();
 
-      typedef sessions_t::const_iterator iterator;
-      iterator begin() const {return sessions.begin();}
-      iterator end() const {return sessions.end();}
+      typedef std::function<void (const SmartPointer<Session> &)> callback_t;
+      /// Calls @param cb for each unexpired session, one shard at a time
+      void forEach(callback_t cb) const;
+
+      /// Serialize and write a snapshot now, on the calling thread
+      void snapshot() const;
+      /// Must not run concurrently with changes to Sessions
+      void writeSnapshot(std::ostream &stream) const;
+      void readSnapshot(std::istream &stream);
 
       // From JSON::Serializable
       void read(const JSON::Value &value) override;
       void write(JSON::Sink &sink) const override;
+
+    protected:
+      Shard &getShard(const std::string &sid) const;
+      bool refresh(Entry &entry) const;
+      void insert(const SmartPointer<Session> &session, uint64_t created,
+                  uint64_t lastUsed, uint64_t timeout, uint64_t lifetime);
+      void save(const std::string &data) const;
+      void writeShard(std::ostream &stream, const Shard &shard,
+                      uint64_t now) const;
+      void expire(Shard &shard, uint64_t now) const;
+      void maintain(uint64_t now) const;
+      void queueSnapshot();
+      void snapshotLoop();
     };
   }
 }
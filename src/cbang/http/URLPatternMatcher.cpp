@@ -40,7 +40,7 @@ using namespace cb::HTTP;
 
 URLPatternMatcher::URLPatternMatcher(
   const string &pattern, const cb::SmartPointer<RequestHandler> &child) :
-  RE2PatternMatcher(toRE2Pattern(pattern), child) {}
+  RE2PatternMatcher(toRE2Pattern(pattern), child) {setName(pattern);}
 
 
 string URLPatternMatcher::toRE2Pattern(const string &pattern) {
@@ -0,0 +1,260 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "URLRouter.h"
+#include "URLPatternMatcher.h"
+#include "Request.h"
+
+#include <cbang/String.h>
+#include <cbang/json/Value.h>
+#include <cbang/log/Logger.h>
+
+#include <algorithm>
+
+using namespace std;
+using namespace cb;
+using namespace cb::HTTP;
+
+
+struct URLRouter::Node {
+  typedef pair<string, SmartPointer<Node> > literal_t;
+  vector<literal_t> literals; // Sorted by segment
+
+  struct Param {
+    string name;
+    string tail;
+    SmartPointer<Node> node;
+  };
+
+  vector<Param> params;
+  vector<unsigned> routes; // In the order added
+
+
+  static int compare(const string &a, const char *b, unsigned length) {
+    return a.compare(0, string::npos, b, length);
+  }
+
+
+  const Node *find(const char *segment, unsigned length) const {
+    auto it = lower_bound(
+      literals.begin(), literals.end(), make_pair(segment, length),
+      [] (const literal_t &a, const pair<const char *, unsigned> &b) {
+        return compare(a.first, b.first, b.second) < 0;
+      });
+
+    if (it != literals.end() && !compare(it->first, segment, length))
+      return it->second.get();
+
+    return 0;
+  }
+
+
+  Node &addLiteral(const string &segment) {
+    auto it = lower_bound(
+      literals.begin(), literals.end(), segment,
+      [] (const literal_t &a, const string &b) {return a.first < b;});
+
+    if (it == literals.end() || it->first != segment)
+      it = literals.insert(it, literal_t(segment, new Node));
+
+    return *it->second;
+  }
+
+
+  Node &addParam(const string &name, const string &tail) {
+    for (auto &param: params)
+      if (param.name == name && param.tail == tail) return *param.node;
+
+    params.push_back(Param{name, tail, new Node});
+    return *params.back().node;
+  }
+};
+
+
+namespace {
+  bool isLiteral(const string &s) {
+    // '.' is treated literally, anything else is left to RE2
+    return s.find_first_of("\\^$|?*+()[]{}") == string::npos;
+  }
+}
+
+
+URLRouter::URLRouter() : root(new Node) {}
+URLRouter::~URLRouter() {}
+
+
+void URLRouter::add(const string &pattern,
+                    const SmartPointer<RequestHandler> &handler) {
+  if (handler.isNull()) THROW("Handler cannot be NULL");
+
+  unsigned route = routes.size();
+  patterns.push_back(pattern);
+
+  // Parse segments, same as URLPatternMatcher::toRE2Pattern()
+  vector<string> parts;
+  String::tokenize(pattern, parts, "/");
+  if (!pattern.empty() && pattern.back() == '/') parts.push_back("");
+
+  struct Segment {string literal; string name; bool param;};
+  vector<Segment> segments;
+  bool compiled = !pattern.empty() && pattern[0] != '^';
+
+  for (auto &part: parts) {
+    if (1 < part.size() && part[0] == ':') {
+      unsigned end;
+
+      for (end = 1; end < part.size(); end++) {
+        char c = part[end];
+        if (!isalnum(c) && c != '-' && c != '_') break;
+      }
+
+      string tail = part.substr(end);
+      if (!isLiteral(tail)) compiled = false;
+      segments.push_back(Segment{tail, part.substr(1, end - 1), true});
+
+    } else {
+      if (!isLiteral(part)) compiled = false;
+      segments.push_back(Segment{part, "", false});
+    }
+  }
+
+  unsigned params = 0;
+  for (auto &seg: segments) if (seg.param) params++;
+  if (maxArgs < params) compiled = false;
+
+  if (!compiled) {
+    LOG_DEBUG(5, "URLRouter using regex for '" << pattern << "'");
+    fallbacks.push_back(route);
+
+    if (pattern.empty()) routes.push_back(handler);
+    else routes.push_back(new URLPatternMatcher(pattern, handler));
+
+    return;
+  }
+
+  Node *node = root.get();
+  for (auto &seg: segments)
+    node = seg.param ? &node->addParam(seg.name, seg.literal) :
+      &node->addLiteral(seg.literal);
+
+  node->routes.push_back(route);
+  routes.push_back(handler);
+}
+
+
+bool URLRouter::find(const string &path, unsigned after, Match &match) const {
+  Capture stack[maxArgs];
+
+  match.route = routes.size();
+  match.count = 0;
+
+  search(*root, path, 0, after, stack, 0, match);
+
+  return match.route < routes.size();
+}
+
+
+bool URLRouter::operator()(Request &req) {
+  const string &path = req.getURI().getPath();
+  auto &args = req.getArgs();
+  unsigned fallback = 0;
+  Match match;
+
+  for (unsigned after = 0; after < routes.size(); after = match.route + 1) {
+    find(path, after, match);
+
+    // Regex routes added before the next match
+    for (; fallback < fallbacks.size() && fallbacks[fallback] < match.route;
+         fallback++)
+      if ((*routes[fallbacks[fallback]])(req)) return true;
+
+    if (match.route == routes.size()) break;
+
+    LOG_DEBUG(5, path << " matched route " << match.route);
+
+    // Store args
+    if (args.isSet())
+      for (unsigned i = 0; i < match.count; i++) {
+        const Capture &cap = match.captures[i];
+
+        if (cap.length && !args->has(*cap.name))
+          args->insert(*cap.name, path.substr(cap.offset, cap.length));
+      }
+
+    const string *pattern = req.getPattern();
+    req.setPattern(&patterns[match.route]);
+    if ((*routes[match.route])(req)) return true;
+    req.setPattern(pattern);
+  }
+
+  return false;
+}
+
+
+void URLRouter::search(const Node &node, const string &path, unsigned pos,
+                       unsigned after, Capture *stack, unsigned depth,
+                       Match &match) const {
+  if (pos == path.size()) {
+    auto it = lower_bound(node.routes.begin(), node.routes.end(), after);
+
+    if (it != node.routes.end() && *it < match.route) {
+      match.route = *it;
+      match.count = depth;
+      copy(stack, stack + depth, match.captures);
+    }
+
+    return;
+  }
+
+  if (path[pos] != '/') return;
+
+  unsigned start = pos + 1;
+  size_t end = path.find('/', start);
+  if (end == string::npos) end = path.size();
+
+  const char *segment = path.data() + start;
+  unsigned length = end - start;
+
+  const Node *child = node.find(segment, length);
+  if (child) search(*child, path, end, after, stack, depth, match);
+
+  for (auto &param: node.params) {
+    unsigned tail = param.tail.size();
+
+    if (length < tail ||
+        param.tail.compare(0, tail, segment + length - tail, tail)) continue;
+
+    stack[depth] = Capture{&param.name, start, length - tail};
+    search(*param.node, path, end, after, stack, depth + 1, match);
+  }
+}
@@ -0,0 +1,105 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include "RequestHandler.h"
+
+#include <cbang/SmartPointer.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+
+
+namespace cb {
+  namespace HTTP {
+    /**
+     * Dispatches requests by URL path using a tree of path segments.
+     *
+     * Patterns use the URLPatternMatcher syntax where a segment such as
+     * ':id' or ':id.json' captures an argument.  Routes are tried in the
+     * order they were added and, like HandlerGroup, the next matching route
+     * is tried if a handler returns false.  Lookup cost depends on the depth
+     * of the path rather than on the number of routes.
+     *
+     * Patterns which cannot be expressed as path segments, such as those
+     * starting with '^' or using other regex syntax, fall back to
+     * URLPatternMatcher.  An empty pattern matches every path.
+     */
+    class URLRouter : public RequestHandler {
+      struct Node;
+      SmartPointer<Node> root;
+
+      typedef std::vector<SmartPointer<RequestHandler> > routes_t;
+      routes_t routes;
+      std::deque<std::string> patterns; // Stable for Request::setPattern()
+      std::vector<unsigned> fallbacks;
+
+    public:
+      static const unsigned maxArgs = 16;
+
+      struct Capture {
+        const std::string *name;
+        unsigned offset;
+        unsigned length;
+      };
+
+      struct Match {
+        unsigned route;
+        unsigned count;
+        Capture captures[maxArgs];
+      };
+
+      URLRouter();
+      ~URLRouter();
+
+      bool isEmpty() const {return routes.empty();}
+      unsigned getRouteCount() const {return routes.size();}
+
+      void add(const std::string &pattern,
+               const SmartPointer<RequestHandler> &handler);
+
+      /// Find the first path matching route not before @param after.
+      bool find(const std::string &path, unsigned after, Match &match) const;
+
+      // From RequestHandler
+      bool operator()(Request &req) override;
+
+    protected:
+      void search(const Node &node, const std::string &path, unsigned pos,
+                  unsigned after, Capture *stack, unsigned depth,
+                  Match &match) const;
+    };
+  }
+}
@@ -0,0 +1,561 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "BufferReader.h"
+#include "Builder.h"
+
+#include <cbang/Errors.h>
+#include <cbang/String.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cfloat>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace cb;
+using namespace cb::JSON;
+
+
+namespace {
+  inline bool isDigit(char c) {return '0' <= c && c <= '9';}
+  inline bool isAlpha(char c) {return isalpha((unsigned char)c);}
+
+
+  // Find the first quote, backslash, control or non-ASCII byte
+  inline const char *scanString(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+
+    while (16 <= end - p) {
+      __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+      // A signed compare catches both control and non-ASCII bytes
+      __m128i special =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                  _mm_cmpeq_epi8(v, slash)),
+                     _mm_cmplt_epi8(v, space));
+
+      int mask = _mm_movemask_epi8(special);
+      if (mask) return p + __builtin_ctz(mask);
+      p += 16;
+    }
+#endif
+
+    while (p < end) {
+      unsigned char c = *p;
+      if (c == '"' || c == '\\' || c < 0x20 || 0x80 <= c) break;
+      p++;
+    }
+
+    return p;
+  }
+
+
+  // Powers of ten which are exactly representable as doubles
+  const double exactPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+}
+
+
+BufferReader::BufferReader(const char *data, size_t length, bool strict,
+                           const string &name) :
+  start(data), end(data + length), ptr(data), name(name), strict(strict) {}
+
+
+BufferReader::BufferReader(const string &s, bool strict, const string &name) :
+  BufferReader(s.data(), s.length(), strict, name) {}
+
+
+void BufferReader::parse(Sink &sink, unsigned depth) {
+  if (1000 < ++depth) error("Maximum JSON parse depth reached");
+
+  switch (next()) {
+  case 'N': case 'n':
+    parseNull();
+    return sink.writeNull();
+
+  case 'T': case 'F': case 't': case 'f':
+    return sink.writeBoolean(parseBoolean());
+
+  case '-': case '.':
+  case '0': case '1': case '2': case '3': case '4':
+  case '5': case '6': case '7': case '8': case '9':
+    return parseNumber(sink);
+
+  case '"': return sink.write(parseString());
+
+  case '[':
+    sink.beginList();
+    parseList(sink, depth);
+    sink.endList();
+    return;
+
+  case '{':
+    sink.beginDict();
+    parseDict(sink, depth);
+    sink.endDict();
+    return;
+
+  default: match("NnTtFf-.0123456789\"[{");
+  }
+}
+
+
+ValuePtr BufferReader::parse() {
+  Builder builder;
+  parse(builder);
+  return builder.getRoot();
+}
+
+
+ValuePtr BufferReader::parse(const char *data, size_t length, bool strict) {
+  return BufferReader(data, length, strict).parse();
+}
+
+
+ValuePtr BufferReader::parse(const string &s, bool strict) {
+  return BufferReader(s, strict).parse();
+}
+
+
+void BufferReader::parse(const char *data, size_t length, Sink &sink,
+                         bool strict) {
+  BufferReader(data, length, strict).parse(sink);
+}
+
+
+unsigned BufferReader::getLine() const {
+  unsigned line = 0;
+  for (const char *p = start; p < ptr; p++)
+    if (*p == '\n') line++;
+  return line;
+}
+
+
+unsigned BufferReader::getColumn() const {
+  unsigned column = 0;
+  for (const char *p = ptr; start < p && p[-1] != '\n'; p--)
+    if (p[-1] != '\r') column++;
+  return column;
+}
+
+
+char BufferReader::get() {
+  if (ptr == end) error("Unexpected end of expression");
+  return *ptr++;
+}
+
+
+char BufferReader::next() {
+  while (ptr < end)
+    switch (*ptr) {
+    case '\n': case '\r': case '\t': case ' ': ptr++; break;
+
+    case '#':
+      while (ptr < end && *ptr != '\n') ptr++;
+      break;
+
+    default: return *ptr;
+    }
+
+  error("Unexpected end of expression");
+  throw "Unreachable";
+}
+
+
+bool BufferReader::tryMatch(char c) {
+  if (c == next()) {
+    ptr++;
+    return true;
+  }
+
+  return false;
+}
+
+
+char BufferReader::match(const char *chars) {
+  char x = next();
+
+  for (int i = 0; chars[i]; i++)
+    if (x == chars[i]) {
+      ptr++;
+      return x;
+    }
+
+  error(SSTR("Expected one of '" << cb::String::escapeC(chars)
+             << "' but found '" << cb::String::escapeC(string(1, x)) << '\''));
+  throw "Unreachable";
+}
+
+
+bool BufferReader::matchKeyword(const char *keyword) {
+  const char *s = ptr;
+  while (ptr < end && isAlpha(*ptr)) ptr++;
+
+  size_t len = ptr - s;
+  if (len != strlen(keyword)) return false;
+
+  for (size_t i = 0; i < len; i++)
+    if (strict ? s[i] != keyword[i] : tolower(s[i]) != keyword[i])
+      return false;
+
+  return true;
+}
+
+
+void BufferReader::parseNull() {
+  const char *s = ptr;
+
+  if (matchKeyword("null")) return;
+  if (!strict && (ptr = s, matchKeyword("none"))) return;
+
+  string value(s, ptr);
+  if (strict) error(SSTR("Expected keyword 'null' but found '" << value
+                         << '\''));
+  error(SSTR("Expected keyword 'None' or 'null' but found '" << value << '\''));
+}
+
+
+bool BufferReader::parseBoolean() {
+  const char *s = ptr;
+
+  if (matchKeyword("true")) return true;
+  ptr = s;
+  if (matchKeyword("false")) return false;
+
+  error(SSTR("Expected keyword 'true' or 'false' but found '"
+             << string(s, ptr) << "'"));
+  throw "Unreachable";
+}
+
+
+void BufferReader::parseNumber(Sink &sink) {
+  next(); // Skip leading whitespace
+
+  const char *s = ptr;
+  bool negative = false;
+  bool decimal = false;
+  bool overflow = false;
+  uint64_t mantissa = 0;
+  unsigned digits = 0; // Significant digits in mantissa
+  int exponent = 0;
+
+  // Accumulate digits while they fit, count the rest as powers of ten
+  auto digit = [&] (bool fraction) {
+    unsigned d = *ptr++ - '0';
+
+    if (!digits && !d) {if (fraction) exponent--; return;}
+
+    if (digits < 19) {
+      mantissa = mantissa * 10 + d;
+      digits++;
+      if (fraction) exponent--;
+
+    } else {
+      overflow = true;
+      if (!fraction) exponent++;
+    }
+  };
+
+  if (peek() == '-') {ptr++; negative = true;}
+
+  if (peek() == '0') digit(false);
+  else {
+    if (strict && !isDigit(peek())) error("Missing digit at start of number");
+    while (isDigit(peek())) digit(false);
+  }
+
+  bool hasDigits = s + negative < ptr;
+
+  if (peek() == '.') {
+    decimal = true;
+    ptr++;
+    if (strict && !isDigit(peek())) error("Missing digit after decimal point");
+    if (isDigit(peek())) hasDigits = true;
+    while (isDigit(peek())) digit(true);
+  }
+
+  bool validExp = true;
+  if (peek() == 'e' || peek() == 'E') {
+    decimal = true;
+    ptr++;
+
+    bool negExp = false;
+    if (peek() == '+' || peek() == '-') negExp = *ptr++ == '-';
+    if (strict && !isDigit(peek())) error("Missing digit in exponent");
+    validExp = isDigit(peek());
+
+    int exp = 0;
+    while (isDigit(peek())) {
+      if (exp < 100000) exp = exp * 10 + *ptr - '0';
+      ptr++;
+    }
+
+    exponent += negExp ? -exp : exp;
+  }
+
+  // Integers
+  if (!decimal && hasDigits && !overflow) {
+    // 20 digit integers do not fit in the mantissa
+    if (!negative) return sink.write(mantissa);
+
+    const uint64_t limit = (uint64_t)numeric_limits<int64_t>::max() + 1;
+    if (mantissa < limit) return sink.write(-(int64_t)mantissa);
+    if (mantissa == limit) return sink.write(numeric_limits<int64_t>::min());
+  }
+
+  // Exact floating-point when both mantissa and power of ten are exact
+#if FLT_EVAL_METHOD == 0
+  if (hasDigits && validExp && !overflow && mantissa < (1ULL << 53) &&
+      -22 <= exponent && exponent <= 22) {
+    double v = (double)mantissa;
+    if (exponent < 0) v /= exactPow10[-exponent];
+    else v *= exactPow10[exponent];
+
+    // Keep the sign of negative zero
+    return sink.write(negative ? -v : v);
+  }
+#endif
+
+  // Everything else goes through strtod() which needs a terminated copy
+  size_t length = ptr - s;
+  char buf[64];
+  string big;
+  const char *str = buf;
+
+  if (length < sizeof(buf)) {
+    memcpy(buf, s, length);
+    buf[length] = 0;
+
+  } else str = (big = string(s, length)).c_str();
+
+  char *stop;
+  errno = 0;
+
+  if (!decimal && negative) {
+    long long int v = strtoll(str, &stop, 10);
+    if (!errno && (size_t)(stop - str) == length)
+      return sink.write((int64_t)v);
+
+  } else if (!decimal) {
+    long long unsigned v = strtoull(str, &stop, 10);
+    if (!errno && (size_t)(stop - str) == length)
+      return sink.write((uint64_t)v);
+  }
+
+  errno = 0;
+  double v = strtod(str, &stop);
+  if (errno || (size_t)(stop - str) != length)
+    error(SSTR("Invalid JSON number '" << string(s, length) << "'"));
+  sink.write(v);
+}
+
+
+string BufferReader::parseString() {
+  match("\"");
+
+  string s;
+
+  while (true) {
+    // Copy runs of ordinary characters in one go
+    const char *run = scanString(ptr, end);
+    s.append(ptr, run);
+    ptr = run;
+
+    if (ptr == end) break;
+    unsigned char c = *ptr++;
+
+    if (c == '"') return s;
+
+    if (c == '\\') {
+      c = get();
+
+      switch (c) {
+      case '"': case '\\': case '/': s += c; break;
+      case 'b': s += '\b'; break;
+      case 'f': s += '\f'; break;
+      case 'n': s += '\n'; break;
+      case 'r': s += '\r'; break;
+      case 't': s += '\t'; break;
+
+      case 'x': {
+        if (strict) error("Hex escape sequence not allowed in JSON");
+
+        uint16_t code = 0;
+        for (unsigned i = 0; i < 2; i++) {
+          code <<= 4;
+          c = get();
+          if ('0' <= c && c <= '9') code += c - '0';
+          else if ('a' <= c && c <= 'f') code += c - 'a' + 10;
+          else if ('A' <= c && c <= 'F') code += c - 'A' + 10;
+          else error(SSTR("Invalid hex character '" << String::escapeC(c)
+                          << "' in JSON string"));
+        }
+
+        s += code;
+        break;
+      }
+
+      case 'u': {
+        uint16_t code = 0;
+
+        for (unsigned i = 0; i < 4; i++) {
+          code <<= 4;
+          c = get();
+
+          if ('0' <= c && c <= '9') code += c - '0';
+          else if ('a' <= c && c <= 'f') code += c - 'a' + 10;
+          else if ('A' <= c && c <= 'F') code += c - 'A' + 10;
+          else error("Invalid unicode escape sequence in JSON");
+        }
+
+        if (code < 0x80) s += (char)code;
+        else if (code < 0x800) {
+          s += 0xc0 | (code >> 6);
+          s += 0x80 | (code & 0x3f);
+
+        } else {
+          s += 0xe0 | (code >> 12);
+          s += 0x80 | ((code >> 6) & 0x3f);
+          s += 0x80 | (code & 0x3f);
+        }
+
+        break;
+      }
+
+      default:
+        if ('0' <= c && c <= '7') {
+          if (strict) error("Hex escape sequence not allowed in JSON");
+
+          uint16_t code = 0;
+          for (unsigned i = 0; i < 3; i++) {
+            code <<= 3;
+            if (i) c = get();
+            if ('0' <= c && c <= '7') code += c - '0';
+            else error(SSTR("Invalid octal character '" << String::escapeC(c)
+                            << "' in JSON string"));
+          }
+
+          if (0377 < code) error("Invalid octal code in JSON string");
+          s += code;
+
+        } else error(SSTR("Invalid string escape character '"
+                          << String::escapeC(c) << "' in JSON"));
+      }
+
+    } else if (c == '\n') error("Unescaped new line in JSON string");
+    else if (c < 0x20) error("Control characters not allowed in JSON strings");
+
+    else {
+      // Check UTF-8 encoding, see Reader::parseString()
+      unsigned width = 0;
+      if ((c & 0xe0) == 0xc0) width = 1;
+      else if ((c & 0xf0) == 0xe0) width = 2;
+      else if ((c & 0xf8) == 0xf0) width = 3;
+      else error(SSTR("Invalid UTF-8 byte '" <<
+                      String::printf("0x%02x", (unsigned)c)
+                      << " in JSON string"));
+
+      if (end - ptr < width) error("Incomplete UTF-8 sequence in JSON string");
+      for (unsigned i = 0; i < width; i++)
+        if ((ptr[i] & 0xc0) != 0x80)
+          error("Incomplete UTF-8 sequence in JSON string");
+
+      s += c;
+      s.append(ptr, width);
+      ptr += width;
+    }
+  }
+
+  error("Unclosed string in JSON");
+  throw "Unreachable";
+}
+
+
+void BufferReader::parseList(Sink &sink, unsigned depth) {
+  match("[");
+
+  bool comma = false;
+
+  while (true) {
+    if (tryMatch(']')) {
+      // Empty list or trailing comma
+      if (strict && comma) error("Trailing comma not allowed in JSON list");
+      return;
+    }
+
+    sink.beginAppend();
+    parse(sink, depth);
+
+    if (match(",]") == ']') return; // Continuation or end
+    comma = true;
+  }
+}
+
+
+void BufferReader::parseDict(Sink &sink, unsigned depth) {
+  match("{");
+
+  bool comma = false;
+
+  while (true) {
+    if (tryMatch('}')) {
+      // Empty dict or trailing comma
+      if (strict && comma) error("Trailing comma not allowed in JSON dict");
+      return;
+    }
+
+    string key = parseString();
+    match(":");
+    sink.beginInsert(key);
+    parse(sink, depth);
+
+    if (match(",}") == '}') return; // Continuation or end
+    comma = true;
+  }
+}
+
+
+void BufferReader::error(const string &msg) const {
+  throw ParseError(msg, FileLocation(name, getLine(), getColumn()));
+}
@@ -0,0 +1,99 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include "Value.h"
+
+#include <string>
+
+
+namespace cb {
+  namespace JSON {
+    class Sink;
+
+    /**
+     * Parses JSON directly from a contiguous block of memory.  Accepts the
+     * same syntax and emits the same Sink events as Reader but scans
+     * strings a block at a time and parses numbers without allocating.
+     * The data must remain valid while parsing.
+     */
+    class BufferReader {
+      const char *start;
+      const char *end;
+      const char *ptr;
+      std::string name;
+      bool strict;
+
+    public:
+      BufferReader(const char *data, size_t length, bool strict = false,
+                   const std::string &name = "<memory>");
+      BufferReader(const std::string &s, bool strict = false,
+                   const std::string &name = "<memory>");
+
+      bool getStrict() const {return strict;}
+      void setStrict(bool strict) {this->strict = strict;}
+
+      void parse(Sink &sink, unsigned depth = 0);
+      ValuePtr parse();
+      static ValuePtr parse(const char *data, size_t length,
+                            bool strict = false);
+      static ValuePtr parse(const std::string &s, bool strict = false);
+      static void parse(const char *data, size_t length, Sink &sink,
+                        bool strict = false);
+
+      size_t getOffset() const {return ptr - start;}
+      unsigned getLine() const;
+      unsigned getColumn() const;
+
+      bool good() const {return ptr < end;}
+
+    protected:
+      char peek() const {return ptr < end ? *ptr : 0;}
+      char get();
+      char next();
+      bool tryMatch(char c);
+      char match(const char *chars);
+
+      bool matchKeyword(const char *keyword);
+      void parseNull();
+      bool parseBoolean();
+      void parseNumber(Sink &sink);
+      std::string parseString();
+      void parseList(Sink &sink, unsigned depth);
+      void parseDict(Sink &sink, unsigned depth);
+
+      void error(const std::string &msg) const;
+    };
+  }
+}
@@ -0,0 +1,543 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "CompactBuilder.h"
+#include "BufferReader.h"
+#include "Dict.h"
+#include "List.h"
+#include "String.h"
+#include "Number.h"
+#include "Null.h"
+#include "True.h"
+#include "False.h"
+
+#include <cbang/Exception.h>
+#include <cbang/util/Arena.h>
+#include <cbang/os/SystemUtilities.h>
+
+#include <atomic>
+#include <functional>
+
+using namespace std;
+using namespace cb;
+using namespace cb::JSON;
+
+
+/**
+ * Owns the Arena and counts references to every node in it.  The child
+ * pointers stored in the tree itself are counted too, the Document is freed
+ * when only those remain.
+ */
+class CompactBuilder::Document : public RefCounter {
+  atomic<unsigned> count;
+  unsigned internal = 0;
+  bool sealed = false;
+
+public:
+  Arena arena;
+
+  Document() : count(0) {}
+
+  void seal() {internal = count; sealed = true;}
+  bool isSealed() const {return sealed;}
+
+
+  template <typename T, typename... Args>
+  T *create(Args &&...args) {
+    T *node = arena.construct<T>(forward<Args>(args)...);
+    setRefPtr(node);
+    return node;
+  }
+
+
+  ValuePtr *link(Value *const *values, unsigned n) {
+    ValuePtr *ptrs = arena.allocateArray<ValuePtr>(n);
+
+    // Values outside the arena are static singletons
+    for (unsigned i = 0; i < n; i++) {
+      RefCounter *counter = getRefPtr(values[i]);
+      if (!counter) counter = RefCounterPhonyImpl::create(values[i]);
+      new (&ptrs[i]) ValuePtr(values[i], counter);
+    }
+
+    return ptrs;
+  }
+
+
+  // From RefCounter
+  unsigned getCount() const override {return count - internal;}
+  void incCount() override {count++;}
+
+  void decCount() override {
+    unsigned c = count--;
+    if (!c) raise("Already zero!");
+    if (sealed && c - 1 == internal) delete this;
+  }
+
+  void adopted() override {raise("Can't adopt compact JSON value!");}
+};
+
+
+namespace {
+  void readOnly() {CBANG_TYPE_ERROR("Compact JSON value is read-only");}
+
+
+  bool isSimple(const ValuePtr *values, unsigned n) {
+    for (unsigned i = 0; i < n; i++)
+      if (values[i]->isList() || values[i]->isDict()) return false;
+    return true;
+  }
+
+
+  class CompactList : public Value {
+    const ValuePtr *values;
+    unsigned n;
+    bool simple;
+
+  public:
+    CompactList(const ValuePtr *values, unsigned n) :
+      values(values), n(n), simple(::isSimple(values, n)) {}
+
+    // From Value
+    ValueType getType() const override {return JSON_LIST;}
+    bool isList() const override {return true;}
+    bool isSimple() const override {return simple;}
+
+
+    ValuePtr copy(bool deep) const override {
+      ValuePtr c = createList();
+      for (unsigned i = 0; i < n; i++)
+        c->append(deep ? values[i]->copy(true) : values[i]);
+      return c;
+    }
+
+
+    Value &getList() override {return *this;}
+    const Value &getList() const override {return *this;}
+
+    bool toBoolean() const override {return n;}
+    unsigned size() const override {return n;}
+
+
+    const ValuePtr &get(unsigned i) const override {
+      if (n <= i) CBANG_KEY_ERROR("Index " << i << " out of range");
+      return values[i];
+    }
+
+
+    void append(const ValuePtr &value) override {readOnly();}
+    void set(unsigned i, const ValuePtr &value) override {readOnly();}
+    void clear() override {readOnly();}
+    void erase(unsigned i) override {readOnly();}
+
+
+    void write(Sink &sink) const override {
+      sink.beginList(simple);
+
+      for (unsigned i = 0; i < n; i++) {
+        if (!values[i]->canWrite(sink)) continue;
+        sink.beginAppend();
+        values[i]->write(sink);
+      }
+
+      sink.endList();
+    }
+
+
+    void visitChildren(const_visitor_t visitor, bool depthFirst) const override {
+      for (unsigned i = 0; i < n; i++) {
+        const Value &child = *values[i];
+
+        if (depthFirst) child.visitChildren(visitor, depthFirst);
+        visitor(child, this, i);
+        if (!depthFirst) child.visitChildren(visitor, depthFirst);
+      }
+    }
+
+
+    void visitChildren(visitor_t visitor, bool depthFirst) override {
+      for (unsigned i = 0; i < n; i++) {
+        Value &child = *values[i];
+
+        if (depthFirst) child.visitChildren(visitor, depthFirst);
+        visitor(child, this, i);
+        if (!depthFirst) child.visitChildren(visitor, depthFirst);
+      }
+    }
+
+    using Value::getList;
+    using Value::get;
+    using Value::append;
+    using Value::set;
+    using Value::erase;
+  };
+
+
+  class CompactDict : public Value {
+    const string *keys;
+    const ValuePtr *values;
+    unsigned n;
+    bool simple;
+
+    // Open addressing index of i + 1, only for larger dicts
+    const uint32_t *index;
+    uint32_t mask;
+
+  public:
+    static const unsigned linearMax = 8;
+
+    CompactDict(const string *keys, const ValuePtr *values, unsigned n,
+                const uint32_t *index, uint32_t mask) :
+      keys(keys), values(values), n(n), simple(::isSimple(values, n)),
+      index(index), mask(mask) {}
+
+    static size_t hash(const string &key) {return std::hash<string>()(key);}
+
+    // From Value
+    ValueType getType() const override {return JSON_DICT;}
+    bool isDict() const override {return true;}
+    bool isSimple() const override {return simple;}
+
+
+    ValuePtr copy(bool deep) const override {
+      ValuePtr c = createDict();
+      for (unsigned i = 0; i < n; i++)
+        c->insert(keys[i], deep ? values[i]->copy(true) : values[i]);
+      return c;
+    }
+
+
+    Value &getDict() override {return *this;}
+    const Value &getDict() const override {return *this;}
+
+    bool toBoolean() const override {return n;}
+    unsigned size() const override {return n;}
+
+
+    const string &keyAt(unsigned i) const override {
+      if (n <= i) CBANG_KEY_ERROR("Index " << i << " out of range");
+      return keys[i];
+    }
+
+
+    int indexOf(const string &key) const override {
+      if (!index) {
+        for (unsigned i = 0; i < n; i++)
+          if (keys[i] == key) return i;
+        return -1;
+      }
+
+      for (uint32_t slot = hash(key) & mask; index[slot];
+           slot = (slot + 1) & mask)
+        if (keys[index[slot] - 1] == key) return index[slot] - 1;
+
+      return -1;
+    }
+
+
+    const ValuePtr &get(unsigned i) const override {
+      if (n <= i) CBANG_KEY_ERROR("Index " << i << " out of range");
+      return values[i];
+    }
+
+
+    const ValuePtr &get(const string &key) const override {
+      int i = indexOf(key);
+      if (i == -1) CBANG_KEY_ERROR("Key '" << key << "' not found");
+      return values[i];
+    }
+
+
+    int insert(const string &key, const ValuePtr &value) override
+    {readOnly(); return -1;}
+    void clear() override {readOnly();}
+    void erase(unsigned i) override {readOnly();}
+    void erase(const string &key) override {readOnly();}
+
+
+    void write(Sink &sink) const override {
+      sink.beginDict(simple);
+
+      for (unsigned i = 0; i < n; i++) {
+        if (!values[i]->canWrite(sink)) continue;
+        sink.beginInsert(keys[i]);
+        values[i]->write(sink);
+      }
+
+      sink.endDict();
+    }
+
+
+    void visitChildren(const_visitor_t visitor, bool depthFirst) const override {
+      for (unsigned i = 0; i < n; i++) {
+        const Value &child = *values[i];
+
+        if (depthFirst) child.visitChildren(visitor, depthFirst);
+        visitor(child, this, i);
+        if (!depthFirst) child.visitChildren(visitor, depthFirst);
+      }
+    }
+
+
+    void visitChildren(visitor_t visitor, bool depthFirst) override {
+      for (unsigned i = 0; i < n; i++) {
+        Value &child = *values[i];
+
+        if (depthFirst) child.visitChildren(visitor, depthFirst);
+        visitor(child, this, i);
+        if (!depthFirst) child.visitChildren(visitor, depthFirst);
+      }
+    }
+
+    using Value::getDict;
+    using Value::get;
+    using Value::insert;
+    using Value::erase;
+  };
+}
+
+
+CompactBuilder::CompactBuilder() : doc(new Document) {}
+
+
+CompactBuilder::~CompactBuilder() {
+  // Once sealed the Document is freed by its references
+  if (!doc->isSealed()) delete doc;
+}
+
+
+ValuePtr CompactBuilder::getRoot() {
+  if (rootPtr.isSet() || !root) return rootPtr;
+  if (!frames.empty()) THROW("Incomplete JSON");
+
+  // A lone null or boolean is a static singleton, the Arena is unused
+  if (!RefCounter::getRefPtr(root))
+    return rootPtr = ValuePtr(root, RefCounterPhonyImpl::create(root));
+
+  doc->seal();
+  return rootPtr = root;
+}
+
+
+ValuePtr CompactBuilder::build(function<void (Sink &sink)> cb) {
+  CompactBuilder builder;
+  cb(builder);
+  return builder.getRoot();
+}
+
+
+ValuePtr CompactBuilder::parse(const char *data, size_t length, bool strict) {
+  CompactBuilder builder;
+  BufferReader(data, length, strict).parse(builder);
+  return builder.getRoot();
+}
+
+
+ValuePtr CompactBuilder::parse(const string &s, bool strict) {
+  return parse(s.data(), s.length(), strict);
+}
+
+
+ValuePtr CompactBuilder::parseFile(const string &path, bool strict) {
+  string data = SystemUtilities::read(path);
+  CompactBuilder builder;
+  BufferReader(data, strict, path).parse(builder);
+  return builder.getRoot();
+}
+
+
+void CompactBuilder::writeNull() {
+  place();
+  add(&Null::instance());
+}
+
+
+void CompactBuilder::writeBoolean(bool value) {
+  place();
+  add(value ? (Value *)&True::instance() : (Value *)&False::instance());
+}
+
+
+void CompactBuilder::write(double value) {
+  place();
+  add(doc->create<Number>(value));
+}
+
+
+void CompactBuilder::write(uint64_t value) {
+  place();
+  add(doc->create<U64>(value));
+}
+
+
+void CompactBuilder::write(int64_t value) {
+  place();
+  add(doc->create<S64>(value));
+}
+
+
+void CompactBuilder::write(const string &value) {
+  place();
+  String *node = doc->create<String>(value);
+  doc->arena.addCleanup(node, [] (void *ptr) {((String *)ptr)->~String();});
+  add(node);
+}
+
+
+void CompactBuilder::beginList(bool simple) {
+  place();
+  frames.push_back(Frame{(unsigned)values.size(), (unsigned)keys.size(), false});
+}
+
+
+void CompactBuilder::beginAppend() {
+  if (frames.empty() || frames.back().dict) TYPE_ERROR("Not a List");
+  assertNotPending();
+  appendNext = true;
+}
+
+
+void CompactBuilder::endList() {
+  assertNotPending();
+  if (frames.empty() || frames.back().dict) TYPE_ERROR("Not a List");
+
+  unsigned start = frames.back().values;
+  unsigned n = values.size() - start;
+  frames.pop_back();
+
+  const ValuePtr *ptrs = doc->link(values.data() + start, n);
+  values.resize(start);
+
+  add(doc->create<CompactList>(ptrs, n));
+}
+
+
+void CompactBuilder::beginDict(bool simple) {
+  place();
+  frames.push_back(Frame{(unsigned)values.size(), (unsigned)keys.size(), true});
+}
+
+
+bool CompactBuilder::has(const string &key) const {
+  if (frames.empty() || !frames.back().dict) TYPE_ERROR("Not a Dict");
+
+  for (unsigned i = frames.back().keys; i < keys.size(); i++)
+    if (keys[i] == key) return true;
+
+  return false;
+}
+
+
+void CompactBuilder::beginInsert(const string &key) {
+  if (frames.empty() || !frames.back().dict) TYPE_ERROR("Not a Dict");
+  assertNotPending();
+  keys.push_back(key);
+  insertNext = true;
+}
+
+
+void CompactBuilder::endDict() {
+  assertNotPending();
+  if (frames.empty() || !frames.back().dict) TYPE_ERROR("Not a Dict");
+
+  unsigned valueStart = frames.back().values;
+  unsigned keyStart = frames.back().keys;
+  unsigned count = values.size() - valueStart;
+  frames.pop_back();
+
+  Arena &arena = doc->arena;
+  string *dictKeys = arena.allocateArray<string>(count);
+  Value **dictValues = arena.allocateArray<Value *>(count);
+  uint32_t *index = 0;
+  uint32_t mask = 0;
+
+  if (CompactDict::linearMax < count) {
+    uint32_t size = 16;
+    while (size < count * 2) size <<= 1;
+    mask = size - 1;
+    index = arena.allocateArray<uint32_t>(size);
+    fill(index, index + size, 0);
+  }
+
+  // Later duplicate keys replace the value in place like Dict::insert()
+  unsigned n = 0;
+  for (unsigned i = 0; i < count; i++) {
+    string &key = keys[keyStart + i];
+    Value *value = values[valueStart + i];
+
+    uint32_t *slot = 0;
+    int existing = -1;
+
+    if (index) {
+      for (uint32_t s = CompactDict::hash(key) & mask; ; s = (s + 1) & mask)
+        if (!index[s]) {slot = &index[s]; break;}
+        else if (dictKeys[index[s] - 1] == key) {existing = index[s] - 1; break;}
+
+    } else
+      for (unsigned j = 0; j < n && existing == -1; j++)
+        if (dictKeys[j] == key) existing = j;
+
+    if (existing != -1) {dictValues[existing] = value; continue;}
+
+    string *k = new (&dictKeys[n]) string(std::move(key));
+    arena.addCleanup(k, [] (void *ptr) {((string *)ptr)->~string();});
+    dictValues[n] = value;
+    if (slot) *slot = ++n;
+    else n++;
+  }
+
+  const ValuePtr *ptrs = doc->link(dictValues, n);
+  values.resize(valueStart);
+  keys.resize(keyStart);
+
+  add(doc->create<CompactDict>(dictKeys, ptrs, n, index, mask));
+}
+
+
+void CompactBuilder::place() {
+  if (appendNext) appendNext = false;
+  else if (insertNext) insertNext = false;
+  else if (!frames.empty() || root) THROW("Cannot add value");
+}
+
+
+void CompactBuilder::add(Value *value) {
+  if (frames.empty()) root = value;
+  else values.push_back(value);
+}
+
+
+void CompactBuilder::assertNotPending() {
+  if (appendNext) THROW("Already called append()");
+  if (insertNext) THROW("Already called insert()");
+}
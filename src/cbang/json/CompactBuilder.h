@@ -0,0 +1,109 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include "Sink.h"
+#include "Value.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+
+namespace cb {
+  namespace JSON {
+    /**
+     * Builds an immutable JSON tree in a single Arena.  The result is read
+     * through the normal Value interface but may not be modified.
+     *
+     * All nodes of a tree share one reference counter so a ValuePtr to any
+     * node keeps the whole tree alive.  Dicts with few keys are searched
+     * linearly, larger ones through a flat hash index.
+     */
+    class CompactBuilder : public Sink {
+      class Document;
+      Document *doc;
+
+      // Children of the open Lists and Dicts
+      std::vector<Value *> values;
+      std::vector<std::string> keys;
+
+      struct Frame {
+        unsigned values;
+        unsigned keys;
+        bool dict;
+      };
+
+      std::vector<Frame> frames;
+      Value *root = 0;
+      ValuePtr rootPtr;
+
+      bool appendNext = false;
+      bool insertNext = false;
+
+    public:
+      CompactBuilder();
+      ~CompactBuilder();
+
+      ValuePtr getRoot();
+
+      static ValuePtr build(std::function<void (Sink &sink)> cb);
+      static ValuePtr parse(const char *data, size_t length,
+                            bool strict = false);
+      static ValuePtr parse(const std::string &s, bool strict = false);
+      static ValuePtr parseFile(const std::string &path, bool strict = false);
+
+      // From Sink
+      void writeNull() override;
+      void writeBoolean(bool value) override;
+      void write(double value) override;
+      void write(uint64_t value) override;
+      void write(int64_t value) override;
+      void write(const std::string &value) override;
+      using Sink::write;
+      void beginList(bool simple = false) override;
+      void beginAppend() override;
+      void endList() override;
+      void beginDict(bool simple = false) override;
+      bool has(const std::string &key) const override;
+      void beginInsert(const std::string &key) override;
+      void endDict() override;
+
+    protected:
+      void place();
+      void add(Value *value);
+      void assertNotPending();
+    };
+  }
+}
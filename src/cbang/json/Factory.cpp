@@ -43,10 +43,11 @@
 
 using namespace std;
 using namespace cb::JSON;
+using namespace cb;
 
 
-ValuePtr Factory::createDict() const {return new Dict;}
-ValuePtr Factory::createList() const {return new List;}
+ValuePtr Factory::createDict() const {return SmartNew<Dict>();}
+ValuePtr Factory::createList() const {return SmartNew<List>();}
 ValuePtr Factory::createUndefined() const {return Undefined::instancePtr();}
 ValuePtr Factory::createNull() const {return Null::instancePtr();}
 
@@ -56,7 +57,7 @@ ValuePtr Factory::createBoolean(bool value) const {
 }
 
 
-ValuePtr Factory::create(double value) const {return new Number(value);}
+ValuePtr Factory::create(double value) const {return SmartNew<Number>(value);}
 ValuePtr Factory::create(float value) const {return create((double)value);}
 ValuePtr Factory::create(int8_t value) const {return create((int64_t)value);}
 ValuePtr Factory::create(uint8_t value) const {return create((uint64_t)value);}
@@ -64,6 +65,6 @@ ValuePtr Factory::create(int16_t value) const {return create((int64_t)value);}
 ValuePtr Factory::create(uint16_t value) const {return create((uint64_t)value);}
 ValuePtr Factory::create(int32_t value) const {return create((int64_t)value);}
 ValuePtr Factory::create(uint32_t value) const {return create((uint64_t)value);}
-ValuePtr Factory::create(int64_t value) const {return new S64(value);}
-ValuePtr Factory::create(uint64_t value) const {return new U64(value);}
-ValuePtr Factory::create(const string &value) const {return new String(value);}
+ValuePtr Factory::create(int64_t value) const {return SmartNew<S64>(value);}
+ValuePtr Factory::create(uint64_t value) const {return SmartNew<U64>(value);}
+ValuePtr Factory::create(const string &value) const {return SmartNew<String>(value);}
@@ -180,7 +180,8 @@ const string Reader::parseKeyword() {
 void Reader::parseNull() {
   if (strict) {
     string value = parseKeyword();
-    if (value != "null") error(SSTR("'null' but found '" << value << '\''));
+    if (value != "null")
+      error(SSTR("Expected keyword 'null' but found '" << value << '\''));
 
   } else {
     string value = cb::String::toLower(parseKeyword());
@@ -257,6 +258,7 @@ void Reader::parseNumber(Sink &sink) {
       return sink.write((uint64_t)v);
   }
 
+  errno = 0;
   double v = strtod(start, &end);
   if (errno || (size_t)(end - start) != value.length())
     error(SSTR("Invalid JSON number '" << value << "'"));
@@ -282,7 +284,7 @@ string Reader::parseString() {
       switch (c) {
       case '"': case '\\': case '/': s += c; break;
       case 'b': s += '\b'; break;
-      case 'f': s += '\b'; break;
+      case 'f': s += '\f'; break;
       case 'n': s += '\n'; break;
       case 'r': s += '\r'; break;
       case 't': s += '\t'; break;
@@ -296,7 +298,7 @@ string Reader::parseString() {
           c = get();
           if ('0' <= c && c <= '9') code += c - '0';
           else if ('a' <= c && c <= 'f') code += c - 'a' + 10;
-          else if ('A' <= c && c <= 'F') code += c - 'F' + 10;
+          else if ('A' <= c && c <= 'F') code += c - 'A' + 10;
           else error(SSTR("Invalid hex character '" << String::escapeC(c)
                           << "' in JSON string"));
         }
@@ -37,6 +37,7 @@
 #include <cbang/String.h>
 #include <cbang/Catch.h>
 #include <cbang/SStream.h>
+#include <cbang/util/NumberFormat.h>
 
 #include <cctype>
 #include <iomanip>
@@ -84,19 +85,29 @@ void Writer::write(double value) {
   if (std::isnan(value)) stream << "\"NaN\"";
   else if (std::isinf(value) && 0 < value) stream << "\"Infinity\"";
   else if (std::isinf(value) && value < 0) stream << "\"-Infinity\"";
-  else stream << cb::String(value, precision);
+  else {
+    char buf[cb::NumberFormat::maxLength];
+    unsigned len = precision < 0 ?
+      cb::NumberFormat::formatShortest(buf, value) :
+      cb::NumberFormat::formatFixed(buf, value, precision);
+
+    if (len) stream.write(buf, len);
+    else stream << cb::String(value, precision);
+  }
 }
 
 
 void Writer::write(uint64_t value) {
   NullSink::write(value);
-  stream << cb::String(value);
+  char buf[cb::NumberFormat::maxLength];
+  stream.write(buf, cb::NumberFormat::formatU64(buf, value));
 }
 
 
 void Writer::write(int64_t value) {
   NullSink::write(value);
-  stream << cb::String(value);
+  char buf[cb::NumberFormat::maxLength];
+  stream.write(buf, cb::NumberFormat::formatS64(buf, value));
 }
 
 
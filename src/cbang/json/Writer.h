@@ -47,7 +47,7 @@ namespace cb {
       unsigned indentSpace;
       unsigned indentStart;
       bool compact;
-      int precision;
+      int precision; ///< Decimal places, negative for round-trip
 
       std::vector<bool> simple;
       bool first = true;
@@ -34,21 +34,27 @@
 
 #include "Logger.h"
 
+#include <cbang/thread/SmartLock.h>
+
 using namespace std;
 using namespace cb;
 
 
 LogDevice::impl::impl(const string &prefix, const string &suffix,
-                      const string &trailer, const string &rateKey) :
-  prefix(prefix), suffix(suffix), trailer(trailer), rateKey(rateKey) {
-  Logger::instance().lock();
+                      const string &trailer, const string &rateKey,
+                      bool async) :
+  prefix(prefix), suffix(suffix), trailer(trailer), rateKey(rateKey),
+  async(async) {
+  if (!async) Logger::instance().lock();
 }
 
 
 LogDevice::impl::~impl() {
   write(&trailer[0], trailer.size());
   flushLine();
-  Logger::instance().unlock();
+
+  if (async) flush();
+  else Logger::instance().unlock();
 }
 
 
@@ -91,8 +97,10 @@ streamsize LogDevice::impl::write(const char_type *s, streamsize n) {
 void LogDevice::impl::flushLine() {
   if (startOfLine) return;
 
-  if (first && !rateKey.empty() && !rateMessage.empty())
+  if (first && !rateKey.empty() && !rateMessage.empty()) {
+    SmartLock lock(&Logger::instance());
     Logger::instance().rateMessage(rateKey, rateMessage);
+  }
   first = false;
 
   // Add suffix
@@ -102,17 +110,19 @@ void LogDevice::impl::flushLine() {
   if (Logger::instance().getLogCRLF()) buffer.append(1, '\r');
   buffer.append(1, '\n');
 
-  flush();
-
   startOfLine = true;
+
+  // In async mode the whole record is queued at once
+  if (!async) flush();
 }
 
 
 bool LogDevice::impl::flush() {
-  if (buffer.empty()) return true;
+  if (buffer.empty() || (async && !startOfLine)) return true;
 
   // Write to log
-  Logger::instance().write(buffer);
+  if (async) Logger::instance().append(std::move(buffer));
+  else Logger::instance().write(buffer);
 
   // Flush the buffer
   buffer.clear();
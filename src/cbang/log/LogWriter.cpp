@@ -0,0 +1,191 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "LogWriter.h"
+#include "Logger.h"
+
+#include <cbang/Catch.h>
+#include <cbang/thread/SmartLock.h>
+#include <cbang/util/RateSet.h>
+
+using namespace std;
+using namespace cb;
+
+
+namespace {
+  const unsigned maxBatch = 64 * 1024;
+}
+
+
+LogWriter::LogWriter(Logger &logger, unsigned capacity, bool block) :
+  logger(logger), capacity(capacity ? capacity : 1), block(block),
+  sleeping(false), rotatePending(false), writerThread(0) {}
+
+
+LogWriter::~LogWriter() {join();}
+
+
+void LogWriter::append(string &&record) {
+  // Write directly from the writer thread or once the writer has stopped
+  if (Thread::self() == writerThread || !isRunning()) {
+    SmartLock lock(&logger);
+    logger.write(record);
+    return;
+  }
+
+  Ring &ring = getRing();
+
+  while (!ring.queue.tryPush(std::move(record))) {
+    if (!block) {ring.dropped++; break;}
+    wake();
+    Thread::yield();
+  }
+
+  wake();
+}
+
+
+void LogWriter::rotate() {
+  rotatePending = true;
+  wake();
+}
+
+
+void LogWriter::stop() {
+  Thread::stop();
+  SmartLock lock(&condition);
+  condition.signal();
+}
+
+
+LogWriter::Ring &LogWriter::getRing() {
+  Local &l = local.get();
+
+  if (l.ring.isNull()) {
+    l.ring = new Ring(capacity);
+    SmartLock lock(&ringsLock);
+    rings.push_back(l.ring);
+  }
+
+  return *l.ring;
+}
+
+
+void LogWriter::wake() {
+  if (!sleeping) return;
+  SmartLock lock(&condition);
+  condition.signal();
+}
+
+
+bool LogWriter::pending() {
+  if (rotatePending) return true;
+
+  SmartLock lock(&ringsLock);
+  for (auto &ring: rings)
+    if (!ring->queue.empty() || ring->dropped) return true;
+
+  return false;
+}
+
+
+bool LogWriter::drain() {
+  vector<SmartPointer<Ring>> rings;
+
+  {
+    SmartLock lock(&ringsLock);
+
+    // Forget rings whose thread has exited once they are empty.  Check
+    // closed first, after that nothing more can be pushed.
+    for (unsigned i = 0; i < this->rings.size();) {
+      auto &ring = this->rings[i];
+
+      if (ring->closed && ring->queue.empty() && !ring->dropped) {
+        ring = this->rings.back();
+        this->rings.pop_back();
+
+      } else rings.push_back(this->rings[i++]);
+    }
+  }
+
+  string batch;
+  uint64_t dropped = 0;
+  bool work = false;
+
+  for (auto &ring: rings) {
+    dropped += ring->dropped.exchange(0);
+
+    while (!ring->queue.empty()) {
+      batch += ring->queue.top();
+      ring->queue.pop();
+
+      if (maxBatch <= batch.size()) {
+        SmartLock lock(&logger);
+        logger.write(batch);
+        batch.clear();
+        work = true;
+      }
+    }
+  }
+
+  if (!batch.empty() || dropped) {
+    SmartLock lock(&logger);
+    if (dropped) logger.logDropped(dropped);
+    if (!batch.empty()) logger.write(batch);
+    work = true;
+  }
+
+  if (rotatePending.exchange(false)) {
+    TRY_CATCH_ERROR(logger.rotateLogFile());
+    work = true;
+  }
+
+  return work;
+}
+
+
+void LogWriter::run() {
+  writerThread = Thread::self();
+
+  while (!shouldShutdown()) {
+    if (drain()) continue;
+
+    SmartLock lock(&condition);
+    sleeping = true;
+    if (!shouldShutdown() && !pending()) condition.timedWait(1);
+    sleeping = false;
+  }
+
+  // Write whatever is left
+  while (drain()) continue;
+}
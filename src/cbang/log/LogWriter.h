@@ -0,0 +1,109 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/thread/Thread.h>
+#include <cbang/thread/Mutex.h>
+#include <cbang/thread/Condition.h>
+#include <cbang/thread/ThreadLocalStorage.h>
+#include <cbang/util/SPSCQueue.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+
+namespace cb {
+  class Logger;
+
+  /**
+   * Writes log records from a background thread.  Each logging thread
+   * appends formatted records to its own single producer ring so logging
+   * never waits on the Logger lock or on log file I/O.  The writer drains
+   * all rings, writes the records in batches and performs log rotation.
+   *
+   * When a ring is full the record is either dropped and counted or the
+   * logging thread waits for the writer to make room.  Records from one
+   * thread stay in order.  Records from different threads are ordered by
+   * when the writer drains them.
+   */
+  class LogWriter : public Thread {
+    Logger &logger;
+    const unsigned capacity;
+    const bool block;
+
+    struct Ring {
+      SPSCQueue<std::string> queue;
+      std::atomic<uint64_t> dropped;
+      std::atomic<bool> closed;
+
+      Ring(unsigned capacity) : queue(capacity), dropped(0), closed(false) {}
+    };
+
+    // Marks the ring closed when its thread exits
+    struct Local {
+      SmartPointer<Ring> ring;
+      ~Local() {if (ring.isSet()) ring->closed = true;}
+    };
+
+    Mutex ringsLock;
+    std::vector<SmartPointer<Ring>> rings;
+    ThreadLocalStorage<Local> local;
+
+    Condition condition;
+    std::atomic<bool> sleeping;
+    std::atomic<bool> rotatePending;
+    std::atomic<uint64_t> writerThread;
+
+  public:
+    LogWriter(Logger &logger, unsigned capacity, bool block);
+    ~LogWriter();
+
+    void append(std::string &&record);
+    void rotate();
+
+    // From Thread
+    void stop() override;
+
+  protected:
+    Ring &getRing();
+    void wake();
+    bool pending();
+    bool drain();
+
+    // From Thread
+    void run() override;
+  };
+}
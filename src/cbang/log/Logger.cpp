@@ -32,6 +32,7 @@
 
 #include "Logger.h"
 #include "LogStream.h"
+#include "LogWriter.h"
 
 #include <cbang/config.h>
 #include <cbang/Exception.h>
@@ -39,6 +40,7 @@
 #include <cbang/time/Time.h>
 #include <cbang/time/Timer.h>
 #include <cbang/io/NullStream.h>
+#include <cbang/thread/Mutex.h>
 #include <cbang/thread/SmartLock.h>
 #include <cbang/util/RateSet.h>
 #include <cbang/debug/Debugger.h>
@@ -58,7 +60,7 @@ Mutex Logger::mutex;
 
 Logger::Logger(Inaccessible) :
   rates(new RateSet), threadIDStorage(new ThreadLocalStorage<unsigned>),
-  prefixStorage(new ThreadLocalStorage<string>) {
+  prefixStorage(new ThreadLocalStorage<string>), writerStarted(false) {
   setScreenStream(cout);
 
 #ifdef _WIN32
@@ -68,7 +70,7 @@ Logger::Logger(Inaccessible) :
 }
 
 
-Logger::~Logger() {}
+Logger::~Logger() {if (writer.isSet()) writer->join();}
 
 
 bool Logger::lock(double timeout) const {return mutex.lock(timeout);}
@@ -153,6 +155,14 @@ void Logger::addOptions(Options &options) {
   options.addTarget("log-rotate-period", logRotatePeriod,
                     "Rotate log once every so many seconds.  No periodic "
                     "rotation is performed if zero.");
+  options.addTarget("log-async", logAsync, "Write log entries from a "
+                    "background thread.  Logging threads queue entries "
+                    "and do not wait on log file I/O.");
+  options.addTarget("log-async-block", logAsyncBlock, "In async mode, make "
+                    "logging threads wait when their queue is full.  "
+                    "Otherwise, log entries are dropped and counted.");
+  options.addTarget("log-async-buffer", logAsyncBuffer, "In async mode, "
+                    "the maximum number of queued log entries per thread.");
   options.popCategory();
 }
 
@@ -234,6 +244,24 @@ void Logger::setLogDomainLevels(const string &levels) {
 }
 
 
+bool Logger::isAsync() {
+  if (!logAsync) return false;
+
+  if (!writerStarted) {
+    SmartLock lock(this);
+
+    if (writer.isNull()) {
+      writer = new LogWriter(*this, logAsyncBuffer, logAsyncBlock);
+      writer->start();
+    }
+
+    writerStarted = true;
+  }
+
+  return true;
+}
+
+
 unsigned Logger::getHeaderWidth() const {
   return getHeader("", LOG_INFO_LEVEL(10)).size();
 }
@@ -323,9 +351,22 @@ string Logger::getHeader(const string &domain, int level) const {
 
   // Date & Time
   if (logDate || logTime) {
+    // Only reformatted once a second per thread
+    thread_local uint64_t last = 0;
+    thread_local unsigned lastFlags = 0;
+    thread_local string stamp;
+
     uint64_t now = Time::now(); // Must be the same time for both
-    if (logDate) header += Time(now).toString("%Y-%m-%d:");
-    if (logTime) header += Time(now).toString("%H:%M:%S:");
+    unsigned flags = (logDate ? 1 : 0) | (logTime ? 2 : 0);
+
+    if (now != last || flags != lastFlags) {
+      stamp = Time(now).toString(string(logDate ? "%Y-%m-%d:" : "") +
+                                 (logTime ? "%H:%M:%S:" : ""));
+      last = now;
+      lastFlags = flags;
+    }
+
+    header += stamp;
   }
 
   // Level
@@ -429,10 +470,14 @@ Logger::LogStream Logger::createStream(const string &_domain, int level,
 
   if (!enabled(domain, level)) return new NullStream<>;
 
-  SmartLock lock(this);
+  // Async mode only locks to count rates
+  bool async = isAsync();
+  bool countRate = (level & logRates) && rates.isSet();
+  SmartPointer<SmartLock> lock;
+  if (!async || countRate) lock = new SmartLock(this);
 
   string rateKey;
-  if ((level & logRates) && rates.isSet()) {
+  if (countRate) {
     rateKey = SSTR(getLevelChar(level) << ':' << filename << ':' << line);
     rates->event(rateKey);
   }
@@ -451,7 +496,7 @@ Logger::LogStream Logger::createStream(const string &_domain, int level,
 #endif
 
   return new cb::LogStream(
-    new cb::LogDevice::impl(prefix, suffix, trailer, rateKey));
+    new cb::LogDevice::impl(prefix, suffix, trailer, rateKey, async));
 }
 
 
@@ -477,6 +522,16 @@ void Logger::write(const char *s, streamsize n) {
 void Logger::write(const string &s) {write(s.data(), s.length());}
 
 
+void Logger::append(string &&record) {writer->append(std::move(record));}
+
+
+void Logger::logDropped(uint64_t count) {
+  const string key = "log:dropped";
+  rates->event(key, count);
+  rateMessage(key, "Async log queue full, entries dropped");
+}
+
+
 bool Logger::flush() {
   if (!logFile.isNull()) logFile->flush();
   if (logToScreen && !screenStream.isNull()) screenStream->flush();
@@ -486,13 +541,20 @@ bool Logger::flush() {
 
 void Logger::rotate() {
   if (firstRotate) firstRotate = false;
-  else if (logFileCount) startLogFile(logFilename);
+  else if (writerStarted) writer->rotate();
+  else rotateLogFile();
 
   if (logRotate && logRotatePeriod)
     rotateEvent->next(logRotatePeriod);
 }
 
 
+void Logger::rotateLogFile() {
+  SmartLock lock(this);
+  if (logFileCount) startLogFile(logFilename);
+}
+
+
 void Logger::date() {
   if (firstDate) firstDate = false;
   else {
@@ -48,6 +48,7 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <atomic>
 
 
 namespace cb {
@@ -56,6 +57,7 @@ namespace cb {
   class CommandLine;
   class RateSet;
   class Mutex;
+  class LogWriter;
   template <typename T> class ThreadLocalStorage;
 
   namespace JSON {class Sink;}
@@ -113,6 +115,9 @@ namespace cb {
     std::string logRotateDir        = "logs";
     uint32_t    logRotatePeriod     = 0;
     unsigned    logRates            = 0;
+    bool        logAsync            = false;
+    bool        logAsyncBlock       = false;
+    unsigned    logAsyncBuffer      = 4096;
 
     SmartPointer<RateSet> rates;
     std::map<std::string, std::string> rateMessages;
@@ -124,6 +129,9 @@ namespace cb {
     SmartPointer<std::ostream> screenStream;
     std::vector<SmartPointer<LogListener>> listeners;
 
+    SmartPointer<LogWriter> writer;
+    std::atomic<bool> writerStarted;
+
     mutable unsigned idWidth = 1;
 
     typedef std::map<std::string, int> domain_levels_t;
@@ -183,10 +191,14 @@ namespace cb {
     void setLogRotateMax(unsigned x)    {logRotateMax     = x;}
     void setLogRotatePeriod(uint32_t x) {logRotatePeriod  = x;}
     void setLogRates(unsigned x)        {logRates         = x;}
+    void setLogAsync(bool x)            {logAsync         = x;}
+    void setLogAsyncBlock(bool x)       {logAsyncBlock    = x;}
+    void setLogAsyncBuffer(unsigned x)  {logAsyncBuffer   = x;}
     void setLogDomainLevels(const std::string &levels);
 
     unsigned getVerbosity() const {return verbosity;}
     bool getLogCRLF() const {return logCRLF;}
+    bool isAsync();
     unsigned getHeaderWidth() const;
     const SmartPointer<RateSet> &getRates() const {return rates;}
 
@@ -217,11 +229,15 @@ namespace cb {
     void write(const char *s, std::streamsize n);
     void write(const std::string &s);
     bool flush();
+    void append(std::string &&record);
+    void logDropped(uint64_t count);
 
     void rotate();
+    void rotateLogFile();
     void date();
 
     friend class LogDevice;
+    friend class LogWriter;
   };
 }
 
@@ -255,7 +271,8 @@ namespace cb {
 
 
 // Create logger streams
-// Warning these macros lock the Logger until they are deallocated
+// Warning these macros lock the Logger until they are deallocated, except
+// in async mode
 #define CBANG_LOG_STREAM_LOCATION(domain, level, file, line)            \
   cb::Logger::instance()                                                \
     .createStream(domain, level, CBANG_SSTR(CBANG_LOG_PREFIX), file, line)
@@ -0,0 +1,129 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "ThreadLocalStorage.h"
+
+#include <mutex>
+#include <atomic>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  struct SlotAllocator {
+    mutex lock;
+    vector<unsigned> free;
+    unsigned next = 0;
+    atomic<uint64_t> nextID;
+
+    SlotAllocator() : nextID(1) {}
+
+
+    unsigned allocate() {
+      lock_guard<mutex> guard(lock);
+      if (free.empty()) return next++;
+      unsigned slot = free.back();
+      free.pop_back();
+      return slot;
+    }
+
+
+    void release(unsigned slot) {
+      lock_guard<mutex> guard(lock);
+      free.push_back(slot);
+    }
+  };
+
+
+  SlotAllocator &getAllocator() {
+    static SlotAllocator *allocator = new SlotAllocator; // Never deallocated
+    return *allocator;
+  }
+
+
+  // Frees a thread's values when the thread exits
+  struct SlotsReaper {
+    void (*reap)() = 0;
+    ~SlotsReaper() {if (reap) reap();}
+  };
+
+  thread_local SlotsReaper reaper;
+  thread_local bool reaped = false;
+}
+
+
+thread_local ThreadLocalStorageBase::slots_t *ThreadLocalStorageBase::slots = 0;
+
+
+ThreadLocalStorageBase::ThreadLocalStorageBase() :
+  slot(getAllocator().allocate()), id(getAllocator().nextID++) {}
+
+
+ThreadLocalStorageBase::~ThreadLocalStorageBase() {
+  erase();
+  getAllocator().release(slot);
+}
+
+
+void ThreadLocalStorageBase::store(void *ptr, dealloc_t dealloc) {
+  if (!slots) {
+    slots = new slots_t;
+
+    // Values created during thread exit, after the reaper ran, are leaked
+    if (!reaped)
+      reaper.reap = [] () {
+        reaped = true;
+        for (auto &e: *slots) if (e.ptr) e.dealloc(e.ptr);
+        delete slots;
+        slots = 0;
+      };
+  }
+
+  if (slots->size() <= slot) slots->resize(slot + 1);
+
+  Entry &e = (*slots)[slot];
+  if (e.ptr) e.dealloc(e.ptr); // Stale value from a previous slot owner
+
+  e.ptr = ptr;
+  e.dealloc = dealloc;
+  e.id = id;
+}
+
+
+void ThreadLocalStorageBase::erase() {
+  if (!lookup()) return;
+
+  Entry &e = (*slots)[slot];
+  e.dealloc(e.ptr);
+  e = Entry();
+}
@@ -32,62 +32,82 @@
 
 #pragma once
 
-#include "Mutex.h"
-#include "Thread.h"
-#include "SmartLock.h"
-
-#include <map>
+#include <vector>
 #include <cstdint>
 
 
 namespace cb {
-  template <typename T>
-  class ThreadLocalStorage : public Mutex {
+  /**
+   * Per-object thread local slots.  Each storage object is assigned a slot
+   * index into a vector owned by each thread so lookups take no locks.
+   * Slots are recycled when a storage object is destroyed.  A unique id
+   * guards against values left behind by a previous owner of the slot.
+   */
+  class ThreadLocalStorageBase {
   protected:
-    typedef std::map<uint64_t, T> storage_t;
-    storage_t storage;
+    typedef void (*dealloc_t)(void *);
+
+    struct Entry {
+      void *ptr = 0;
+      dealloc_t dealloc = 0;
+      uint64_t id = 0;
+    };
+
+    typedef std::vector<Entry> slots_t;
+    static thread_local slots_t *slots;
+
+    const unsigned slot;
+    const uint64_t id;
 
   public:
-    T &get() {
-      SmartLock lock(this);
+    ThreadLocalStorageBase();
+    ~ThreadLocalStorageBase();
 
-      auto it = storage.find(Thread::self());
-      if (it == storage.end())
-        it = storage.insert(
-          typename storage_t::value_type(Thread::self(), T())).first;
+  protected:
+    void *lookup() const {
+      if (slots && slot < slots->size()) {
+        const Entry &e = (*slots)[slot];
+        if (e.id == id) return e.ptr;
+      }
 
-      return it->second;
+      return 0;
     }
 
-    T &get(T defaultValue) {
-      SmartLock lock(this);
+    void store(void *ptr, dealloc_t dealloc);
+    void erase();
+  };
 
-      auto it = storage.find(Thread::self());
-      if (it == storage.end())
-        it = storage.insert(
-          typename storage_t::value_type(Thread::self(), defaultValue)).first;
 
-      return it->second;
+  template <typename T>
+  class ThreadLocalStorage : public ThreadLocalStorageBase {
+    static void dealloc(void *ptr) {delete (T *)ptr;}
+
+  public:
+    T &get() {
+      void *ptr = lookup();
+      return ptr ? *(T *)ptr : create(T());
     }
 
-    bool isSet() const {
-      SmartLock lock(this);
-      return storage.find(Thread::self()) != storage.end();
+    T &get(T defaultValue) {
+      void *ptr = lookup();
+      return ptr ? *(T *)ptr : create(defaultValue);
     }
 
-    void set(const T &value) {
-      SmartLock lock(this);
+    bool isSet() const {return lookup();}
 
-      auto it = storage.find(Thread::self());
-      if (it == storage.end())
-        storage.insert(typename storage_t::value_type(Thread::self(), value));
-      else it->second = value;
+    void set(const T &value) {
+      void *ptr = lookup();
+      if (ptr) *(T *)ptr = value;
+      else create(value);
     }
 
-    void clear() {
-      SmartLock lock(this);
-      auto it = storage.find(Thread::self());
-      if (it != storage.end()) storage.erase(it);
+    void clear() {erase();}
+
+  protected:
+    T &create(const T &value) {
+      T *ptr = new T(value);
+      store(ptr, &dealloc);
+      return *ptr;
     }
   };
 }
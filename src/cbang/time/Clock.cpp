@@ -0,0 +1,131 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "Clock.h"
+#include "Timer.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#else
+#include <time.h>
+#endif
+
+using namespace cb;
+
+
+namespace {
+  struct Cache {
+    bool enabled = false;
+    double wall = 0;
+    double monotonic = 0;
+  };
+
+  thread_local Cache cache;
+
+
+#ifndef _WIN32
+  double get(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return Timer::toDouble(ts);
+  }
+#endif
+}
+
+
+double Clock::monotonic() {
+#ifdef _WIN32
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return (double)count.QuadPart / freq.QuadPart;
+
+#else
+  return get(CLOCK_MONOTONIC);
+#endif
+}
+
+
+double Clock::coarseMonotonic() {
+#ifdef _WIN32
+  return GetTickCount64() * 0.001;
+
+#elif defined(CLOCK_MONOTONIC_COARSE)
+  return get(CLOCK_MONOTONIC_COARSE);
+
+#else
+  return get(CLOCK_MONOTONIC);
+#endif
+}
+
+
+double Clock::wall() {
+#ifdef _WIN32
+  return Timer::now();
+
+#else
+  return get(CLOCK_REALTIME);
+#endif
+}
+
+
+double Clock::coarseWall() {
+#ifdef _WIN32
+  return Timer::now(); // Already tick resolution
+
+#elif defined(CLOCK_REALTIME_COARSE)
+  return get(CLOCK_REALTIME_COARSE);
+
+#else
+  return get(CLOCK_REALTIME);
+#endif
+}
+
+
+void Clock::update() {
+  cache.wall      = coarseWall();
+  cache.monotonic = coarseMonotonic();
+  cache.enabled   = true;
+}
+
+
+void Clock::clearCache() {cache.enabled = false;}
+bool Clock::isCached() {return cache.enabled;}
+double Clock::now() {return cache.enabled ? cache.wall : coarseWall();}
+
+
+double Clock::uptime() {
+  return cache.enabled ? cache.monotonic : coarseMonotonic();
+}
@@ -0,0 +1,71 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+
+namespace cb {
+  /**
+   * Cheap monotonic and wall clocks for hot paths.
+   *
+   * The coarse clocks are read from the vDSO where the OS supports it and
+   * have a resolution of a scheduler tick, typically 1-4ms.  Event loops
+   * call update() once per pass so that now() and uptime() return the same
+   * cached value to everything run from that pass.  Threads without an
+   * event loop fall through to the coarse clocks.
+   *
+   * Use Timer::now() when sub-millisecond precision matters.
+   */
+  class Clock {
+  public:
+    /// @return Precise monotonic seconds since an arbitrary point.
+    static double monotonic();
+    /// @return Monotonic seconds with tick resolution.
+    static double coarseMonotonic();
+    /// @return Precise wall time in seconds since 1970.
+    static double wall();
+    /// @return Wall time in seconds since 1970 with tick resolution.
+    static double coarseWall();
+
+    /// Refresh and enable the calling thread's cached clocks.
+    static void update();
+    /// Stop using cached clocks in the calling thread.
+    static void clearCache();
+    static bool isCached();
+
+    /// @return The cached wall time or coarseWall() if not cached.
+    static double now();
+    /// @return The cached monotonic time or coarseMonotonic() if not cached.
+    static double uptime();
+  };
+}
@@ -31,6 +31,7 @@
 \******************************************************************************/
 
 #include "Time.h"
+#include "Clock.h"
 
 #include <cbang/Exception.h>
 #include <cbang/String.h>
@@ -50,6 +51,93 @@ namespace pt = boost::posix_time;
 
 namespace {
   const boost::gregorian::date epoch(1970, 1, 1);
+
+  const char *dayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  const char *monthNames[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+
+  struct Fields {
+    uint64_t year;
+    unsigned month; // 1-12
+    unsigned day;   // 1-31
+    unsigned hour;
+    unsigned min;
+    unsigned sec;
+    unsigned wday;  // 0 = Sunday
+  };
+
+
+  // Proleptic Gregorian calendar from days since 1970, see
+  // http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+  Fields split(uint64_t t) {
+    Fields f;
+
+    uint64_t days = t / Time::SEC_PER_DAY;
+    unsigned secs = t % Time::SEC_PER_DAY;
+
+    f.hour = secs / Time::SEC_PER_HOUR;
+    f.min  = secs / Time::SEC_PER_MIN % 60;
+    f.sec  = secs % 60;
+    f.wday = (days + 4) % 7; // 1970-01-01 was a Thursday
+
+    uint64_t z   = days + 719468;
+    uint64_t era = z / 146097;
+    unsigned doe = z - era * 146097;
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp  = (5 * doy + 2) / 153;
+
+    f.day   = doy - (153 * mp + 2) / 5 + 1;
+    f.month = mp < 10 ? mp + 3 : mp - 9;
+    f.year  = yoe + era * 400 + (f.month <= 2);
+
+    return f;
+  }
+
+
+  void put2(string &s, unsigned x) {
+    s += (char)('0' + x / 10 % 10);
+    s += (char)('0' + x % 10);
+  }
+
+
+  void put4(string &s, uint64_t x) {
+    if (9999 < x) s += to_string(x);
+    else {put2(s, x / 100); put2(s, x % 100);}
+  }
+
+
+  // Handles the common directives without strftime() or boost facets
+  bool fastFormat(uint64_t t, const string &format, string &s) {
+    Fields f = split(t);
+    s.reserve(format.length() + 16);
+
+    for (unsigned i = 0; i < format.length(); i++) {
+      char c = format[i];
+      if (c != '%') {s += c; continue;}
+      if (++i == format.length()) return false;
+
+      switch (format[i]) {
+      case 'Y': put4(s, f.year);                          break;
+      case 'm': put2(s, f.month);                         break;
+      case 'd': put2(s, f.day);                           break;
+      case 'H': put2(s, f.hour);                          break;
+      case 'M': put2(s, f.min);                           break;
+      case 'S': put2(s, f.sec);                           break;
+      case 'a': s += dayNames[f.wday];                    break;
+      case 'b': s += monthNames[f.month - 1];             break;
+      case '%': s += '%';                                 break;
+      case 'T':
+        put2(s, f.hour); s += ':'; put2(s, f.min); s += ':'; put2(s, f.sec);
+        break;
+      default: return false;
+      }
+    }
+
+    return true;
+  }
 }
 
 
@@ -63,6 +151,9 @@ Time::Time(const struct tm &tm) :
 string Time::toString(const string &format) const {
   if (!time) return "<invalid>";
 
+  string result;
+  if (fastFormat(time, format, result)) return result;
+
   try {
     pt::time_facet *facet = new pt::time_facet();
     facet->format(format.c_str());
@@ -102,10 +193,7 @@ uint64_t Time::parse(const string &s, const string &format) {
 }
 
 
-uint64_t Time::now() {
-  return (uint64_t)(pt::second_clock::universal_time() -
-                    pt::ptime(epoch)).total_seconds();
-}
+uint64_t Time::now() {return (uint64_t)Clock::now();}
 
 
 int32_t Time::offset() {
@@ -53,7 +53,7 @@ namespace cb {
 
   public:
     static constexpr const char *iso8601Format = "%Y-%m-%dT%H:%M:%SZ";
-    static constexpr const char *httpFormat    = "%a, %d %b %Y %H:%M:%S %Z";
+    static constexpr const char *httpFormat    = "%a, %d %b %Y %H:%M:%S GMT";
     static constexpr const char *sqlFormat     = "%Y-%m-%d %H:%M:%S";
 
     static const unsigned SEC_PER_MIN  = 60;
@@ -65,6 +65,11 @@ namespace cb {
     Time(uint64_t time = ~(uint64_t)0);
     explicit Time(const struct tm &tm);
 
+    /**
+     * Formats with %Y, %m, %d, %H, %M, %S, %a, %b, %T and %% are handled
+     * directly.  Other formats fall back to boost, where %F is fractional
+     * seconds rather than the date.
+     */
     std::string toString(const std::string &format = iso8601Format) const;
     operator std::string () const {return toString();}
     operator uint64_t () const {return time;}
@@ -79,7 +84,10 @@ namespace cb {
     static uint64_t parse(const std::string &s,
                           const std::string &format = iso8601Format);
 
-    /// Get current time in seconds since Janary 1st, 1970.
+    /**
+     * Get current time in seconds since Janary 1st, 1970.  Cached per event
+     * loop pass, see Clock.
+     */
     static uint64_t now();
 
     // UTC offset in seconds
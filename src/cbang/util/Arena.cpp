@@ -0,0 +1,65 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "Arena.h"
+
+using namespace cb;
+
+
+Arena::~Arena() {
+  for (auto it = cleanups.rbegin(); it != cleanups.rend(); it++)
+    it->destroy(it->ptr);
+
+  for (auto block: blocks) delete [] block;
+}
+
+
+void *Arena::allocateBlock(size_t size, size_t align) {
+  // Large allocations get their own block so the current one is not wasted
+  size_t padded = size + align;
+
+  if (blockSize / 4 < padded) {
+    char *block = new char[padded];
+    blocks.push_back(block);
+    bytes += size;
+
+    return (void *)(((uintptr_t)block + align - 1) & ~(align - 1));
+  }
+
+  char *block = new char[blockSize];
+  blocks.push_back(block);
+  next = block;
+  end = block + blockSize;
+
+  return allocate(size, align);
+}
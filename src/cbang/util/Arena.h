@@ -0,0 +1,117 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace cb {
+  /**
+   * A bump allocator.  Memory is carved from large blocks and only freed
+   * when the Arena is destroyed.  Objects created with create() have their
+   * destructors run, in reverse order, at that time if they need it.
+   */
+  class Arena {
+    struct Cleanup {
+      void (*destroy)(void *);
+      void *ptr;
+    };
+
+    const size_t blockSize;
+    std::vector<char *> blocks;
+    std::vector<Cleanup> cleanups;
+    char *next = 0;
+    char *end = 0;
+    size_t bytes = 0;
+
+    // Prevent copying
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+  public:
+    Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+    ~Arena();
+
+    /// @return The total number of bytes allocated.
+    size_t getBytes() const {return bytes;}
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+      char *p = (char *)(((uintptr_t)next + align - 1) & ~(align - 1));
+
+      if (!p || end < p + size) return allocateBlock(size, align);
+
+      next = p + size;
+      bytes += size;
+      return p;
+    }
+
+
+    template <typename T>
+    T *allocateArray(size_t n) {
+      return (T *)allocate(n * sizeof(T), alignof(T));
+    }
+
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args) {
+      T *ptr = new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+
+      if (!std::is_trivially_destructible<T>::value)
+        addCleanup(ptr, [] (void *ptr) {((T *)ptr)->~T();});
+
+      return ptr;
+    }
+
+
+    /// Like create() but never runs the destructor
+    template <typename T, typename... Args>
+    T *construct(Args &&...args) {
+      return new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    }
+
+
+    void addCleanup(void *ptr, void (*destroy)(void *))
+    {cleanups.push_back(Cleanup{destroy, ptr});}
+
+  protected:
+    void *allocateBlock(size_t size, size_t align);
+  };
+}
@@ -0,0 +1,115 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "LatencyHistogram.h"
+
+#include <cbang/json/Sink.h>
+
+#include <cmath>
+
+using namespace std;
+using namespace cb;
+
+
+unsigned LatencyHistogram::getIndex(uint64_t us) {
+  if (us < SUB) return us;
+
+  // Highest set bit
+  unsigned e = SUB_BITS;
+  while (us >> (e + 1)) e++;
+  unsigned sub = (us >> (e - SUB_BITS)) & (SUB - 1);
+
+  return (e - SUB_BITS + 1) * SUB + sub;
+}
+
+
+uint64_t LatencyHistogram::getValue(unsigned index) {
+  if (index < SUB) return index;
+
+  unsigned shift = index / SUB - 1;
+  uint64_t lower = (uint64_t)(SUB + index % SUB) << shift;
+
+  return lower + ((uint64_t)1 << shift) - 1;
+}
+
+
+void LatencyHistogram::reset() {
+  counts.clear();
+  count = 0;
+  sum = max = 0;
+}
+
+
+void LatencyHistogram::record(double seconds) {
+  if (seconds < 0) seconds = 0;
+
+  unsigned index = getIndex((uint64_t)(seconds * 1e6));
+  if (counts.size() <= index) counts.resize(index + 1);
+
+  counts[index]++;
+  count++;
+  sum += seconds;
+  if (max < seconds) max = seconds;
+}
+
+
+double LatencyHistogram::getPercentile(double p) const {
+  if (!count) return 0;
+
+  uint64_t target = ceil(p * count);
+  if (!target) target = 1;
+
+  uint64_t total = 0;
+  for (unsigned i = 0; i < counts.size(); i++) {
+    total += counts[i];
+
+    if (target <= total) {
+      double value = getValue(i) * 1e-6;
+      return value < max ? value : max;
+    }
+  }
+
+  return max;
+}
+
+
+void LatencyHistogram::write(JSON::Sink &sink) const {
+  sink.beginDict();
+  sink.insert("count", count);
+  sink.insert("mean", getMean());
+  sink.insert("p50", getPercentile(0.5));
+  sink.insert("p99", getPercentile(0.99));
+  sink.insert("p999", getPercentile(0.999));
+  sink.insert("max", max);
+  sink.endDict();
+}
@@ -0,0 +1,75 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+
+namespace cb {
+  namespace JSON {class Sink;}
+
+  /***
+   * An HDR style log-linear histogram of durations.  Values are recorded
+   * in microseconds.  Below 32us buckets are exact; above, each power of
+   * two is split into 32 linear buckets, bounding the relative error to
+   * about 3% at any scale.  Buckets are allocated up to the largest value
+   * seen so fast endpoints stay small.
+   */
+  class LatencyHistogram {
+    static const unsigned SUB_BITS = 5;
+    static const unsigned SUB      = 1 << SUB_BITS;
+
+    std::vector<uint64_t> counts;
+    uint64_t count = 0;
+    double sum     = 0;
+    double max     = 0;
+
+  public:
+    static unsigned getIndex(uint64_t us);
+    /// @return the highest value which maps to bucket @param index
+    static uint64_t getValue(unsigned index);
+
+    void reset();
+    void record(double seconds);
+
+    uint64_t getCount() const {return count;}
+    double getMean() const {return count ? sum / count : 0;}
+    double getMax() const {return max;}
+    /// @param p in [0, 1], in seconds
+    double getPercentile(double p) const;
+
+    void write(JSON::Sink &sink) const;
+  };
+}
@@ -0,0 +1,538 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "Metrics.h"
+
+#include <cbang/String.h>
+#include <cbang/Exception.h>
+#include <cbang/json/Sink.h>
+#include <cbang/json/Builder.h>
+#include <cbang/thread/SmartLock.h>
+
+#include <cstring>
+#include <iterator>
+
+using namespace std;
+using namespace cb;
+
+
+namespace {
+  // Never freed so handles and exiting threads can outlive the registry
+  struct Blocks : public Mutex {
+    vector<Metrics::Block *> all;
+    vector<Metrics::Block *> free;
+  };
+
+
+  Blocks &getBlocks() {
+    static Blocks *blocks = new Blocks;
+    return *blocks;
+  }
+
+
+  atomic<uint64_t> *getGauges() {
+    static atomic<uint64_t> *gauges =
+      new atomic<uint64_t>[Metrics::MAX_GAUGES]();
+    return gauges;
+  }
+
+
+  uint64_t toBits(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+  }
+
+
+  double fromBits(uint64_t bits) {
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+  }
+
+
+  struct BlockReleaser {
+    Metrics::Block *block = 0;
+
+    ~BlockReleaser() {
+      if (!block) return;
+      Blocks &blocks = getBlocks();
+      SmartLock lock(&blocks);
+      blocks.free.push_back(block);
+    }
+  };
+
+
+  string getKey(const string &name, const string &labels) {
+    return labels.empty() ? name : name + "{" + labels + "}";
+  }
+
+
+  string addLabel(const string &labels, const string &label) {
+    return "{" + (labels.empty() ? label : labels + "," + label) + "}";
+  }
+
+
+  const char *getTypeName(int type) {
+    switch (type) {
+    case 0: return "counter";
+    case 1: return "gauge";
+    default: return "histogram";
+    }
+  }
+}
+
+
+thread_local Metrics::Block *Metrics::block = 0;
+
+
+Metrics::Block &Metrics::allocBlock() {
+  thread_local BlockReleaser releaser;
+  Blocks &blocks = getBlocks();
+
+  {
+    SmartLock lock(&blocks);
+
+    if (blocks.free.empty()) {
+      block = new Block;
+      for (unsigned i = 0; i < MAX_SLOTS; i++) block->values[i] = 0;
+      blocks.all.push_back(block);
+
+    } else {
+      block = blocks.free.back();
+      blocks.free.pop_back();
+    }
+  }
+
+  releaser.block = block;
+  return *block;
+}
+
+
+void Metrics::addDouble(unsigned slot, double x) {
+  auto &v = getBlock().values[slot];
+  v.store(toBits(fromBits(v.load(memory_order_relaxed)) + x),
+          memory_order_relaxed);
+}
+
+
+uint64_t Metrics::sum(unsigned slot) {
+  Blocks &blocks = getBlocks();
+  SmartLock lock(&blocks);
+
+  uint64_t total = 0;
+  for (auto block: blocks.all)
+    total += block->values[slot].load(memory_order_relaxed);
+
+  return total;
+}
+
+
+double Metrics::sumDouble(unsigned slot) {
+  Blocks &blocks = getBlocks();
+  SmartLock lock(&blocks);
+
+  double total = 0;
+  for (auto block: blocks.all)
+    total += fromBits(block->values[slot].load(memory_order_relaxed));
+
+  return total;
+}
+
+
+Metrics::Gauge::Gauge() : value(getGauges()) {}
+
+
+void Metrics::Gauge::set(double x) const {
+  value->store(toBits(x), memory_order_relaxed);
+}
+
+
+void Metrics::Gauge::add(double x) const {
+  uint64_t bits = value->load(memory_order_relaxed);
+  while (!value->compare_exchange_weak(bits, toBits(fromBits(bits) + x),
+                                       memory_order_relaxed))
+    continue;
+}
+
+
+double Metrics::Gauge::get() const {
+  return fromBits(value->load(memory_order_relaxed));
+}
+
+
+vector<uint64_t> Metrics::Histogram::getCounts() const {
+  vector<uint64_t> counts;
+  for (unsigned i = 0; i <= bounds.size(); i++) counts.push_back(sum(slot + i));
+  return counts;
+}
+
+
+uint64_t Metrics::Histogram::getCount() const {
+  uint64_t count = 0;
+  for (unsigned i = 0; i <= bounds.size(); i++) count += sum(slot + i);
+  return count;
+}
+
+
+double Metrics::Histogram::getSum() const {
+  return sumDouble(slot + bounds.size() + 1);
+}
+
+
+Metrics::Counter Metrics::getCounter(
+  const string &name, const string &help, const string &labels) {
+  SmartLock lock(&metricsLock);
+  bool created;
+  Metric &m = lookup(name, labels, help, COUNTER, created);
+
+  if (created)
+    try {
+      m.counter = Counter(allocSlots(1));
+    } catch (...) {metrics.erase(make_pair(name, labels)); throw;}
+
+  return m.counter;
+}
+
+
+Metrics::Gauge Metrics::getGauge(
+  const string &name, const string &help, const string &labels) {
+  SmartLock lock(&metricsLock);
+  bool created;
+  Metric &m = lookup(name, labels, help, GAUGE, created);
+
+  if (created) {
+    unsigned index;
+
+    if (!freedGauges.empty()) {
+      index = freedGauges.back();
+      freedGauges.pop_back();
+
+      getGauges()[index] = 0;
+
+    } else if (MAX_GAUGES <= nextGauge) {
+      metrics.erase(make_pair(name, labels));
+      THROW("Too many gauges");
+
+    } else index = nextGauge++;
+
+    m.gauge = Gauge(getGauges() + index);
+  }
+
+  return m.gauge;
+}
+
+
+Metrics::Histogram Metrics::getHistogram(
+  const string &name, const vector<double> &bounds, const string &help,
+  const string &labels) {
+  SmartLock lock(&metricsLock);
+  bool created;
+  Metric &m = lookup(name, labels, help, HISTOGRAM, created);
+
+  if (created)
+    try {
+      if (!is_sorted(bounds.begin(), bounds.end()))
+        THROW("Histogram '" << name << "' bounds must be sorted");
+
+      // One slot per bucket, including +Inf, and one for the sum
+      m.histogram = Histogram(allocSlots(bounds.size() + 2), bounds);
+
+    } catch (...) {metrics.erase(make_pair(name, labels)); throw;}
+
+  else if (m.histogram.getBounds() != bounds)
+    THROW("Histogram '" << name << "' already registered with other bounds");
+
+  return m.histogram;
+}
+
+
+void Metrics::remove(const string &name, const string &labels) {
+  SmartLock lock(&metricsLock);
+  auto it = metrics.find(make_pair(name, labels));
+  if (it != metrics.end()) remove(it);
+}
+
+
+void Metrics::removeLabeled(const string &label) {
+  SmartLock lock(&metricsLock);
+
+  for (auto it = metrics.begin(); it != metrics.end();) {
+    // Match whole labels only so server="1" does not match server="10"
+    string labels = "," + it->second.labels + ",";
+    if (labels.find("," + label + ",") == string::npos) it++;
+    else remove(it++);
+  }
+}
+
+
+void Metrics::addStats(const void *owner, const string &prefix,
+                       const string &labels, stats_t cb) {
+  SmartLock lock(&statsLock);
+  stats.insert(make_pair(owner, Stats{prefix, labels, cb, series_t()}));
+}
+
+
+void Metrics::removeStats(const void *owner) {
+  SmartLock lock(&statsLock);
+  auto range = stats.equal_range(owner);
+
+  for (auto it = range.first; it != range.second; it++)
+    for (auto &series: it->second.series)
+      remove(series.first, series.second);
+
+  stats.erase(range.first, range.second);
+}
+
+
+void Metrics::writePrometheus(ostream &stream) const {
+  // Refreshing the stats gauges does not change which metrics exist
+  const_cast<Metrics *>(this)->collect();
+
+  SmartLock lock(&metricsLock);
+  string last;
+
+  for (auto &p: metrics) {
+    const Metric &m = p.second;
+
+    if (m.name != last) {
+      if (!m.help.empty())
+        stream << "# HELP " << m.name << ' ' << m.help << '\n';
+      stream << "# TYPE " << m.name << ' ' << getTypeName(m.type) << '\n';
+      last = m.name;
+    }
+
+    string labels = m.labels.empty() ? "" : "{" + m.labels + "}";
+
+    switch (m.type) {
+    case COUNTER:
+      stream << m.name << labels << ' ' << m.counter.get() << '\n';
+      break;
+
+    case GAUGE:
+      stream << m.name << labels << ' ' << String(m.gauge.get()) << '\n';
+      break;
+
+    case HISTOGRAM: {
+      auto &bounds = m.histogram.getBounds();
+      auto counts = m.histogram.getCounts();
+      uint64_t total = 0;
+
+      for (unsigned i = 0; i < counts.size(); i++) {
+        total += counts[i];
+        string le = i < bounds.size() ? String(bounds[i]) : string("+Inf");
+        stream << m.name << "_bucket" << addLabel(m.labels, "le=\"" + le + "\"")
+               << ' ' << total << '\n';
+      }
+
+      stream << m.name << "_sum" << labels << ' '
+             << String(m.histogram.getSum()) << '\n';
+      stream << m.name << "_count" << labels << ' ' << total << '\n';
+      break;
+    }
+    }
+  }
+}
+
+
+void Metrics::write(JSON::Sink &sink) const {
+  const_cast<Metrics *>(this)->collect();
+
+  SmartLock lock(&metricsLock);
+
+  sink.beginDict();
+
+  for (auto &p: metrics) {
+    const Metric &m = p.second;
+    string key = getKey(m.name, m.labels);
+
+    switch (m.type) {
+    case COUNTER: sink.insert(key, m.counter.get()); break;
+    case GAUGE:   sink.insert(key, m.gauge.get());   break;
+
+    case HISTOGRAM: {
+      auto &bounds = m.histogram.getBounds();
+      auto counts = m.histogram.getCounts();
+      uint64_t total = 0;
+
+      sink.insertDict(key);
+      sink.insertDict("buckets");
+
+      for (unsigned i = 0; i < counts.size(); i++) {
+        total += counts[i];
+        sink.insert(i < bounds.size() ? String(bounds[i]) : string("+Inf"),
+                    total);
+      }
+
+      sink.endDict();
+      sink.insert("count", total);
+      sink.insert("sum", m.histogram.getSum());
+      sink.endDict();
+      break;
+    }
+    }
+  }
+
+  sink.endDict();
+}
+
+
+void Metrics::collect() {
+  SmartLock lock(&statsLock);
+
+  for (auto &p: stats) {
+    auto &s = p.second;
+    collect(s.prefix, s.labels, *JSON::Builder::build(s.cb), s.series);
+  }
+}
+
+
+void Metrics::collect(const string &name, const string &labels,
+                      const JSON::Value &value, series_t &series) {
+  if (value.isDict())
+    for (unsigned i = 0; i < value.size(); i++)
+      collect(name + "_" + value.keyAt(i), labels, *value.get(i), series);
+
+  else if (value.isList())
+    for (unsigned i = 0; i < value.size(); i++) {
+      string index = "index=\"" + String(i) + "\"";
+      collect(name, labels.empty() ? index : labels + "," + index,
+              *value.get(i), series);
+    }
+
+  else if (value.isNumber() || value.isBoolean()) {
+    double x = value.isNumber() ? value.getNumber() : value.toBoolean();
+    getGauge(name, "", labels).set(x);
+    series.insert(make_pair(name, labels));
+  }
+}
+
+
+unsigned Metrics::allocSlots(unsigned count) {
+  // First fit from the freed ranges
+  for (auto it = freedSlots.begin(); it != freedSlots.end(); it++)
+    if (count <= it->second) {
+      unsigned slot = it->first;
+      unsigned left = it->second - count;
+
+      freedSlots.erase(it);
+      if (left) freedSlots[slot + count] = left;
+
+      return slot;
+    }
+
+  if (MAX_SLOTS < nextSlot + count) THROW("Too many metrics");
+
+  unsigned slot = nextSlot;
+  nextSlot += count;
+  return slot;
+}
+
+
+void Metrics::releaseSlots(unsigned slot, unsigned count) {
+  {
+    // Reset every thread's values so the next owner starts from zero
+    Blocks &blocks = getBlocks();
+    SmartLock lock(&blocks);
+
+    for (auto block: blocks.all)
+      for (unsigned i = 0; i < count; i++)
+        block->values[slot + i].store(0, memory_order_relaxed);
+  }
+
+  // Coalesce with the neighboring ranges
+  auto next = freedSlots.lower_bound(slot);
+
+  if (next != freedSlots.end() && slot + count == next->first) {
+    count += next->second;
+    next = freedSlots.erase(next);
+  }
+
+  if (next != freedSlots.begin()) {
+    auto prev = std::prev(next);
+
+    if (prev->first + prev->second == slot) {
+      prev->second += count;
+      return;
+    }
+  }
+
+  freedSlots[slot] = count;
+}
+
+
+void Metrics::remove(metrics_t::iterator it) {
+  Metric &m = it->second;
+
+  switch (m.type) {
+  case COUNTER: if (m.counter.slot) releaseSlots(m.counter.slot, 1); break;
+
+  case GAUGE: {
+    unsigned index = m.gauge.value - getGauges();
+    if (index) freedGauges.push_back(index);
+    break;
+  }
+
+  case HISTOGRAM:
+    if (m.histogram.slot)
+      releaseSlots(m.histogram.slot, m.histogram.bounds.size() + 2);
+    break;
+  }
+
+  metrics.erase(it);
+}
+
+
+Metrics::Metric &Metrics::lookup(
+  const string &name, const string &labels, const string &help, type_t type,
+  bool &created) {
+  // A family shares one type, so check against any series of the same name
+  auto it = metrics.lower_bound(make_pair(name, string()));
+  if (it != metrics.end() && it->second.name == name && it->second.type != type)
+    THROW("Metric '" << name << "' already registered as a "
+          << getTypeName(it->second.type));
+
+  auto key = make_pair(name, labels);
+  it = metrics.find(key);
+
+  created = it == metrics.end();
+  if (!created) return it->second;
+
+  Metric &m = metrics[key];
+  m.name   = name;
+  m.labels = labels;
+  m.help   = help;
+  m.type   = type;
+
+  return m;
+}
@@ -0,0 +1,236 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include "Singleton.h"
+
+#include <cbang/thread/Mutex.h>
+#include <cbang/json/Serializable.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <ostream>
+#include <cstdint>
+
+
+namespace cb {
+  /***
+   * A registry of named counters, gauges and histograms.  Metrics are
+   * registered once, usually at startup, and return small handles which
+   * are cheap to copy and record into.
+   *
+   * Counter and histogram values are sharded per thread.  Each thread
+   * records into its own block of slots with plain relaxed loads and
+   * stores, so recording takes no locks or atomic read-modify-writes.
+   * Readers sum a slot across all thread blocks.  Blocks of exited threads
+   * are reused by new threads so no counts are lost.
+   *
+   * Metric labels are given in Prometheus form, e.g. code="200".
+   *
+   * Objects which already report through a writeStats() function can
+   * register it with addStats().  It is called on the exporting thread
+   * before each export and its numeric values are copied into gauges.
+   */
+  class Metrics : public Singleton<Metrics>, public JSON::Serializable {
+  public:
+    static const unsigned MAX_SLOTS  = 4096;
+    static const unsigned MAX_GAUGES = 1024;
+
+    struct Block {std::atomic<uint64_t> values[MAX_SLOTS];};
+
+  private:
+    static thread_local Block *block;
+
+    static Block &getBlock() {return block ? *block : allocBlock();}
+    static Block &allocBlock();
+
+  public:
+    static void add(unsigned slot, uint64_t n) {
+      auto &v = getBlock().values[slot];
+      v.store(v.load(std::memory_order_relaxed) + n,
+              std::memory_order_relaxed);
+    }
+
+    static void addDouble(unsigned slot, double x);
+    static uint64_t sum(unsigned slot);
+    static double sumDouble(unsigned slot);
+
+
+    class Counter {
+      friend class Metrics;
+      unsigned slot = 0; // Unset handles record to a scratch slot
+
+    public:
+      Counter() {}
+      Counter(unsigned slot) : slot(slot) {}
+
+      bool isSet() const {return slot;}
+      bool operator==(const Counter &o) const {return slot == o.slot;}
+      void inc(uint64_t n = 1) const {add(slot, n);}
+      uint64_t get() const {return sum(slot);}
+    };
+
+
+    class Gauge {
+      friend class Metrics;
+      std::atomic<uint64_t> *value;
+
+    public:
+      Gauge();
+      Gauge(std::atomic<uint64_t> *value) : value(value) {}
+
+      void set(double x) const;
+      void add(double x) const;
+      double get() const;
+    };
+
+
+    class Histogram {
+      friend class Metrics;
+      unsigned slot = 0; // One slot per bucket then the sum
+      std::vector<double> bounds;
+
+    public:
+      Histogram() {}
+      Histogram(unsigned slot, const std::vector<double> &bounds) :
+        slot(slot), bounds(bounds) {}
+
+      bool isSet() const {return slot;}
+      const std::vector<double> &getBounds() const {return bounds;}
+
+      void observe(double x) const {
+        unsigned i =
+          std::lower_bound(bounds.begin(), bounds.end(), x) - bounds.begin();
+        Metrics::add(slot + i, 1);
+        addDouble(slot + bounds.size() + 1, x);
+      }
+
+      /// Per bucket, not cumulative, counts with the +Inf bucket last
+      std::vector<uint64_t> getCounts() const;
+      uint64_t getCount() const;
+      double getSum() const;
+    };
+
+    typedef std::function<void (JSON::Sink &sink)> stats_t;
+
+  private:
+    typedef enum {COUNTER, GAUGE, HISTOGRAM} type_t;
+
+    struct Metric {
+      std::string name;
+      std::string labels;
+      std::string help;
+      type_t type;
+      Counter counter;
+      Gauge gauge;
+      Histogram histogram;
+    };
+
+    Mutex metricsLock;
+    // Keyed by name then labels so each family's series are contiguous
+    typedef std::map<std::pair<std::string, std::string>, Metric> metrics_t;
+    metrics_t metrics;
+    unsigned nextSlot  = 2; // Slots 0 & 1 are scratch for unset handles
+    unsigned nextGauge = 1;
+
+    // Freed by remove() for reuse
+    std::map<unsigned, unsigned> freedSlots; // Start to count
+    std::vector<unsigned> freedGauges;
+
+    typedef std::set<std::pair<std::string, std::string> > series_t;
+
+    struct Stats {
+      std::string prefix;
+      std::string labels;
+      stats_t cb;
+      series_t series; // Gauges created for these stats
+    };
+
+    Mutex statsLock;
+    std::multimap<const void *, Stats> stats;
+
+  public:
+    Metrics(Inaccessible) {}
+
+    /// Registering an existing name and labels returns the same metric
+    Counter getCounter(const std::string &name, const std::string &help = "",
+                       const std::string &labels = "");
+    Gauge getGauge(const std::string &name, const std::string &help = "",
+                   const std::string &labels = "");
+    Histogram getHistogram(const std::string &name,
+                           const std::vector<double> &bounds,
+                           const std::string &help = "",
+                           const std::string &labels = "");
+
+    /// Unregister a metric and free its slots.  Its handles must not be used.
+    void remove(const std::string &name, const std::string &labels = "");
+    /// Unregister every metric which has @param label, e.g. server="1"
+    void removeLabeled(const std::string &label);
+
+    /***
+     * Export the numbers written by @param cb as gauges named
+     * @param prefix followed by their path.  Dict keys extend the name
+     * and list entries are told apart with an index label.
+     */
+    void addStats(const void *owner, const std::string &prefix,
+                  const std::string &labels, stats_t cb);
+    /***
+     * Also removes the gauges created for the owner's stats.  Waits for a
+     * running export so the owner may be destroyed after.
+     */
+    void removeStats(const void *owner);
+
+    /// Prometheus text exposition format version 0.0.4
+    void writePrometheus(std::ostream &stream) const;
+
+    // From JSON::Serializable
+    using JSON::Serializable::write;
+    void write(JSON::Sink &sink) const override;
+
+  protected:
+    void collect();
+    void collect(const std::string &name, const std::string &labels,
+                 const JSON::Value &value, series_t &series);
+    unsigned allocSlots(unsigned count);
+    void releaseSlots(unsigned slot, unsigned count);
+    void remove(metrics_t::iterator it);
+    Metric &lookup(const std::string &name, const std::string &labels,
+                   const std::string &help, type_t type, bool &created);
+  };
+}
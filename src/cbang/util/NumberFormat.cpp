@@ -0,0 +1,473 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#include "NumberFormat.h"
+
+#include <cstring>
+
+using namespace cb;
+
+
+namespace {
+  const char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+
+  // Writes digits right to left ending at @param end, returns the start
+  inline char *formatDigits(char *end, uint64_t x) {
+    while (100 <= x) {
+      unsigned i = (unsigned)(x % 100) * 2;
+      x /= 100;
+      end -= 2;
+      memcpy(end, digitPairs + i, 2);
+    }
+
+    if (x < 10) *--end = '0' + (char)x;
+    else {
+      end -= 2;
+      memcpy(end, digitPairs + x * 2, 2);
+    }
+
+    return end;
+  }
+
+
+  inline uint64_t toBits(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+  }
+
+
+  /***************************************************************************
+   * Grisu2, see Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+   * Accurately with Integers", PLDI 2010.
+   */
+  struct DiyFP {
+    uint64_t f;
+    int e;
+
+    DiyFP(uint64_t f = 0, int e = 0) : f(f), e(e) {}
+
+    DiyFP operator-(const DiyFP &o) const {return DiyFP(f - o.f, e);}
+
+
+    // Upper 64 bits of the 128 bit product, rounded
+    DiyFP operator*(const DiyFP &o) const {
+      const uint64_t mask = 0xffffffffULL;
+
+      uint64_t a = f >> 32, b = f & mask;
+      uint64_t c = o.f >> 32, d = o.f & mask;
+
+      uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+      uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+      tmp += 1ULL << 31;
+
+      return DiyFP(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + o.e + 64);
+    }
+
+
+    DiyFP normalize() const {
+      DiyFP x = *this;
+      while (!(x.f >> 63)) {x.f <<= 1; x.e--;}
+      return x;
+    }
+
+
+    DiyFP normalizeTo(int target) const {
+      return DiyFP(f << (e - target), target);
+    }
+  };
+
+
+  struct CachedPower {
+    uint64_t f;
+    int e;
+    int k;
+  };
+
+
+  // Normalized 64-bit approximations of 10^k for k = -300, -292, ..., 324
+  const CachedPower cachedPowers[] = {
+    {0xAB70FE17C79AC6CAULL, -1060, -300},
+    {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+    {0xBE5691EF416BD60CULL, -1007, -284},
+    {0x8DD01FAD907FFC3CULL,  -980, -276},
+    {0xD3515C2831559A83ULL,  -954, -268},
+    {0x9D71AC8FADA6C9B5ULL,  -927, -260},
+    {0xEA9C227723EE8BCBULL,  -901, -252},
+    {0xAECC49914078536DULL,  -874, -244},
+    {0x823C12795DB6CE57ULL,  -847, -236},
+    {0xC21094364DFB5637ULL,  -821, -228},
+    {0x9096EA6F3848984FULL,  -794, -220},
+    {0xD77485CB25823AC7ULL,  -768, -212},
+    {0xA086CFCD97BF97F4ULL,  -741, -204},
+    {0xEF340A98172AACE5ULL,  -715, -196},
+    {0xB23867FB2A35B28EULL,  -688, -188},
+    {0x84C8D4DFD2C63F3BULL,  -661, -180},
+    {0xC5DD44271AD3CDBAULL,  -635, -172},
+    {0x936B9FCEBB25C996ULL,  -608, -164},
+    {0xDBAC6C247D62A584ULL,  -582, -156},
+    {0xA3AB66580D5FDAF6ULL,  -555, -148},
+    {0xF3E2F893DEC3F126ULL,  -529, -140},
+    {0xB5B5ADA8AAFF80B8ULL,  -502, -132},
+    {0x87625F056C7C4A8BULL,  -475, -124},
+    {0xC9BCFF6034C13053ULL,  -449, -116},
+    {0x964E858C91BA2655ULL,  -422, -108},
+    {0xDFF9772470297EBDULL,  -396, -100},
+    {0xA6DFBD9FB8E5B88FULL,  -369,  -92},
+    {0xF8A95FCF88747D94ULL,  -343,  -84},
+    {0xB94470938FA89BCFULL,  -316,  -76},
+    {0x8A08F0F8BF0F156BULL,  -289,  -68},
+    {0xCDB02555653131B6ULL,  -263,  -60},
+    {0x993FE2C6D07B7FACULL,  -236,  -52},
+    {0xE45C10C42A2B3B06ULL,  -210,  -44},
+    {0xAA242499697392D3ULL,  -183,  -36},
+    {0xFD87B5F28300CA0EULL,  -157,  -28},
+    {0xBCE5086492111AEBULL,  -130,  -20},
+    {0x8CBCCC096F5088CCULL,  -103,  -12},
+    {0xD1B71758E219652CULL,   -77,   -4},
+    {0x9C40000000000000ULL,   -50,    4},
+    {0xE8D4A51000000000ULL,   -24,   12},
+    {0xAD78EBC5AC620000ULL,     3,   20},
+    {0x813F3978F8940984ULL,    30,   28},
+    {0xC097CE7BC90715B3ULL,    56,   36},
+    {0x8F7E32CE7BEA5C70ULL,    83,   44},
+    {0xD5D238A4ABE98068ULL,   109,   52},
+    {0x9F4F2726179A2245ULL,   136,   60},
+    {0xED63A231D4C4FB27ULL,   162,   68},
+    {0xB0DE65388CC8ADA8ULL,   189,   76},
+    {0x83C7088E1AAB65DBULL,   216,   84},
+    {0xC45D1DF942711D9AULL,   242,   92},
+    {0x924D692CA61BE758ULL,   269,  100},
+    {0xDA01EE641A708DEAULL,   295,  108},
+    {0xA26DA3999AEF774AULL,   322,  116},
+    {0xF209787BB47D6B85ULL,   348,  124},
+    {0xB454E4A179DD1877ULL,   375,  132},
+    {0x865B86925B9BC5C2ULL,   402,  140},
+    {0xC83553C5C8965D3DULL,   428,  148},
+    {0x952AB45CFA97A0B3ULL,   455,  156},
+    {0xDE469FBD99A05FE3ULL,   481,  164},
+    {0xA59BC234DB398C25ULL,   508,  172},
+    {0xF6C69A72A3989F5CULL,   534,  180},
+    {0xB7DCBF5354E9BECEULL,   561,  188},
+    {0x88FCF317F22241E2ULL,   588,  196},
+    {0xCC20CE9BD35C78A5ULL,   614,  204},
+    {0x98165AF37B2153DFULL,   641,  212},
+    {0xE2A0B5DC971F303AULL,   667,  220},
+    {0xA8D9D1535CE3B396ULL,   694,  228},
+    {0xFB9B7CD9A4A7443CULL,   720,  236},
+    {0xBB764C4CA7A44410ULL,   747,  244},
+    {0x8BAB8EEFB6409C1AULL,   774,  252},
+    {0xD01FEF10A657842CULL,   800,  260},
+    {0x9B10A4E5E9913129ULL,   827,  268},
+    {0xE7109BFBA19C0C9DULL,   853,  276},
+    {0xAC2820D9623BF429ULL,   880,  284},
+    {0x80444B5E7AA7CF85ULL,   907,  292},
+    {0xBF21E44003ACDD2DULL,   933,  300},
+    {0x8E679C2F5E44FF8FULL,   960,  308},
+    {0xD433179D9C8CB841ULL,   986,  316},
+    {0x9E19DB92B4E31BA9ULL,  1013,  324},
+  };
+
+  const int cachedPowersMinK = -300;
+  const int cachedPowersStep = 8;
+
+  // Target range for the binary exponent of the scaled value
+  const int alpha = -60;
+
+
+  const CachedPower &getCachedPower(int e) {
+    // Find k such that alpha <= e + e_c + 64 with e_c the binary exponent
+    // of 10^-k.  78913 / 2^18 ~= log10(2)
+    int f = alpha - e - 1;
+    int k = f * 78913 / (1 << 18) + (0 < f);
+    unsigned index = (unsigned)(-cachedPowersMinK + k + cachedPowersStep - 1) /
+      cachedPowersStep;
+
+    return cachedPowers[index];
+  }
+
+
+  unsigned largestPow10(uint32_t n, uint32_t &pow10) {
+    static const uint32_t powers[] = {
+      1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+      1000000000,
+    };
+
+    unsigned digits = 10;
+    while (1 < digits && n < powers[digits - 1]) digits--;
+    pow10 = powers[digits - 1];
+
+    return digits;
+  }
+
+
+  void round(char *buf, unsigned length, uint64_t dist, uint64_t delta,
+             uint64_t rest, uint64_t tenK) {
+    // Move the last digit towards w while staying inside the bounds
+    while (rest < dist && tenK <= delta - rest &&
+           (rest + tenK < dist || rest + tenK - dist < dist - rest)) {
+      buf[length - 1]--;
+      rest += tenK;
+    }
+  }
+
+
+  void generateDigits(char *buf, unsigned &length, int &exp,
+                      const DiyFP &low, const DiyFP &w, const DiyFP &high) {
+    uint64_t delta = (high - low).f;
+    uint64_t dist = (high - w).f;
+
+    const DiyFP one(1ULL << -high.e, high.e);
+    uint32_t p1 = (uint32_t)(high.f >> -one.e);
+    uint64_t p2 = high.f & (one.f - 1);
+
+    // Integral digits
+    uint32_t pow10;
+    unsigned n = largestPow10(p1, pow10);
+
+    while (n) {
+      buf[length++] = '0' + p1 / pow10;
+      p1 %= pow10;
+      n--;
+
+      uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+      if (rest <= delta) {
+        exp += n;
+        round(buf, length, dist, delta, rest, (uint64_t)pow10 << -one.e);
+        return;
+      }
+
+      pow10 /= 10;
+    }
+
+    // Fractional digits
+    int m = 0;
+    while (true) {
+      p2 *= 10;
+      buf[length++] = '0' + (char)(p2 >> -one.e);
+      p2 &= one.f - 1;
+      m++;
+
+      delta *= 10;
+      dist *= 10;
+
+      if (p2 <= delta) break;
+    }
+
+    exp -= m;
+    round(buf, length, dist, delta, p2, one.f);
+  }
+
+
+  // Fills @param buf with digits d such that d * 10^exp rounds to x.
+  // Usually, but not always, the shortest such digits.
+  unsigned grisu2(char *buf, int &exp, double x) {
+    const uint64_t hiddenBit = 1ULL << 52;
+    const int bias = 1023 + 52;
+
+    uint64_t bits = toBits(x);
+    uint64_t F = bits & (hiddenBit - 1);
+    int E = (int)(bits >> 52) & 0x7ff;
+
+    DiyFP v = E ? DiyFP(F + hiddenBit, E - bias) : DiyFP(F, 1 - bias);
+
+    // Boundaries halfway to the neighboring doubles
+    bool lowerCloser = !F && 1 < E;
+    DiyFP high = DiyFP((v.f << 1) + 1, v.e - 1).normalize();
+    DiyFP low = lowerCloser ? DiyFP((v.f << 2) - 1, v.e - 2) :
+      DiyFP((v.f << 1) - 1, v.e - 1);
+    low = low.normalizeTo(high.e);
+    v = v.normalize();
+
+    // Scale into the target exponent range
+    const CachedPower &cached = getCachedPower(high.e);
+    DiyFP c(cached.f, cached.e);
+
+    DiyFP w = v * c;
+    DiyFP wLow = low * c;
+    DiyFP wHigh = high * c;
+
+    // Narrow the bounds by one unit to account for rounding
+    wLow.f++;
+    wHigh.f--;
+
+    unsigned length = 0;
+    exp = -cached.k;
+    generateDigits(buf, length, exp, wLow, w, wHigh);
+
+    return length;
+  }
+}
+
+
+unsigned NumberFormat::formatU64(char *buf, uint64_t x) {
+  char tmp[20];
+  char *end = tmp + sizeof(tmp);
+  char *start = formatDigits(end, x);
+  unsigned length = end - start;
+  memcpy(buf, start, length);
+  return length;
+}
+
+
+unsigned NumberFormat::formatS64(char *buf, int64_t x) {
+  if (0 <= x) return formatU64(buf, x);
+  *buf = '-';
+  return formatU64(buf + 1, -(uint64_t)x) + 1;
+}
+
+
+unsigned NumberFormat::formatShortest(char *buf, double x) {
+  if (x == 0) {*buf = '0'; return 1;}
+
+  char *s = buf;
+  if (x < 0) {*s++ = '-'; x = -x;}
+
+  char digits[18];
+  int exp;
+  int n = grisu2(digits, exp, x);
+
+  // Position of the decimal point relative to the first digit
+  int point = n + exp;
+
+  if (0 <= exp && point <= 21) {
+    // Integer, pad with zeros
+    memcpy(s, digits, n);
+    s += n;
+    memset(s, '0', exp);
+    s += exp;
+
+  } else if (0 < point && point <= 21) {
+    // Decimal point inside the digits
+    memcpy(s, digits, point);
+    s += point;
+    *s++ = '.';
+    memcpy(s, digits + point, n - point);
+    s += n - point;
+
+  } else if (-6 < point && point <= 0) {
+    // Leading zeros
+    *s++ = '0';
+    *s++ = '.';
+    memset(s, '0', -point);
+    s += -point;
+    memcpy(s, digits, n);
+    s += n;
+
+  } else {
+    // Scientific
+    *s++ = digits[0];
+    if (1 < n) {
+      *s++ = '.';
+      memcpy(s, digits + 1, n - 1);
+      s += n - 1;
+    }
+
+    int e = point - 1;
+    *s++ = 'e';
+    *s++ = e < 0 ? '-' : '+';
+    s += formatU64(s, e < 0 ? -e : e);
+  }
+
+  return s - buf;
+}
+
+
+unsigned NumberFormat::formatFixed(char *buf, double x, int precision) {
+#ifdef __SIZEOF_INT128__
+  typedef unsigned __int128 uint128_t;
+
+  static const uint64_t pow10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL,
+  };
+
+  // Zero precision and large values use other code paths in cb::String
+  if (precision < 1 || 17 < precision || !(-1e18 < x && x < 1e18)) return 0;
+
+  uint64_t bits = toBits(x);
+  uint64_t m = bits & ((1ULL << 52) - 1);
+  int e = (int)(bits >> 52) & 0x7ff;
+
+  if (e) m |= 1ULL << 52;
+  else e = 1;
+  e -= 1023 + 52; // x = m * 2^e
+
+  // Round x * 10^precision to the nearest integer, ties to even like printf
+  const uint64_t scale = pow10[precision];
+  uint128_t q = (uint128_t)m * scale;
+
+  if (0 <= e) q <<= e;
+  else if (-e < 128) {
+    unsigned shift = -e;
+    uint128_t rem = q & (((uint128_t)1 << shift) - 1);
+    uint128_t half = (uint128_t)1 << (shift - 1);
+
+    q >>= shift;
+    if (half < rem || (rem == half && (q & 1))) q++;
+
+  } else q = 0;
+
+  // Negative values which round to zero are written as "0"
+  if (!q) {*buf = '0'; return 1;}
+
+  char *s = buf;
+  if (bits >> 63) *s++ = '-';
+
+  s += formatU64(s, (uint64_t)(q / scale));
+
+  uint64_t frac = (uint64_t)(q % scale);
+  if (frac) {
+    int digits = precision;
+    while (!(frac % 10)) {frac /= 10; digits--;}
+
+    *s++ = '.';
+    char *end = s + digits;
+    char *start = formatDigits(end, frac);
+    memset(s, '0', start - s);
+    s = end;
+  }
+
+  return s - buf;
+
+#else
+  return 0;
+#endif
+}
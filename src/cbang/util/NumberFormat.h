@@ -0,0 +1,71 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace cb {
+  /**
+   * Number to text conversions which write directly to a caller supplied
+   * buffer.  They do not allocate or consult stream or locale state.  The
+   * buffer must hold at least NumberFormat::maxLength characters.  The
+   * result is not terminated, the number of characters written is returned.
+   */
+  namespace NumberFormat {
+    const unsigned maxLength = 48;
+
+    unsigned formatU64(char *buf, uint64_t x);
+    unsigned formatS64(char *buf, int64_t x);
+
+    /**
+     * Write a decimal string which parses back to exactly @param x using the
+     * Grisu2 algorithm.  The result is almost always the shortest such
+     * string but, unlike Grisu3, Grisu2 does not guarantee it and may emit
+     * an extra digit for a small fraction of values.  Numbers with a decimal
+     * exponent between -7 and 21 are written in plain notation, others in
+     * scientific notation.  Negative zero is written as "0".  @param x must
+     * be finite.
+     */
+    unsigned formatShortest(char *buf, double x);
+
+    /**
+     * Write @param x rounded to @param precision decimal places with
+     * trailing zeros removed.  The result matches cb::String(x, precision).
+     * @return 0 if this case is not handled, the caller should fall back to
+     * cb::String().
+     */
+    unsigned formatFixed(char *buf, double x, int precision);
+  }
+}
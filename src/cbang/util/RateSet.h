@@ -33,6 +33,7 @@
 #pragma once
 
 #include "Rate.h"
+#include "Metrics.h"
 
 #include <cbang/Exception.h>
 #include <cbang/json/Serializable.h>
@@ -48,13 +49,21 @@ namespace cb {
     const unsigned period;
 
     typedef std::map<const std::string, Rate> rates_t;
-    rates_t rates;
+    mutable rates_t rates;
+
+    // Counters are sampled into rates by sample() and when read
+    typedef std::map<const std::string, std::pair<Metrics::Counter, uint64_t> >
+    counters_t;
+    mutable counters_t counters;
 
   public:
     RateSet(unsigned size = 60 * 5, unsigned period = 1) :
       size(size), period(period) {}
 
 
+    unsigned getPeriod() const {return period;}
+
+
     Rate &getRate(const std::string &key) {
       return rates.insert(rates_t::value_type(key, Rate(size, period)))
         .first->second;
@@ -68,6 +77,33 @@ namespace cb {
     }
 
 
+    /// Report @param counter's increments as events on @param key
+    void add(const std::string &key, const Metrics::Counter &counter) {
+      counters[key] = std::make_pair(counter, counter.get());
+    }
+
+
+    /// Stop reporting @param counter, keeping the events already sampled
+    void remove(const Metrics::Counter &counter) {
+      sample();
+
+      for (auto it = counters.begin(); it != counters.end();)
+        if (it->second.first == counter) it = counters.erase(it);
+        else it++;
+    }
+
+
+    void sample(uint64_t now = Time::now()) const {
+      for (auto &p: counters) {
+        uint64_t value = p.second.first.get();
+        if (value == p.second.second) continue;
+        rates.insert(rates_t::value_type(p.first, Rate(size, period)))
+          .first->second.event(value - p.second.second, now);
+        p.second.second = value;
+      }
+    }
+
+
     void reset() {for (auto &p: rates)p.second.reset();}
 
 
@@ -77,6 +113,7 @@ namespace cb {
 
 
     double get(const std::string &key, uint64_t now = Time::now()) const {
+      sample(now);
       return getRate(key).get(now);
     }
 
@@ -93,6 +130,8 @@ namespace cb {
 
 
     void insert(JSON::Sink &sink, bool withTotals = false) const {
+      sample();
+
       for (auto &p: *this)
         if (!withTotals) sink.insert(p.first, p.second.get());
         else {
@@ -45,10 +45,37 @@ const Resource &Resource::get(const string &path) const {
 }
 
 
+uint32_t ResourceIndex::hash(uint32_t seed, const char *s, unsigned length) {
+  // FNV-1a, seeded through the offset basis.  Must match config/resources
+  uint32_t h = seed ? seed : 0x811c9dc5;
+
+  for (unsigned i = 0; i < length; i++) {
+    h ^= (uint8_t)s[i];
+    h *= 0x01000193;
+  }
+
+  return h;
+}
+
+
+const Resource *ResourceIndex::find(const string &path) const {
+  if (!size) return 0;
+
+  int d = displace[hash(0, path.data(), path.length()) % size];
+  unsigned slot =
+    d < 0 ? -d - 1 : hash(d, path.data(), path.length()) % size;
+
+  return path == paths[slot] ? resources[slot] : 0;
+}
+
+
 const Resource *DirectoryResource::find(const string &path) const {
   if (path.empty()) return 0;
   if (path[0] == '/') return find(path.substr(1));
 
+  // The index only holds normalized paths
+  if (index && path.find("//") == string::npos) return index->find(path);
+
   string::size_type pos = path.find('/');
   string name;
   if (pos == string::npos) name = path;
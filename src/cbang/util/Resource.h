@@ -36,9 +36,39 @@
 
 #include <string>
 #include <ostream>
+#include <cstdint>
 
 
 namespace cb {
+  class Resource;
+
+
+  /// A precompressed copy of a file resource
+  struct ResourceVariant {
+    const char *encoding; // HTTP Content-Encoding, null terminates the list
+    const char *etag;
+    const char *data;
+    unsigned length;
+  };
+
+
+  /***
+   * A minimal perfect hash of every path below a directory resource,
+   * computed by the resource generator.  A path hashes to a bucket whose
+   * displacement either names a slot directly, if negative, or is the seed
+   * of a second hash which selects the slot.
+   */
+  struct ResourceIndex {
+    unsigned size;
+    const int *displace;
+    const char **paths;
+    const Resource **resources;
+
+    static uint32_t hash(uint32_t seed, const char *s, unsigned length);
+    const Resource *find(const std::string &path) const;
+  };
+
+
   class Resource {
   public:
     const char *name;
@@ -62,6 +92,8 @@ namespace cb {
     {CBANG_THROW(CBANG_FUNC << "() not supported by resource");}
     virtual std::string toString() const
     {CBANG_THROW(CBANG_FUNC << "() not supported by resource");}
+    virtual const char *getETag() const {return 0;}
+    virtual const ResourceVariant *getVariants() const {return 0;}
 
     const Resource &get(const std::string &path) const;
   };
@@ -71,23 +103,31 @@ namespace cb {
   public:
     const char *data;
     const unsigned length;
+    const char *etag;
+    const ResourceVariant *variants;
 
-    FileResource(const char *name, const char *data, unsigned length) :
-      Resource(name), data(data), length(length) {}
+    FileResource(const char *name, const char *data, unsigned length,
+                 const char *etag = 0, const ResourceVariant *variants = 0) :
+      Resource(name), data(data), length(length), etag(etag),
+      variants(variants) {}
 
     // From Resource
     const char *getData() const override {return data;}
     unsigned getLength() const override {return length;}
     std::string toString() const override {return std::string(data, length);}
+    const char *getETag() const override {return etag;}
+    const ResourceVariant *getVariants() const override {return variants;}
   };
 
 
   class DirectoryResource : public Resource {
   public:
     const Resource **children;
+    const ResourceIndex *index;
 
-    DirectoryResource(const char *name, const Resource **children) :
-      Resource(name), children(children) {}
+    DirectoryResource(const char *name, const Resource **children,
+                      const ResourceIndex *index = 0) :
+      Resource(name), children(children), index(index) {}
 
     // From Resource
     bool isDirectory() const override {return true;}
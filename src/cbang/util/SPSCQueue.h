@@ -52,6 +52,10 @@ namespace cb {
     bool empty() const {return !Super_T::peek();}
     void push(const T &value) {Super_T::enqueue(value);}
 
+    /// Push without allocating.  @return false if the queue is full.
+    bool tryPush(const T &value) {return Super_T::try_enqueue(value);}
+    bool tryPush(T &&value) {return Super_T::try_enqueue(std::move(value));}
+
 
     T &top() {
       T *value = Super_T::peek();
@@ -0,0 +1,127 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "TimerWheel.h"
+
+using namespace cb;
+
+
+TimerWheel::Timer::~Timer() {if (wheel) wheel->cancel(*this);}
+
+
+void TimerWheel::Timer::unlink() {
+  if (!prev) return;
+  prev->next = next;
+  next->prev = prev;
+  prev = next = 0;
+}
+
+
+TimerWheel::TimerWheel(uint64_t now) : current(now) {
+  for (unsigned level = 0; level < LEVELS; level++)
+    for (unsigned i = 0; i < SLOTS; i++)
+      slots[level][i].prev = slots[level][i].next = &slots[level][i];
+}
+
+
+TimerWheel::~TimerWheel() {
+  // Detach any remaining Timers so they do not reference this wheel
+  for (unsigned level = 0; level < LEVELS; level++)
+    for (unsigned i = 0; i < SLOTS; i++) {
+      Timer &head = slots[level][i];
+
+      while (head.next != &head) {
+        Timer &t = *head.next;
+        t.unlink();
+        t.wheel = 0;
+      }
+
+      head.prev = head.next = 0;
+    }
+
+  count = 0;
+}
+
+
+void TimerWheel::schedule(Timer &t, uint64_t expires) {
+  cancel(t);
+  t.expires = expires <= current ? current + 1 : expires;
+  link(t);
+  t.wheel = this;
+  count++;
+}
+
+
+void TimerWheel::cancel(Timer &t) {
+  if (!t.wheel) return;
+  t.unlink();
+  t.wheel->count--;
+  t.wheel = 0;
+}
+
+
+void TimerWheel::link(Timer &t) {
+  uint64_t delta = t.expires - current;
+  unsigned level = 0;
+
+  while (level < LEVELS - 1 && (SLOTS << (level * SLOT_BITS)) <= delta)
+    level++;
+
+  // Timers beyond the last level wait in its farthest slot
+  uint64_t expires = t.expires;
+  if (level == LEVELS - 1 && (SLOTS << (level * SLOT_BITS)) <= delta)
+    expires = current + ((uint64_t)SLOT_MASK << (level * SLOT_BITS));
+
+  Timer &head = slots[level][(expires >> (level * SLOT_BITS)) & SLOT_MASK];
+  t.prev = head.prev;
+  t.next = &head;
+  head.prev->next = &t;
+  head.prev = &t;
+}
+
+
+void TimerWheel::cascade(unsigned level) {
+  if (LEVELS <= level) return;
+
+  unsigned shift = level * SLOT_BITS;
+  uint64_t index = current >> shift;
+
+  // Cascade higher levels first so their timers can land in this level
+  if (!(index & SLOT_MASK)) cascade(level + 1);
+
+  Timer &head = slots[level][index & SLOT_MASK];
+  while (head.next != &head) {
+    Timer &t = *head.next;
+    t.unlink();
+    link(t);
+  }
+}
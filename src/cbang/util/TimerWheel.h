@@ -0,0 +1,114 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace cb {
+  /**
+   * A hierarchical timing wheel.  Timers are intrusive so scheduling,
+   * rescheduling and canceling are O(1) and never allocate.  Each level
+   * has 64 slots and each level's slots span 64 times the previous
+   * level's.  Timers which land in higher levels are cascaded down as the
+   * wheel turns.  Times are in arbitrary integer ticks, e.g. seconds.
+   */
+  class TimerWheel {
+  public:
+    class Timer {
+      friend class TimerWheel;
+      TimerWheel *wheel = 0;
+      Timer *prev = 0;
+      Timer *next = 0;
+      uint64_t expires = 0;
+
+    public:
+      Timer() {}
+      Timer(const Timer &) = delete;
+      /// Cancels the Timer if it is still scheduled
+      ~Timer();
+
+      bool isScheduled() const {return prev;}
+      uint64_t getExpires() const {return expires;}
+
+    protected:
+      void unlink();
+    };
+
+  private:
+    static const unsigned SLOT_BITS = 6;
+    static const unsigned SLOTS     = 1 << SLOT_BITS;
+    static const unsigned SLOT_MASK = SLOTS - 1;
+    static const unsigned LEVELS    = 5;
+
+    // Slots are circular lists with a sentinel head
+    Timer slots[LEVELS][SLOTS];
+    uint64_t current;
+    unsigned count = 0;
+
+  public:
+    TimerWheel(uint64_t now = 0);
+    TimerWheel(const TimerWheel &) = delete;
+    ~TimerWheel();
+
+    uint64_t getCurrent() const {return current;}
+    unsigned size() const {return count;}
+    bool empty() const {return !count;}
+
+    /// Schedule or reschedule @param t.  Times in the past fire on next tick.
+    void schedule(Timer &t, uint64_t expires);
+    void cancel(Timer &t);
+
+    /// Advance to @param now calling @param cb for each expired Timer
+    template <typename CB>
+    void expire(uint64_t now, CB cb) {
+      while (current < now) {
+        if (!count) {current = now; break;}
+
+        current++;
+        if (!(current & SLOT_MASK)) cascade(1);
+
+        Timer &head = slots[0][current & SLOT_MASK];
+        while (head.next != &head) {
+          Timer &t = *head.next;
+          cancel(t);
+          cb(t);
+        }
+      }
+    }
+
+  protected:
+    void link(Timer &t);
+    void cascade(unsigned level);
+  };
+}
@@ -35,6 +35,7 @@
 #include <cbang/Catch.h>
 #include <cbang/log/Logger.h>
 #include <cbang/io/VectorStream.h>
+#include <cbang/json/BufferReader.h>
 
 
 using namespace cb;
@@ -78,7 +79,7 @@ SmartPointer<JSON::Writer> JSONWebsocket::getJSONWriter() {
 
 
 void JSONWebsocket::onMessage(const char *data, uint64_t length) {
-  auto value = JSON::Reader::parse(InputSource(data, length));
+  auto value = JSON::BufferReader::parse(data, length);
   LOG_DEBUG(6, "Received: " << *value);
   onMessage(value);
 }
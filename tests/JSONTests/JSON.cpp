@@ -34,9 +34,12 @@
 
 #include <cbang/json/Value.h>
 #include <cbang/json/Reader.h>
+#include <cbang/json/BufferReader.h>
+#include <cbang/json/CompactBuilder.h>
 #include <cbang/json/YAMLReader.h>
 
 #include <iostream>
+#include <iterator>
 
 using namespace std;
 using namespace cb::JSON;
@@ -56,6 +59,22 @@ int main(int argc, char *argv[]) {
         cout << *docs[i];
       }
 
+    } else if (argc == 2 && string(argv[1]) == "--buffer") {
+      string input((istreambuf_iterator<char>(cin)),
+                   istreambuf_iterator<char>());
+      data = BufferReader(input).parse();
+      if (!data.isNull()) cout << *data;
+
+    } else if (argc == 2 && string(argv[1]) == "--compact") {
+      string input((istreambuf_iterator<char>(cin)),
+                   istreambuf_iterator<char>());
+      data = CompactBuilder::parse(input);
+      if (!data.isNull()) cout << *data;
+
+    } else if (argc == 2 && string(argv[1]) == "--shortest") {
+      data = Reader(cin).parse();
+      if (!data.isNull()) data->write(cout, 0, false, 2, -1);
+
     } else {
       Reader reader(cin);
       data = reader.parse();
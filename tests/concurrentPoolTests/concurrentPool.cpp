@@ -0,0 +1,198 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/ConcurrentPool.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  struct Test {
+    Event::Base &base;
+    Event::ConcurrentPool pool;
+    Mutex lock;
+    vector<int> ran;
+    vector<int> completed;
+    unsigned expected = 0;
+
+    Test(Event::Base &base, unsigned workers) :
+      base(base), pool(base, workers) {}
+
+
+    void submit(int priority, int id, double delay = 0) {
+      expected++;
+
+      pool.submit<int>(
+        priority,
+        [this, id, delay] () {
+          if (delay) Timer::sleep(delay);
+          SmartLock l(&lock);
+          ran.push_back(id);
+          return id;
+        },
+        [this] (int &id) {
+          completed.push_back(id);
+          if (completed.size() == expected) base.loopExit();
+        });
+    }
+
+
+    void timeout() {
+      cout << "timed out" << endl;
+      base.loopExit();
+    }
+
+
+    void run(bool batch = false) {
+      // Also keeps the loop running until the first completion
+      auto event = base.newEvent(this, &Test::timeout, 0);
+      event->add(10);
+
+      pool.start();
+
+      // Let every Task finish so they are completed in a single batch
+      if (batch)
+        while (pool.getNumCompleted() < expected) Timer::sleep(0.001);
+
+      base.dispatch();
+      event->del();
+      pool.join();
+    }
+
+
+    static void print(const char *name, const vector<int> &ids) {
+      cout << name << ":";
+      for (auto id: ids) cout << ' ' << id;
+      cout << endl;
+    }
+  };
+
+
+  void testPriority(Event::Base &base) {
+    // A single worker runs injected Tasks by priority then oldest first
+    Test test(base, 1);
+
+    for (int i = 0; i < 6; i++) test.submit(i % 3, i);
+
+    test.run();
+    Test::print("ran", test.ran);
+  }
+
+
+  void testFIFO(Event::Base &base) {
+    Test test(base, 1);
+
+    for (int i = 0; i < 8; i++) test.submit(0, i);
+
+    test.run();
+    Test::print("ran", test.ran);
+  }
+
+
+  void testSteal(Event::Base &base) {
+    Test test(base, 4);
+
+    // Subtasks go to the submitting worker's own queue
+    test.expected += 16;
+    test.pool.submit<int>(
+      0,
+      [&test] () {
+        for (int i = 0; i < 16; i++)
+          test.pool.submit<int>(
+            0, [] () {Timer::sleep(0.01); return 0;},
+            [&test] (int &id) {
+              test.completed.push_back(id);
+              if (test.completed.size() == test.expected)
+                test.base.loopExit();
+            });
+
+        Timer::sleep(0.1);
+        return 0;
+      },
+      [&test] (int &id) {
+        test.completed.push_back(id);
+        if (test.completed.size() == test.expected) test.base.loopExit();
+      });
+    test.expected++;
+
+    test.run();
+
+    cout << "completed: " << test.completed.size() << endl;
+    cout << "stolen: " << (test.pool.getNumSteals() ? "true" : "false")
+         << endl;
+  }
+
+
+  void testBatch(Event::Base &base) {
+    Test test(base, 4);
+
+    for (int i = 0; i < 32; i++) test.submit(i % 4, i % 4);
+
+    test.run(true);
+    Test::print("completed", test.completed);
+    cout << "pending: " << test.pool.getNumCompleted() << endl;
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc != 2) {
+      cout << "Usage: " << argv[0] << " <priority|fifo|steal|batch>" << endl;
+      return 1;
+    }
+
+    Event::Base::enableThreads();
+    Event::Base base(true);
+    string test = argv[1];
+
+    if (test == "priority") testPriority(base);
+    else if (test == "fifo") testFIFO(base);
+    else if (test == "steal") testSteal(base);
+    else if (test == "batch") testBatch(base);
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
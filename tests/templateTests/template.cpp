@@ -0,0 +1,97 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+
+#include <cbang/Catch.h>
+#include <cbang/api/API.h>
+#include <cbang/api/Resolver.h>
+#include <cbang/api/Template.h>
+#include <cbang/config/Options.h>
+#include <cbang/http/Conn.h>
+#include <cbang/json/Reader.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+  try {
+    // Formats each of "templates" with a Template and with the string path
+    JSON::ValuePtr config = JSON::Reader(cin).parse();
+
+    Options options;
+    if (config->has("options")) {
+      auto &opts = *config->get("options");
+      for (unsigned i = 0; i < opts.size(); i++)
+        options.add(opts.keyAt(i), "")->set(opts.getString(i));
+    }
+
+    API::API api(options);
+
+    SmartPointer<HTTP::Request> req = new HTTP::Request(0);
+    if (config->has("args")) req->getArgs()->merge(*config->get("args"));
+    if (config->has("session"))
+      req->setSession(new HTTP::Session(*config->get("session")));
+
+    // Context with a parent context
+    API::ResolverPtr resolver = new API::Resolver(api, req);
+    resolver = resolver->makeChild(config->get("parent", new JSON::Dict))
+      ->makeChild(config->get("context", new JSON::Dict));
+
+    string defaultValue = config->getString("default", "?");
+    auto &templates = *config->get("templates");
+
+    for (unsigned i = 0; i < templates.size(); i++) {
+      string source = templates.getString(i);
+      API::Template tmpl(source);
+
+      string result = tmpl.format(*resolver);
+      string expected = resolver->format(source);
+      string withDefault = resolver->format(tmpl, defaultValue);
+      string expectedDefault = resolver->format(source, defaultValue);
+
+      cout << source << " -> " << result;
+      if (result != expected) cout << " != " << expected;
+      cout << " | " << withDefault;
+      if (withDefault != expectedDefault) cout << " != " << expectedDefault;
+      cout << endl;
+    }
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
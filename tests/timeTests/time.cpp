@@ -0,0 +1,122 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/time/Time.h>
+
+#include <cbang/boost/StartInclude.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <cbang/boost/EndInclude.h>
+
+#include <iostream>
+#include <sstream>
+#include <locale>
+#include <random>
+
+using namespace cb;
+using namespace std;
+
+namespace pt = boost::posix_time;
+
+
+namespace {
+  const char *formats[] = {
+    Time::iso8601Format, Time::httpFormat, Time::sqlFormat, "%Y%m%d %T",
+    "%a %b %d%F %%", 0
+  };
+
+
+  // The boost facet path Time::toString() uses for other directives
+  string boostFormat(uint64_t t, const string &format) {
+    pt::time_facet *facet = new pt::time_facet();
+    facet->format(format.c_str());
+
+    pt::ptime time(boost::gregorian::date(1970, 1, 1), pt::seconds(t));
+    stringstream ss;
+    ss.imbue(locale(ss.getloc(), facet));
+    ss << time;
+
+    return ss.str();
+  }
+
+
+  bool check(uint64_t t, const char *format, bool print) {
+    string fast = Time(t).toString(format);
+    string expected = boostFormat(t, format);
+
+    if (print) {
+      cout << fast;
+      if (fast != expected) cout << " != " << expected;
+      cout << endl;
+    }
+
+    return fast == expected;
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) {
+      cout << "Usage: " << argv[0] << " <random | time...>" << endl;
+      return 1;
+    }
+
+    if (string(argv[1]) == "random") {
+      // Up to the end of year 9999, the limit of boost's calendar
+      mt19937_64 rand(1);
+      unsigned errors = 0;
+
+      for (unsigned i = 0; i < 20000; i++) {
+        uint64_t t = 1 + rand() % 253402300799;
+        for (unsigned j = 0; formats[j]; j++)
+          if (!check(t, formats[j], false)) errors++;
+      }
+
+      cout << "errors: " << errors << endl;
+      return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+      uint64_t t = String::parseU64(argv[i]);
+      for (unsigned j = 0; formats[j]; j++) check(t, formats[j], true);
+    }
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
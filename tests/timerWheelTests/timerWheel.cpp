@@ -0,0 +1,181 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+
+#include <cbang/Catch.h>
+#include <cbang/util/TimerWheel.h>
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  struct Timer : public TimerWheel::Timer {
+    unsigned id;
+    uint64_t fired = 0;
+    Timer(unsigned id = 0) : id(id) {}
+  };
+
+
+  void testOrder() {
+    TimerWheel wheel(10);
+    Timer timers[6];
+
+    // Past, near and in each of the higher levels
+    uint64_t expires[6] = {5, 11, 74, 4200, 300000, 17000000};
+    for (unsigned i = 0; i < 6; i++) {
+      timers[i].id = i;
+      wheel.schedule(timers[i], expires[i]);
+    }
+
+    cout << "size: " << wheel.size() << endl;
+
+    wheel.expire(20000000, [&] (TimerWheel::Timer &t) {
+      Timer &timer = static_cast<Timer &>(t);
+      cout << timer.id << " fired at " << wheel.getCurrent() << endl;
+    });
+
+    cout << "size: " << wheel.size() << endl;
+  }
+
+
+  void testCancel() {
+    TimerWheel wheel;
+    Timer a(1), b(2), c(3);
+
+    wheel.schedule(a, 100);
+    wheel.schedule(b, 5000);
+    wheel.schedule(c, 70);
+
+    wheel.cancel(b);
+    wheel.schedule(c, 200); // Reschedule
+
+    {
+      Timer d(4);
+      wheel.schedule(d, 150);
+    } // Destroying a Timer cancels it
+
+    cout << "size: " << wheel.size() << endl;
+
+    wheel.expire(10000, [&] (TimerWheel::Timer &t) {
+      Timer &timer = static_cast<Timer &>(t);
+      cout << timer.id << " fired at " << wheel.getCurrent() << endl;
+    });
+
+    cout << "scheduled: " << a.isScheduled() << b.isScheduled()
+         << c.isScheduled() << endl;
+  }
+
+
+  void testPeriodic() {
+    TimerWheel wheel;
+    Timer t(1);
+    unsigned fired = 0;
+
+    wheel.schedule(t, 30);
+
+    // Reschedule from the callback
+    wheel.expire(1000, [&] (TimerWheel::Timer &t) {
+      if (++fired < 5) wheel.schedule(t, wheel.getCurrent() + 100);
+      cout << "fired at " << wheel.getCurrent() << endl;
+    });
+
+    cout << "size: " << wheel.size() << endl;
+  }
+
+
+  void testRandom() {
+    // Every Timer must fire exactly once, at its expiration
+    const unsigned count = 10000;
+    mt19937_64 rand(1);
+
+    TimerWheel wheel(rand() % 1000);
+    vector<Timer> timers(count);
+    unsigned fired = 0;
+    unsigned errors = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+      timers[i].id = i;
+      wheel.schedule(timers[i], wheel.getCurrent() + 1 + rand() % (1 << 22));
+    }
+
+    while (!wheel.empty()) {
+      wheel.expire(wheel.getCurrent() + rand() % 5000,
+                   [&] (TimerWheel::Timer &t) {
+                     Timer &timer = static_cast<Timer &>(t);
+                     uint64_t now = wheel.getCurrent();
+                     if (timer.fired || timer.getExpires() != now) errors++;
+                     timer.fired = now;
+                     fired++;
+                   });
+
+      // Cancel and reschedule some along the way
+      unsigned i = rand() % count;
+      if (timers[i].isScheduled()) {
+        if (i & 1) {wheel.cancel(timers[i]); fired++;}
+        else wheel.schedule(timers[i], wheel.getCurrent() + rand() % 100000);
+      }
+    }
+
+    cout << "fired: " << fired << endl;
+    cout << "errors: " << errors << endl;
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc != 2) {
+      cout << "Usage: " << argv[0] << " <order|cancel|periodic|random>"
+           << endl;
+      return 1;
+    }
+
+    string test = argv[1];
+
+    if (test == "order") testOrder();
+    else if (test == "cancel") testCancel();
+    else if (test == "periodic") testPeriodic();
+    else if (test == "random") testRandom();
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,88 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2021-2024, Cauldron Development  Oy
+                Copyright (c) 2003-2021, Cauldron Development LLC
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+
+
+#include <cbang/Catch.h>
+#include <cbang/http/URLRouter.h>
+#include <cbang/http/Conn.h>
+#include <cbang/json/Value.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace cb::HTTP;
+using namespace std;
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) {
+      cout << "Usage: " << argv[0] << " <path> [pattern[!]]...\n\n"
+           << "A pattern ending in '!' declines the request." << endl;
+      return 1;
+    }
+
+    URLRouter router;
+
+    for (int i = 2; i < argc; i++) {
+      string pattern = argv[i];
+      bool decline = !pattern.empty() && pattern.back() == '!';
+      if (decline) pattern.pop_back();
+      unsigned route = i - 2;
+
+      router.add(pattern, new RequestFunctionHandler(
+                   [route, decline] (Request &req) {
+                     const string *pattern = req.getPattern();
+                     cout << route << ' ' << (pattern ? *pattern : "*")
+                          << ' ' << req.getArgs()->toString(0, true) << endl;
+                     return !decline;
+                   }));
+    }
+
+    Request req(0, Method::HTTP_GET, URI(argv[1]));
+    bool handled = router(req);
+    cout << "handled: " << (handled ? "true" : "false") << endl;
+
+    // The matched pattern must outlive routes added later
+    for (unsigned i = 0; i < 64; i++)
+      router.add("/more/" + String(i), new RequestHandler);
+
+    if (handled && req.getPattern())
+      cout << "pattern: " << *req.getPattern() << endl;
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}